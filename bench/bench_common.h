@@ -0,0 +1,127 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "headless_context.h"
+#include "offscreen_target.h"
+
+//shared bits for the executables in bench/. header only on purpose: each
+//benchmark is a single translation unit.
+namespace bench {
+
+//project root, baked in by bench/CMakeLists.txt
+inline std::string rootPath(const std::string &rel) {
+  return std::string(DEPTHGL_ROOT) + "/" + rel;
+}
+
+//3.3 core context that never presents anything. headless through EGL when
+//the build has it (CI boxes, llvmpipe), otherwise an invisible GLFW window.
+//either way, render into target(): there may be no default framebuffer.
+class GLContext {
+public:
+  GLContext(int width = 800, int height = 600) {
+    if (!headless.create()) {
+      createWindow(width, height);
+    }
+    offscreen = std::make_unique<OffscreenTarget>(width, height);
+    glState().bindFramebuffer(GL_FRAMEBUFFER, offscreen->fbo());
+    glViewport(0, 0, width, height);
+  }
+  ~GLContext() {
+    offscreen.reset();
+    headless.destroy();
+    if (window) {
+      glfwTerminate();
+    }
+  }
+
+  GLContext(const GLContext &) = delete;
+  GLContext &operator=(const GLContext &) = delete;
+
+  //framebuffer (with depth + stencil) to render into
+  OffscreenTarget &target() { return *offscreen; }
+
+private:
+  HeadlessContext headless;
+  GLFWwindow *window{nullptr};
+  std::unique_ptr<OffscreenTarget> offscreen;
+
+  void createWindow(int width, int height) {
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    window = glfwCreateWindow(width, height, "bench", NULL, NULL);
+    if (window == NULL) {
+      std::cout << "Failed to create window" << std::endl;
+      glfwTerminate();
+      std::exit(1);
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+      std::cout << "Failed to initialize GLAD" << std::endl;
+      std::exit(1);
+    }
+    loadGLExtensions((GLADloadproc)glfwGetProcAddress);
+  }
+};
+
+using Clock = std::chrono::steady_clock;
+
+inline double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+    .count();
+}
+
+//nearest rank percentile, p in [0, 100]. sorts a copy.
+inline double percentile(std::vector<double> samples, double p) {
+  if (samples.empty()) {
+    return 0.0;
+  }
+  std::sort(samples.begin(), samples.end());
+  size_t rank = static_cast<size_t>(p / 100.0 * (samples.size() - 1) + 0.5);
+  return samples[std::min(rank, samples.size() - 1)];
+}
+
+//int option of the form --name=value, or fallback
+inline int intArg(int argc, char *argv[], const std::string &name,
+                  int fallback) {
+  std::string prefix = "--" + name + "=";
+  for (int i{1}; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, prefix.size(), prefix) == 0) {
+      return std::atoi(arg.c_str() + prefix.size());
+    }
+  }
+  return fallback;
+}
+
+//string option of the form --name=value, or fallback
+inline std::string stringArg(int argc, char *argv[], const std::string &name,
+                             const std::string &fallback) {
+  std::string prefix = "--" + name + "=";
+  for (int i{1}; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, prefix.size(), prefix) == 0) {
+      return arg.substr(prefix.size());
+    }
+  }
+  return fallback;
+}
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,141 @@
+//Bvh build, refit and query throughput for 1k, 100k and 1M objects spread
+//over a floor that grows with the count (so density stays the same): full
+//SAH build, full refit, incremental refit of 1% of the objects, frustum
+//queries (vs. cullAabbs over every box), ray casts and box overlap queries.
+//no GL involved.
+//
+//  bvh_bench [--runs=5] [--rays=10000] [--max=1000000]
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench_common.h"
+#include "bvh.h"
+#include "frustum.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+int main(int argc, char *argv[]) {
+  int runs = bench::intArg(argc, argv, "runs", 5);
+  int rays = bench::intArg(argc, argv, "rays", 10000);
+  int maxObjects = bench::intArg(argc, argv, "max", 1000000);
+
+  std::printf("%8s %9s %9s %9s %9s %9s %10s %10s %9s\n", "objects",
+              "build ms", "refit ms", "1% ms", "frustum", "linear",
+              "ray ns", "overlap", "visible");
+  for (int count : {1000, 100000, 1000000}) {
+    if (count > maxObjects) {
+      break;
+    }
+    float side = 4.0f * std::sqrt(static_cast<float>(count));
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<float> position(-side / 2, side / 2);
+    std::uniform_real_distribution<float> height(0.0f, 4.0f);
+    std::uniform_real_distribution<float> size(0.25f, 1.5f);
+    std::vector<Aabb> bounds(count);
+    for (Aabb &box : bounds) {
+      glm::vec3 center(position(rng), height(rng), position(rng));
+      glm::vec3 extent(size(rng), size(rng), size(rng));
+      box = {center - extent, center + extent};
+    }
+    AabbBatch batch;
+    batch.reserve(count);
+    for (const Aabb &box : bounds) {
+      batch.push_back(box);
+    }
+
+    //camera at the edge of the floor looking in, 100 units deep
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+                                            16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 5.0f, side / 2),
+                                 glm::vec3(0.0f, 0.0f, 0.0f),
+                                 glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum(projection * view);
+
+    //1% of the objects nudged, as if their model matrices changed
+    std::vector<uint32_t> moved;
+    for (int i{}; i < count; i += 100) {
+      moved.push_back(static_cast<uint32_t>(i));
+    }
+    std::vector<Aabb> nudged = bounds;
+    for (uint32_t i : moved) {
+      glm::vec3 offset(0.1f, 0.0f, -0.1f);
+      nudged[i] = {nudged[i].min + offset, nudged[i].max + offset};
+    }
+
+    std::vector<glm::vec3> origins(rays), directions(rays);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (int i{}; i < rays; ++i) {
+      origins[i] = glm::vec3(position(rng), 2.0f, position(rng));
+      directions[i] = glm::normalize(glm::vec3(unit(rng), unit(rng) * 0.2f,
+                                               unit(rng)));
+    }
+
+    Bvh bvh;
+    std::vector<double> buildMs, refitMs, partialMs, frustumUs, linearUs;
+    std::vector<double> rayNs, overlapUs;
+    std::vector<uint32_t> found;
+    std::vector<uint8_t> visible(count);
+    size_t visibleCount{};
+    found.reserve(count);
+    for (int run{}; run < runs; ++run) {
+      bench::Clock::time_point start = bench::Clock::now();
+      bvh.build(bounds);
+      buildMs.push_back(bench::msSince(start));
+
+      start = bench::Clock::now();
+      bvh.refit(bounds);
+      refitMs.push_back(bench::msSince(start));
+
+      start = bench::Clock::now();
+      bvh.refit(nudged, moved);
+      partialMs.push_back(bench::msSince(start));
+      bvh.refit(bounds, moved);
+
+      found.clear();
+      start = bench::Clock::now();
+      visibleCount = bvh.queryFrustum(frustum, found);
+      frustumUs.push_back(bench::msSince(start) * 1000.0);
+
+      start = bench::Clock::now();
+      size_t linearCount = cullAabbs(frustum, batch, visible.data());
+      linearUs.push_back(bench::msSince(start) * 1000.0);
+      if (linearCount != visibleCount) {
+        std::printf("MISMATCH: bvh %zu linear %zu\n", visibleCount,
+                    linearCount);
+        return 1;
+      }
+
+      start = bench::Clock::now();
+      size_t hits{};
+      for (int i{}; i < rays; ++i) {
+        BvhRayHit hit;
+        hits += bvh.raycast(origins[i], directions[i], hit);
+      }
+      rayNs.push_back(bench::msSince(start) * 1e6 / rays);
+      (void)hits;
+
+      //a 20 unit box around every 100th ray origin
+      start = bench::Clock::now();
+      int overlapQueries{};
+      for (int i{}; i < rays; i += 100) {
+        found.clear();
+        bvh.queryOverlap({origins[i] - glm::vec3(10.0f),
+                          origins[i] + glm::vec3(10.0f)}, found);
+        ++overlapQueries;
+      }
+      overlapUs.push_back(bench::msSince(start) * 1000.0 / overlapQueries);
+    }
+    std::printf("%8d %9.2f %9.3f %9.4f %7.1fus %7.1fus %10.1f %8.2fus "
+                "%9zu\n", count,
+                bench::percentile(buildMs, 50),
+                bench::percentile(refitMs, 50),
+                bench::percentile(partialMs, 50),
+                bench::percentile(frustumUs, 50),
+                bench::percentile(linearUs, 50),
+                bench::percentile(rayNs, 50),
+                bench::percentile(overlapUs, 50), visibleCount);
+  }
+  return 0;
+}
@@ -0,0 +1,74 @@
+//frustum culling throughput: random boxes scattered around the camera,
+//tested one Aabb at a time (Frustum::intersects), with the scalar batch loop
+//and with cullAabbs' SIMD path. no GL involved.
+//
+//  cull_bench [--runs=20] [--max=1000000]
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench_common.h"
+#include "frustum.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+int main(int argc, char *argv[]) {
+  int runs = bench::intArg(argc, argv, "runs", 20);
+  int maxBoxes = bench::intArg(argc, argv, "max", 1000000);
+
+  //the demo camera: 45 degrees, 100 units deep, looking across the scene
+  glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+                                          800.0f / 600.0f, 0.1f, 100.0f);
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 10.0f), glm::vec3(0.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  Frustum frustum(projection * view);
+
+  std::printf("simd path: %s\n", cullSimdPath());
+  std::printf("%9s %9s %12s %12s %12s\n", "boxes", "visible",
+              "aos ns/box", "scalar", "simd");
+  for (int count = 1000; count <= maxBoxes; count *= 10) {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+    std::vector<Aabb> boxes(count);
+    AabbBatch batch;
+    batch.reserve(count);
+    for (Aabb &box : boxes) {
+      glm::vec3 center(position(rng), position(rng) * 0.1f, position(rng));
+      glm::vec3 extent(size(rng), size(rng), size(rng));
+      box = {center - extent, center + extent};
+      batch.push_back(box);
+    }
+    std::vector<uint8_t> visible(count);
+
+    std::vector<double> aosNs, scalarNs, simdNs;
+    size_t visibleCount{};
+    for (int run{}; run < runs; ++run) {
+      bench::Clock::time_point start = bench::Clock::now();
+      size_t aosVisible{};
+      for (const Aabb &box : boxes) {
+        aosVisible += frustum.intersects(box);
+      }
+      aosNs.push_back(bench::msSince(start) * 1e6 / count);
+
+      start = bench::Clock::now();
+      size_t scalarVisible = cullAabbsScalar(frustum, batch, visible.data());
+      scalarNs.push_back(bench::msSince(start) * 1e6 / count);
+
+      start = bench::Clock::now();
+      visibleCount = cullAabbs(frustum, batch, visible.data());
+      simdNs.push_back(bench::msSince(start) * 1e6 / count);
+
+      if (aosVisible != visibleCount || scalarVisible != visibleCount) {
+        std::printf("MISMATCH: aos %zu scalar %zu simd %zu\n", aosVisible,
+                    scalarVisible, visibleCount);
+        return 1;
+      }
+    }
+    std::printf("%9d %9zu %12.3f %12.3f %12.3f\n", count, visibleCount,
+                bench::percentile(aosNs, 50),
+                bench::percentile(scalarNs, 50),
+                bench::percentile(simdNs, 50));
+  }
+  return 0;
+}
@@ -0,0 +1,66 @@
+//counts heap allocations made by Model::Draw per frame. the draw path is
+//supposed to be allocation free once the first frame has resolved its
+//uniforms, so anything above zero here is a regression (exit code 1).
+//
+//  draw_alloc_bench [--model=path/to/model.obj] [--frames=100]
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "bench_common.h"
+#include "model.h"
+#include "shader.h"
+#include "stb_image.h"
+
+static std::atomic<size_t> allocationCount{0};
+
+void *operator new(size_t size) {
+  ++allocationCount;
+  if (void *ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+int main(int argc, char *argv[]) {
+  std::string path = bench::stringArg(argc, argv, "model",
+    bench::rootPath("models/backpack/backpack.obj"));
+  int frames = bench::intArg(argc, argv, "frames", 100);
+
+  bench::GLContext context;
+  stbi_set_flip_vertically_on_load(true);
+  Shader shader(bench::rootPath("src/shaders/vertex.glsl").c_str(),
+                bench::rootPath("src/shaders/fragment.glsl").c_str());
+  ModelLoadOptions options;
+  options.keepCpuData = false;
+  Model model(path, options);
+
+  shader.use();
+  model.Draw(shader); //warm up: first draw resolves sampler handles
+  glFinish();
+
+  size_t before = allocationCount.load();
+  for (int frame{}; frame < frames; ++frame) {
+    model.Draw(shader);
+  }
+  glFinish();
+  size_t allocations = allocationCount.load() - before;
+
+  std::printf("%s: %zu allocations over %d frames (%.3f per frame)\n",
+              path.c_str(), allocations, frames,
+              static_cast<double>(allocations) / frames);
+  return allocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+//time to first frame for a model whose textures are decoded and uploaded
+//synchronously during load vs. through AsyncTextureLoader (placeholders
+//first, one upload per frame after that). for the async path it also
+//reports when the last real texture became resident.
+//
+//  first_frame_bench [--model=path/to/model.obj] [--runs=3] [--threads=0]
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "job_system.h"
+#include "model.h"
+#include "shader.h"
+#include "stb_image.h"
+#include "texture_loader.h"
+
+int main(int argc, char *argv[]) {
+  std::string path = bench::stringArg(argc, argv, "model",
+    bench::rootPath("models/backpack/backpack.obj"));
+  int runs = bench::intArg(argc, argv, "runs", 3);
+  int threads = bench::intArg(argc, argv, "threads", 0);
+
+  bench::GLContext context;
+  stbi_set_flip_vertically_on_load(true);
+  JobSystem jobs(static_cast<unsigned int>(threads));
+  Shader shader(bench::rootPath("src/shaders/vertex.glsl").c_str(),
+                bench::rootPath("src/shaders/fragment.glsl").c_str());
+  {
+    Model primer(path); //warm the mesh cache so only textures differ
+  }
+
+  std::vector<double> syncFirst, asyncFirst, asyncResident, asyncFrames;
+  for (int run{}; run < runs; ++run) {
+    {
+      bench::Clock::time_point start = bench::Clock::now();
+      Model model(path);
+      shader.use();
+      model.Draw(shader);
+      glFinish();
+      syncFirst.push_back(bench::msSince(start));
+    }
+    {
+      bench::Clock::time_point start = bench::Clock::now();
+      AsyncTextureLoader loader(jobs);
+      ModelLoadOptions options;
+      options.textureLoader = &loader;
+      Model model(path, options);
+      shader.use();
+      model.Draw(shader);
+      glFinish();
+      asyncFirst.push_back(bench::msSince(start));
+
+      //keep drawing, swapping in at most one texture per frame
+      int frames{1};
+      while (loader.pending() != 0) {
+        loader.pump(1);
+        model.Draw(shader);
+        glFinish();
+        ++frames;
+      }
+      asyncResident.push_back(bench::msSince(start));
+      asyncFrames.push_back(frames);
+    }
+  }
+
+  std::printf("%s, %d runs, %zu decode threads (median ms)\n",
+              path.c_str(), runs, jobs.workerCount());
+  std::printf("sync   first frame %8.2f\n", bench::percentile(syncFirst, 50));
+  std::printf("async  first frame %8.2f  all resident %8.2f  "
+              "after %.0f frames\n",
+              bench::percentile(asyncFirst, 50),
+              bench::percentile(asyncResident, 50),
+              bench::percentile(asyncFrames, 50));
+  return 0;
+}
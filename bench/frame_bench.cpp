@@ -0,0 +1,262 @@
+//deterministic frame time benchmark: plays a scripted camera path at a fixed
+//timestep through the demo scene and reports CPU submit time, GPU time
+//(GL_TIME_ELAPSED) and per frame GL call counts as p50/p95/p99 JSON.
+//
+//  frame_bench [--frames=600] [--warmup=30] [--dt=0.016666]
+//              [--objects=2] [--outline=stencil|jfa] [--size=1280x720]
+//              [--out=results.json] [--trace=trace.json]
+//              [--state-cache=on|off]
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "frame_stats.h"
+#include "gl_call_counter.h"
+#include "gl_state.h"
+#include "gpu_profiler.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "job_system.h"
+#include "scene.h"
+#include "stb_image.h"
+
+//camera keyframes, linearly interpolated and looped. t in seconds.
+struct CameraKey {
+  float time;
+  glm::vec3 position;
+  glm::vec3 target;
+};
+
+static const CameraKey cameraPath[] = {
+  {0.0f, glm::vec3( 0.0f, 0.5f,  3.0f), glm::vec3( 0.0f, 0.0f,  0.0f)},
+  {2.0f, glm::vec3( 4.0f, 1.5f,  2.0f), glm::vec3( 0.5f, 0.0f, -0.5f)},
+  {4.0f, glm::vec3( 3.0f, 3.0f, -4.0f), glm::vec3( 0.0f, 0.0f,  0.0f)},
+  {6.0f, glm::vec3(-4.0f, 1.0f, -2.0f), glm::vec3(-1.0f, 0.0f, -1.0f)},
+  {8.0f, glm::vec3(-1.0f, 0.2f,  1.0f), glm::vec3( 2.0f, 0.0f,  0.0f)},
+  {10.0f, glm::vec3( 0.0f, 0.5f,  3.0f), glm::vec3( 0.0f, 0.0f,  0.0f)},
+};
+
+static glm::mat4 cameraAt(float t) {
+  const size_t keys = sizeof(cameraPath) / sizeof(cameraPath[0]);
+  t = std::fmod(t, cameraPath[keys - 1].time);
+  size_t i{};
+  while (i + 2 < keys && cameraPath[i + 1].time <= t) {
+    ++i;
+  }
+  const CameraKey &a = cameraPath[i];
+  const CameraKey &b = cameraPath[i + 1];
+  float f = (t - a.time) / (b.time - a.time);
+  return glm::lookAt(glm::mix(a.position, b.position, f),
+                     glm::mix(a.target, b.target, f),
+                     glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+//count cubes laid out on the floor; the first two are the demo's own
+static std::vector<glm::mat4> sceneObjects(int count) {
+  std::vector<glm::mat4> transforms = {
+    glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 0.01f, -1.0f)),
+    glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.01f, 0.0f)),
+  };
+  transforms.resize(std::min<size_t>(transforms.size(), count));
+  int side = static_cast<int>(std::ceil(std::sqrt(double(count))));
+  for (int i = static_cast<int>(transforms.size()); i < count; ++i) {
+    glm::vec3 pos(-4.5f + 9.0f * (i % side) / side, 0.01f,
+                  -4.5f + 9.0f * (i / side) / side);
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), pos);
+    transforms.push_back(glm::scale(model, glm::vec3(4.0f / side)));
+  }
+  return transforms;
+}
+
+//GL_TIME_ELAPSED queries can't be read back the frame they're issued without
+//stalling, so keep a few in flight and collect them late
+class GpuFrameTimer {
+public:
+  explicit GpuFrameTimer(size_t depth = 4) : queries(depth) {
+    glGenQueries(static_cast<GLsizei>(depth), queries.data());
+  }
+  ~GpuFrameTimer() {
+    glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+  }
+  void begin() {
+    if (issued - collected == queries.size()) {
+      collect(); //oldest result is needed before its query can be reused
+    }
+    glBeginQuery(GL_TIME_ELAPSED, queries[issued % queries.size()]);
+  }
+  void end() {
+    glEndQuery(GL_TIME_ELAPSED);
+    ++issued;
+  }
+  void collectAll() {
+    while (collected < issued) {
+      collect();
+    }
+  }
+  std::vector<double> samplesMs;
+
+private:
+  std::vector<unsigned int> queries;
+  size_t issued{0}, collected{0};
+
+  void collect() {
+    GLuint64 ns{};
+    glGetQueryObjectui64v(queries[collected % queries.size()],
+                          GL_QUERY_RESULT, &ns);
+    samplesMs.push_back(ns / 1.0e6);
+    ++collected;
+  }
+};
+
+static std::string statsJson(const std::vector<double> &samples) {
+  double sum{};
+  for (double s : samples) {
+    sum += s;
+  }
+  std::ostringstream out;
+  out << "{\"mean\": " << (samples.empty() ? 0.0 : sum / samples.size())
+      << ", \"p50\": " << bench::percentile(samples, 50)
+      << ", \"p95\": " << bench::percentile(samples, 95)
+      << ", \"p99\": " << bench::percentile(samples, 99)
+      << ", \"max\": " << bench::percentile(samples, 100) << "}";
+  return out.str();
+}
+
+int main(int argc, char *argv[]) {
+  int frames = bench::intArg(argc, argv, "frames", 600);
+  int warmup = bench::intArg(argc, argv, "warmup", 30);
+  float dt = std::stof(bench::stringArg(argc, argv, "dt", "0.0166667"));
+  int objects = bench::intArg(argc, argv, "objects", 2);
+  std::string outline = bench::stringArg(argc, argv, "outline", "stencil");
+  std::string size = bench::stringArg(argc, argv, "size", "1280x720");
+  std::string outPath = bench::stringArg(argc, argv, "out", "");
+  std::string tracePath = bench::stringArg(argc, argv, "trace", "");
+  std::string stateCache = bench::stringArg(argc, argv, "state-cache", "on");
+  int width = 1280, height = 720;
+  std::sscanf(size.c_str(), "%dx%d", &width, &height);
+
+  bench::GLContext context(width, height);
+  glState().setEliding(stateCache != "off");
+  stbi_set_flip_vertically_on_load(true);
+  std::vector<double> cpuMs;
+  std::vector<double> drawCalls, stateChanges, uniformUploads, bufferUploads;
+  std::vector<double> stateIssued, stateElided;
+  std::vector<double> objectsVisible, objectsCulled;
+  std::vector<double> gpuMs;
+  //per pass GPU/CPU ms, keyed by scope name
+  std::map<std::string, std::vector<double>> passGpuMs, passCpuMs;
+  {
+    JobSystem jobs;
+    Scene scene(DEPTHGL_ROOT, jobs);
+    scene.resize(width, height);
+    scene.setSelection(sceneObjects(objects));
+    scene.setOutlineMode(outline == "jfa" ? OUTLINE_JUMP_FLOOD
+                                          : OUTLINE_STENCIL_SCALE);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+                                            (float)width / (float)height,
+                                            0.1f, 100.0f);
+    unsigned int fbo = context.target().fbo();
+
+    for (int frame{}; frame < warmup; ++frame) {
+      scene.render(cameraAt(frame * dt), projection, fbo);
+    }
+    glFinish();
+
+    GpuProfiler profiler;
+    profiler.setTraceEnabled(!tracePath.empty());
+    scene.setProfiler(&profiler);
+    uint64_t lastProfiled = 0;
+    auto collectPasses = [&]() {
+      if (profiler.latest().empty() || profiler.latestFrame() == lastProfiled) {
+        return;
+      }
+      lastProfiled = profiler.latestFrame();
+      for (const GpuProfiler::PassTiming &pass : profiler.latest()) {
+        passGpuMs[pass.name].push_back(pass.gpuMs);
+        passCpuMs[pass.name].push_back(pass.cpuMs);
+      }
+    };
+
+    installGLCallCounters();
+    GpuFrameTimer gpuTimer;
+    for (int frame{}; frame < frames; ++frame) {
+      //simulated time only ever comes from the frame index
+      glm::mat4 view = cameraAt((warmup + frame) * dt);
+
+      scene.setTime((warmup + frame) * dt);
+      resetFrameStats();
+      bench::Clock::time_point start = bench::Clock::now();
+      profiler.beginFrame();
+      gpuTimer.begin();
+      scene.render(view, projection, fbo);
+      gpuTimer.end();
+      profiler.endFrame();
+      cpuMs.push_back(bench::msSince(start));
+      collectPasses();
+
+      const FrameStats &stats = currentFrameStats();
+      drawCalls.push_back(stats.drawCalls);
+      stateChanges.push_back(stats.stateChanges);
+      uniformUploads.push_back(stats.uniformUploads);
+      bufferUploads.push_back(stats.bufferUploads);
+      stateIssued.push_back(stats.stateIssued);
+      stateElided.push_back(stats.stateElided);
+      objectsVisible.push_back(stats.objectsVisible);
+      objectsCulled.push_back(stats.objectsCulled);
+    }
+    gpuTimer.collectAll();
+    uninstallGLCallCounters();
+    profiler.flush();
+    collectPasses();
+    if (!tracePath.empty()) {
+      profiler.writeChromeTrace(tracePath);
+    }
+    scene.setProfiler(nullptr);
+    gpuMs = gpuTimer.samplesMs;
+  }
+
+  std::ostringstream json;
+  json << "{\n"
+       << "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\",\n"
+       << "  \"frames\": " << frames << ",\n"
+       << "  \"dt\": " << dt << ",\n"
+       << "  \"objects\": " << objects << ",\n"
+       << "  \"outline\": \"" << outline << "\",\n"
+       << "  \"state_cache\": \"" << stateCache << "\",\n"
+       << "  \"width\": " << width << ",\n"
+       << "  \"height\": " << height << ",\n"
+       << "  \"cpu_ms\": " << statsJson(cpuMs) << ",\n"
+       << "  \"gpu_ms\": " << statsJson(gpuMs) << ",\n"
+       << "  \"draw_calls\": " << statsJson(drawCalls) << ",\n"
+       << "  \"state_changes\": " << statsJson(stateChanges) << ",\n"
+       << "  \"uniform_uploads\": " << statsJson(uniformUploads) << ",\n"
+       << "  \"buffer_uploads\": " << statsJson(bufferUploads) << ",\n"
+       << "  \"state_issued\": " << statsJson(stateIssued) << ",\n"
+       << "  \"state_elided\": " << statsJson(stateElided) << ",\n"
+       << "  \"objects_visible\": " << statsJson(objectsVisible) << ",\n"
+       << "  \"objects_culled\": " << statsJson(objectsCulled) << ",\n"
+       << "  \"passes\": {";
+  const char *separator = "\n";
+  for (const auto &pass : passGpuMs) {
+    json << separator << "    \"" << pass.first << "\": {\"gpu_ms\": "
+         << statsJson(pass.second) << ", \"cpu_ms\": "
+         << statsJson(passCpuMs[pass.first]) << "}";
+    separator = ",\n";
+  }
+  json << "\n  }\n}\n";
+  if (outPath.empty()) {
+    std::cout << json.str();
+  } else {
+    std::ofstream(outPath) << json.str();
+  }
+  return 0;
+}
@@ -0,0 +1,219 @@
+//JobSystem overhead and scaling for 1 to N workers: empty jobs queued from
+//the main thread and waited on (scheduling cost per job), a chain of
+//runAfter() jobs (latency per dependency), parallelFor over cheap items with
+//the automatic grain (cost per item), and parallelFor over 1M box
+//transforms + frustum tests against the same loop run serially. no GL.
+//
+//before timing, every worker count runs --stress rounds that check results:
+//parallelFor coverage, runAfter ordering, boxed jobs, exceptions, jobs from
+//a foreign thread, nested parallelFor and more jobs than the recycled slots.
+//build with -fsanitize=thread to have those checked for races too.
+//
+//  job_bench [--jobs=100000] [--items=1000000] [--runs=5] [--stress=20]
+//            [--threads=<cores>]
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_common.h"
+#include "bounds.h"
+#include "frustum.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "job_system.h"
+
+//box i of count spread over a square, frustum tested after transforming it
+static bool visibleBox(size_t i, size_t count, const Frustum &frustum) {
+  float side = std::sqrt(static_cast<float>(count));
+  glm::mat4 model = glm::translate(glm::mat4(1.0f),
+    glm::vec3(std::fmod(static_cast<float>(i), side) - side / 2, 0.0f,
+              static_cast<float>(i) / side - side / 2));
+  model = glm::rotate(model, i * 0.1f, glm::vec3(0.0f, 1.0f, 0.0f));
+  Aabb box = transformAabb(Aabb{glm::vec3(-0.5f), glm::vec3(0.5f)}, model);
+  return frustum.intersects(box);
+}
+
+//one round of correctness checks; what went wrong, or null
+static const char *stressRound(JobSystem &jobs) {
+  std::vector<int> hits(100000);
+  jobs.parallelFor(hits.size(), [&](size_t i) { hits[i] += 1; });
+  jobs.parallelFor(hits.size(), [&](size_t i) { hits[i] += 1; }, 7);
+  for (int hit : hits) {
+    if (hit != 2) {
+      return "parallelFor missed or repeated an index";
+    }
+  }
+
+  //a fan-in of 50 jobs, then two links of runAfter
+  JobCounter first, second, third;
+  std::atomic<int> stage{0};
+  std::atomic<bool> ordered{true};
+  for (int i{}; i < 50; ++i) {
+    jobs.run([&]() { ordered = ordered && stage.load() == 0; }, &first);
+  }
+  jobs.runAfter(first, [&]() { stage = 1; }, &second);
+  jobs.runAfter(second, [&]() {
+    ordered = ordered && stage.load() == 1;
+    stage = 2;
+  }, &third);
+  jobs.wait(third);
+  if (!ordered || stage != 2) {
+    return "runAfter job ran before its dependency";
+  }
+
+  //too big to live inline in a Job
+  struct Big {
+    char pad[200];
+  } big{};
+  std::string text(100, 'x');
+  std::atomic<size_t> length{0};
+  JobCounter boxed;
+  for (int i{}; i < 10; ++i) {
+    jobs.run([text, big, &length]() {
+      length += text.size() + (big.pad[0] == 0);
+    }, &boxed);
+  }
+  jobs.wait(boxed);
+  if (length != 1010) {
+    return "boxed job lost its captures";
+  }
+
+  bool threw{false};
+  try {
+    jobs.parallelFor(1000, [](size_t i) {
+      if (i == 777) {
+        throw std::runtime_error("job");
+      }
+    });
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  if (!threw) {
+    return "exception from a job was not rethrown";
+  }
+
+  std::atomic<int> foreignRuns{0};
+  std::thread foreign([&]() {
+    JobCounter counter;
+    for (int i{}; i < 1000; ++i) {
+      jobs.run([&]() { ++foreignRuns; }, &counter);
+    }
+    jobs.wait(counter);
+  });
+  foreign.join();
+  if (foreignRuns != 1000) {
+    return "jobs from a foreign thread went missing";
+  }
+
+  std::atomic<long> sum{0};
+  jobs.parallelFor(8, [&](size_t) {
+    jobs.parallelFor(1000, [&](size_t k) { sum += static_cast<long>(k); });
+  });
+  if (sum != 8L * 999 * 1000 / 2) {
+    return "nested parallelFor went wrong";
+  }
+
+  //more than a thread's ring of recycled jobs
+  JobCounter many;
+  std::atomic<int> manyRuns{0};
+  for (int i{}; i < 10000; ++i) {
+    jobs.run([&]() { ++manyRuns; }, &many);
+  }
+  jobs.wait(many);
+  if (manyRuns != 10000) {
+    return "jobs past the recycled slots went missing";
+  }
+  return nullptr;
+}
+
+int main(int argc, char *argv[]) {
+  int jobCount = bench::intArg(argc, argv, "jobs", 100000);
+  int items = bench::intArg(argc, argv, "items", 1000000);
+  int runs = bench::intArg(argc, argv, "runs", 5);
+  int stressRounds = bench::intArg(argc, argv, "stress", 20);
+  int maxThreads = bench::intArg(argc, argv, "threads",
+    static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+
+  Frustum frustum(glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f,
+                                   500.0f)
+                  * glm::lookAt(glm::vec3(0.0f, 40.0f, 60.0f), glm::vec3(0.0f),
+                                glm::vec3(0.0f, 1.0f, 0.0f)));
+  std::vector<uint8_t> visible(items);
+
+  //the same loop on one thread, no job system
+  std::vector<double> serialMs;
+  for (int run{}; run < runs; ++run) {
+    bench::Clock::time_point start = bench::Clock::now();
+    for (size_t i{}; i < visible.size(); ++i) {
+      visible[i] = visibleBox(i, visible.size(), frustum);
+    }
+    serialMs.push_back(bench::msSince(start));
+  }
+  double serial = bench::percentile(serialMs, 50);
+
+  std::vector<int> threadCounts;
+  for (int threads{1}; threads < maxThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  std::printf("%d jobs, %d items, %d runs; serial boxes %.2f ms\n", jobCount,
+              items, runs, serial);
+  std::printf("%8s %10s %10s %10s %10s %9s\n", "workers", "ns/job",
+              "ns/dep", "ns/item", "boxes ms", "speedup");
+  for (int threads : threadCounts) {
+    JobSystem jobs(threads);
+    for (int round{}; round < stressRounds; ++round) {
+      if (const char *failure = stressRound(jobs)) {
+        std::printf("MISMATCH: %d workers: %s\n", threads, failure);
+        return 1;
+      }
+    }
+    std::vector<double> jobNs, dependencyNs, itemNs, boxesMs;
+    for (int run{}; run < runs; ++run) {
+      //empty jobs: queue, steal, run, count down
+      JobCounter counter;
+      bench::Clock::time_point start = bench::Clock::now();
+      for (int i{}; i < jobCount; ++i) {
+        jobs.run([]() {}, &counter);
+      }
+      jobs.wait(counter);
+      jobNs.push_back(bench::msSince(start) * 1.0e6 / jobCount);
+
+      //every job waits for the one before it
+      int links = jobCount / 10;
+      std::vector<JobCounter> chain(links);
+      start = bench::Clock::now();
+      jobs.run([]() {}, &chain[0]);
+      for (int i{1}; i < links; ++i) {
+        jobs.runAfter(chain[i - 1], []() {}, &chain[i]);
+      }
+      jobs.wait(chain[links - 1]);
+      dependencyNs.push_back(bench::msSince(start) * 1.0e6 / links);
+
+      //next to nothing per item: what the automatic grain leaves over
+      std::vector<uint32_t> values(items);
+      start = bench::Clock::now();
+      jobs.parallelFor(values.size(), [&](size_t i) {
+        values[i] = static_cast<uint32_t>(i * 2654435761u);
+      });
+      itemNs.push_back(bench::msSince(start) * 1.0e6 / items);
+
+      start = bench::Clock::now();
+      jobs.parallelFor(visible.size(), [&](size_t i) {
+        visible[i] = visibleBox(i, visible.size(), frustum);
+      });
+      boxesMs.push_back(bench::msSince(start));
+    }
+    double boxes = bench::percentile(boxesMs, 50);
+    std::printf("%8d %10.1f %10.1f %10.2f %10.2f %8.2fx\n", threads,
+                bench::percentile(jobNs, 50),
+                bench::percentile(dependencyNs, 50),
+                bench::percentile(itemNs, 50), boxes, serial / boxes);
+  }
+  return 0;
+}
@@ -0,0 +1,96 @@
+//load time of a model through the serial and the job system paths of
+//Model::loadModel, and from a warm mesh cache, broken down per phase. also
+//prints what optimizeMesh did to every mesh's post-transform cache hit rate.
+//
+//  load_bench [--model=path/to/model.obj] [--runs=5] [--threads=0]
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "job_system.h"
+#include "model.h"
+#include "stb_image.h"
+
+struct PhaseSamples {
+  std::vector<double> import, convert, textures, upload, total;
+
+  void add(const ModelLoadTimings &t, double totalMs) {
+    import.push_back(t.importMs);
+    convert.push_back(t.convertMs);
+    textures.push_back(t.texturesMs);
+    upload.push_back(t.uploadMs);
+    total.push_back(totalMs);
+  }
+};
+
+static void report(const char *label, const PhaseSamples &s) {
+  std::printf("%-10s import %8.2f  convert %8.2f  textures %8.2f  "
+              "upload %8.2f  total %8.2f  (median ms)\n",
+              label,
+              bench::percentile(s.import, 50),
+              bench::percentile(s.convert, 50),
+              bench::percentile(s.textures, 50),
+              bench::percentile(s.upload, 50),
+              bench::percentile(s.total, 50));
+}
+
+int main(int argc, char *argv[]) {
+  std::string path = bench::stringArg(argc, argv, "model",
+    bench::rootPath("models/backpack/backpack.obj"));
+  int runs = bench::intArg(argc, argv, "runs", 5);
+  int threads = bench::intArg(argc, argv, "threads", 0);
+
+  bench::GLContext context;
+  stbi_set_flip_vertically_on_load(true);
+  JobSystem jobs(static_cast<unsigned int>(threads));
+
+  ModelLoadOptions serialOptions;
+  serialOptions.useMeshCache = false;
+  ModelLoadOptions parallelOptions = serialOptions;
+  parallelOptions.jobs = &jobs;
+  ModelLoadOptions cachedOptions; //first load below primes the cache
+
+  {
+    Model primer(path, cachedOptions);
+  }
+
+  PhaseSamples serial, parallel, cached;
+  auto timeLoad = [&](const ModelLoadOptions &options, PhaseSamples &out) {
+    bench::Clock::time_point start = bench::Clock::now();
+    Model model(path, options);
+    glFinish();
+    out.add(model.loadTimings(), bench::msSince(start));
+  };
+  for (int run{}; run < runs; ++run) {
+    //interleave so no path always gets the warmer OS file cache
+    timeLoad(serialOptions, serial);
+    timeLoad(parallelOptions, parallel);
+    timeLoad(cachedOptions, cached);
+  }
+
+  std::printf("%s, %d runs, %zu worker threads\n",
+              path.c_str(), runs, jobs.workerCount());
+  report("serial", serial);
+  report("parallel", parallel);
+  report("cached", cached);
+
+  //the timed loads above hit the cache or ran in parallel; this one is only
+  //for the per mesh optimization stats
+  Model fresh(path, serialOptions);
+  const std::vector<MeshOptimizeStats> &stats = fresh.optimizeStats();
+  std::printf("vertex cache (FIFO %zu): ACMR / ATVR before -> after\n",
+              OPTIMIZE_CACHE_SIZE);
+  for (size_t i{}; i < stats.size(); ++i) {
+    const MeshOptimizeStats &m = stats[i];
+    std::printf("mesh %3zu  %7zu -> %7zu vertecies  ACMR %.3f -> %.3f  "
+                "ATVR %.3f -> %.3f\n",
+                i, m.verticesBefore, m.verticesAfter, m.before.acmr,
+                m.after.acmr, m.before.atvr, m.after.atvr);
+  }
+  return 0;
+}
@@ -0,0 +1,108 @@
+//draw submission cost of a model drawn mesh by mesh (own VAO per mesh, one
+//glDrawElementsBaseVertex per draw range) vs. with sharedBuffers (one arena
+//VAO, one glMultiDrawElementsBaseVertex per material). CPU time is just the
+//Model::Draw call, so it's what the driver charges to queue the frame up;
+//GL calls are counted with installGLCallCounters.
+//
+//  multidraw_bench [--model=path/to/model.obj] [--frames=500] [--runs=3]
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "frame_stats.h"
+#include "frame_uniforms.h"
+#include "gl_call_counter.h"
+#include "gl_state.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "model.h"
+#include "shader.h"
+#include "stb_image.h"
+
+struct PathResult {
+  size_t drawCalls{}, stateChanges{}, uniformUploads{};
+  std::vector<double> submitUs, frameMs;
+};
+
+static void run(const std::string &path, bool sharedBuffers, Shader &shader,
+                int frames, PathResult &result) {
+  ModelLoadOptions options;
+  options.keepCpuData = false;
+  options.sharedBuffers = sharedBuffers;
+  Model model(path, options);
+
+  FrameUniforms frameUniforms;
+  frameUniforms.update(glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f),
+                                   glm::vec3(0.0f), glm::vec3(0, 1, 0)),
+                       glm::perspective(glm::radians(45.0f), 800.0f / 600.0f,
+                                        0.1f, 100.0f), 0.0f);
+  shader.use();
+  shader.setMat4("model", glm::mat4(1.0f));
+  model.Draw(shader); //warm up
+  glFinish();
+
+  installGLCallCounters();
+  resetFrameStats();
+  model.Draw(shader);
+  const FrameStats &stats = currentFrameStats();
+  result.drawCalls = stats.drawCalls;
+  result.stateChanges = stats.stateChanges;
+  result.uniformUploads = stats.uniformUploads;
+  uninstallGLCallCounters();
+
+  double submitMs{};
+  bench::Clock::time_point start = bench::Clock::now();
+  for (int frame{}; frame < frames; ++frame) {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    bench::Clock::time_point submitStart = bench::Clock::now();
+    model.Draw(shader);
+    submitMs += bench::msSince(submitStart);
+  }
+  glFinish();
+  result.frameMs.push_back(bench::msSince(start) / frames);
+  result.submitUs.push_back(submitMs * 1000.0 / frames);
+}
+
+static void print(const char *name, const PathResult &result) {
+  std::printf("%-10s draws %5zu  state %5zu  uniforms %5zu  "
+              "submit %9.2f us  frame %8.3f ms\n", name, result.drawCalls,
+              result.stateChanges, result.uniformUploads,
+              bench::percentile(result.submitUs, 50),
+              bench::percentile(result.frameMs, 50));
+}
+
+int main(int argc, char *argv[]) {
+  std::string path = bench::stringArg(argc, argv, "model",
+    bench::rootPath("models/backpack/backpack.obj"));
+  int frames = bench::intArg(argc, argv, "frames", 500);
+  int runs = bench::intArg(argc, argv, "runs", 3);
+
+  bench::GLContext context;
+  glState().enable(GL_DEPTH_TEST);
+  stbi_set_flip_vertically_on_load(true);
+  std::string vertexPath = bench::rootPath("src/shaders/vertex.glsl");
+  std::string fragmentPath = bench::rootPath("src/shaders/fragment.glsl");
+  Shader shader(vertexPath.c_str(), fragmentPath.c_str());
+  {
+    Model primer(path); //warm the mesh cache so both paths load the same way
+  }
+
+  PathResult perMesh, shared;
+  for (int i{}; i < runs; ++i) {
+    run(path, false, shader, frames, perMesh);
+    run(path, true, shader, frames, shared);
+  }
+
+  std::printf("%s, %d runs x %d frames (median)\n", path.c_str(), runs,
+              frames);
+  print("per mesh", perMesh);
+  print("shared", shared);
+  if (shared.drawCalls != 0) {
+    std::printf("draw calls: %.1fx fewer\n",
+                static_cast<double>(perMesh.drawCalls) / shared.drawCalls);
+  }
+  return 0;
+}
@@ -0,0 +1,191 @@
+//cost of the outline as the selection grows: one draw + one uniform upload
+//per object and pass (what main.cpp used to do), OutlineRenderer's two
+//instanced draws, and the jump flood outline (instanced object pass + stencil
+//copy + fullscreen passes). runs fine on Mesa's software rasterizer:
+//
+//  LIBGL_ALWAYS_SOFTWARE=1 outline_bench [--frames=50] [--max=10000]
+//                                        [--width=4]
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "bench_common.h"
+#include "frame_uniforms.h"
+#include "gl_state.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "jump_flood_outline.h"
+#include "outline_renderer.h"
+#include "shader.h"
+
+static const float cubeVertices[] = {
+  // positions          // texture Coords
+  -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,   0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
+   0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+  -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,  -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+
+  -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+   0.5f,  0.5f,  0.5f,  1.0f, 1.0f,   0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+  -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,  -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+
+  -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,  -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+  -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,  -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+  -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,  -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+   0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+   0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+   0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+  -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
+   0.5f, -0.5f,  0.5f,  1.0f, 0.0f,   0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+  -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,  -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+
+  -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,   0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+   0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+  -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,  -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+};
+
+//count cubes on a square grid centered on the origin, small enough that the
+//whole grid stays on screen
+static std::vector<glm::mat4> gridTransforms(size_t count) {
+  std::vector<glm::mat4> transforms;
+  transforms.reserve(count);
+  size_t side = static_cast<size_t>(std::ceil(std::sqrt(double(count))));
+  float spacing = 20.0f / side;
+  for (size_t i{}; i < count; ++i) {
+    glm::vec3 pos((i % side - side / 2.0f) * spacing,
+                  (i / side - side / 2.0f) * spacing, 0.0f);
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), pos);
+    transforms.push_back(glm::scale(model, glm::vec3(spacing * 0.5f)));
+  }
+  return transforms;
+}
+
+int main(int argc, char *argv[]) {
+  int frames = bench::intArg(argc, argv, "frames", 50);
+  int maxObjects = bench::intArg(argc, argv, "max", 10000);
+  int outlineWidth = bench::intArg(argc, argv, "width", 4);
+
+  bench::GLContext context(800, 600);
+  glState().enable(GL_DEPTH_TEST);
+  glState().enable(GL_STENCIL_TEST);
+  glState().stencilOp(GL_KEEP, GL_REPLACE, GL_REPLACE);
+
+  std::string shaders = bench::rootPath("src/shaders/");
+  Shader shader((shaders + "vertex.glsl").c_str(),
+                (shaders + "fragment.glsl").c_str());
+  Shader singleColorShader((shaders + "vertex.glsl").c_str(),
+                           (shaders + "shaderSingleColor.glsl").c_str());
+  Shader instancedShader((shaders + "vertexInstanced.glsl").c_str(),
+                         (shaders + "fragment.glsl").c_str());
+  Shader instancedSingleColor((shaders + "vertexInstanced.glsl").c_str(),
+                              (shaders + "shaderSingleColor.glsl").c_str());
+
+  unsigned int cubeVAO, cubeVBO;
+  glGenVertexArrays(1, &cubeVAO);
+  glGenBuffers(1, &cubeVBO);
+  glState().bindVertexArray(cubeVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices,
+               GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
+                        (void*)(3 * sizeof(float)));
+  glState().bindVertexArray(0);
+
+  OutlineRenderer outline({cubeVBO, 0, 36, 5 * sizeof(float),
+                           3 * sizeof(float)});
+  JumpFloodOutline jumpFlood(bench::rootPath("src/shaders"));
+  jumpFlood.resize(800, 600);
+  jumpFlood.setWidth(static_cast<float>(outlineWidth));
+
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 25.0f), glm::vec3(0.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+                                          800.0f / 600.0f, 0.1f, 100.0f);
+  FrameUniforms frameUniforms; //camera for all four programs
+  frameUniforms.update(view, projection, 0.0f);
+  UniformHandle shaderModel = shader.uniform("model");
+  UniformHandle singleColorModel = singleColorShader.uniform("model");
+  const float scaler = 1.1f;
+
+  std::printf("%8s %14s %14s %14s\n", "objects", "per-object ms",
+              "instanced ms", "jump flood ms");
+  for (size_t count{1}; count <= static_cast<size_t>(maxObjects);
+       count *= 10) {
+    std::vector<glm::mat4> transforms = gridTransforms(count);
+    std::vector<glm::mat4> scaled;
+    scaled.reserve(count);
+    for (const glm::mat4 &m : transforms) {
+      scaled.push_back(glm::scale(m, glm::vec3(scaler)));
+    }
+
+    //per object: the way main.cpp drew its two cubes before
+    glFinish();
+    bench::Clock::time_point start = bench::Clock::now();
+    for (int frame{}; frame < frames; ++frame) {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
+              GL_STENCIL_BUFFER_BIT);
+      glState().bindVertexArray(cubeVAO);
+      glState().stencilFunc(GL_ALWAYS, 1, 0xFF);
+      glState().stencilMask(0xFF);
+      shader.use();
+      for (const glm::mat4 &m : transforms) {
+        shader.setMat4(shaderModel, m);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+      }
+      glState().stencilFunc(GL_NOTEQUAL, 1, 0xFF);
+      glState().stencilMask(0x00);
+      glState().disable(GL_DEPTH_TEST);
+      singleColorShader.use();
+      for (const glm::mat4 &m : scaled) {
+        singleColorShader.setMat4(singleColorModel, m);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+      }
+      glState().stencilMask(0xFF);
+      glState().stencilFunc(GL_ALWAYS, 0, 0xFF);
+      glState().enable(GL_DEPTH_TEST);
+    }
+    glFinish();
+    double perObjectMs = bench::msSince(start) / frames;
+
+    //instanced; the selection upload is part of every frame on purpose
+    start = bench::Clock::now();
+    for (int frame{}; frame < frames; ++frame) {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
+              GL_STENCIL_BUFFER_BIT);
+      outline.beginInstances(transforms.size());
+      outline.writeInstances(0, transforms.data(), transforms.size());
+      outline.drawObjects(instancedShader);
+      outline.drawOutline(instancedSingleColor, scaler);
+    }
+    glFinish();
+    double instancedMs = bench::msSince(start) / frames;
+
+    //screen space: same object pass, outline from its stencil
+    start = bench::Clock::now();
+    for (int frame{}; frame < frames; ++frame) {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
+              GL_STENCIL_BUFFER_BIT);
+      outline.beginInstances(transforms.size());
+      outline.writeInstances(0, transforms.data(), transforms.size());
+      outline.drawObjects(instancedShader);
+      jumpFlood.draw(outline, context.target().fbo());
+      glState().stencilFunc(GL_ALWAYS, 0, 0xFF);
+    }
+    glFinish();
+    double jumpFloodMs = bench::msSince(start) / frames;
+
+    std::printf("%8zu %14.3f %14.3f %14.3f\n", count, perObjectMs,
+                instancedMs, jumpFloodMs);
+  }
+
+  glDeleteBuffers(1, &cubeVBO);
+  glState().deleteVertexArrays(1, &cubeVAO);
+  return 0;
+}
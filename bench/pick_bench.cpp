@@ -0,0 +1,124 @@
+//ray picking latency on a model: rays through random pixels of an 800x600
+//view of it, first straight into its PackedTriangles (scalar vs SIMD
+//Moller-Trumbore, which must agree), then through a Picker holding one copy
+//or a grid of copies, where the Bvh narrows each ray down to a few objects
+//before any triangle is tested. needs GL only to load the model.
+//
+//  pick_bench [--model=path/to/model.obj] [--rays=2000] [--objects=100]
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "model.h"
+#include "picking.h"
+#include "stb_image.h"
+
+static void print(const char *name, size_t objects,
+                  const std::vector<double> &us, size_t hits) {
+  std::printf("%-8s %8zu %9.2f %9.2f %9.2f %7zu\n", name, objects,
+              bench::percentile(us, 50), bench::percentile(us, 99),
+              bench::percentile(us, 100), hits);
+}
+
+int main(int argc, char *argv[]) {
+  std::string path = bench::stringArg(argc, argv, "model",
+    bench::rootPath("models/backpack/backpack.obj"));
+  int rays = bench::intArg(argc, argv, "rays", 2000);
+  int gridObjects = bench::intArg(argc, argv, "objects", 100);
+
+  bench::GLContext context;
+  stbi_set_flip_vertically_on_load(true);
+  ModelLoadOptions options;
+  options.keepCpuData = false;
+  options.pickable = true;
+  Model model(path, options);
+  const PackedTriangles &triangles = model.pickTriangles();
+  std::printf("%s: %zu triangles in %zu meshes, %zu lanes\n", path.c_str(),
+              triangles.triangleCount(), triangles.meshCount(),
+              PackedTriangles::PICK_LANES);
+
+  //camera backed off far enough to fit the model's box in view
+  const Aabb &box = model.boundingBox();
+  float radius = glm::length(box.extent());
+  glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+                                          800.0f / 600.0f, 0.1f, 1000.0f);
+  glm::mat4 view = glm::lookAt(
+    box.center() + glm::vec3(0.0f, 0.0f, radius * 2.5f), box.center(),
+    glm::vec3(0.0f, 1.0f, 0.0f));
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> pixelX(0.0f, 800.0f);
+  std::uniform_real_distribution<float> pixelY(0.0f, 600.0f);
+  std::vector<Ray> pixelRays(rays);
+  for (Ray &ray : pixelRays) {
+    ray = rayFromScreen(pixelX(rng), pixelY(rng), 800, 600, view, projection);
+  }
+
+  //kernel only: every triangle of the model against every ray
+  std::vector<double> scalarUs, simdUs;
+  size_t kernelHits{};
+  for (const Ray &ray : pixelRays) {
+    float scalarT = 1e30f, simdT = 1e30f;
+    uint32_t scalarTriangle{}, simdTriangle{};
+    bench::Clock::time_point start = bench::Clock::now();
+    bool scalarHit = triangles.intersectScalar(ray.origin, ray.direction,
+                                               scalarT, scalarTriangle);
+    scalarUs.push_back(bench::msSince(start) * 1000.0);
+    start = bench::Clock::now();
+    bool simdHit = triangles.intersect(ray.origin, ray.direction, simdT,
+                                       simdTriangle);
+    simdUs.push_back(bench::msSince(start) * 1000.0);
+    //the two may round differently right on a shared edge
+    if (scalarHit != simdHit
+        || (simdHit && std::abs(scalarT - simdT) > 1e-4f * scalarT)) {
+      std::printf("MISMATCH: scalar %d (%f) simd %d (%f)\n", scalarHit,
+                  scalarT, simdHit, simdT);
+      return 1;
+    }
+    kernelHits += simdHit;
+  }
+
+  std::printf("%-8s %8s %9s %9s %9s %7s\n", "path", "objects", "p50 us",
+              "p99 us", "max us", "hits");
+  print("scalar", 1, scalarUs, kernelHits);
+  print("simd", 1, simdUs, kernelHits);
+
+  //through a Picker: one model, then a grid of copies seen from further back
+  for (int count : {1, gridObjects}) {
+    Picker picker;
+    int side = static_cast<int>(std::ceil(std::sqrt(count)));
+    float spacing = radius * 2.2f;
+    for (int i{}; i < count; ++i) {
+      glm::vec3 offset((i % side - (side - 1) / 2.0f) * spacing,
+                       (i / side - (side - 1) / 2.0f) * spacing, 0.0f);
+      picker.addObject(&triangles,
+                       glm::translate(glm::mat4(1.0f), offset));
+    }
+    glm::mat4 gridView = glm::lookAt(
+      box.center() + glm::vec3(0.0f, 0.0f, radius * 2.5f * side),
+      box.center(), glm::vec3(0.0f, 1.0f, 0.0f));
+    PickHit hit;
+    picker.pick(pixelRays[0], hit); //builds the tree
+
+    std::vector<double> pickUs;
+    size_t hits{};
+    for (int i{}; i < rays; ++i) {
+      Ray ray = rayFromScreen(pixelX(rng), pixelY(rng), 800, 600, gridView,
+                              projection);
+      bench::Clock::time_point start = bench::Clock::now();
+      hits += picker.pick(ray, hit);
+      pickUs.push_back(bench::msSince(start) * 1000.0);
+    }
+    print("picker", count, pickUs, hits);
+    if (count == gridObjects) {
+      break;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,132 @@
+//CPU frame time of the demo scene with 50k spinning cubes (every other one
+//outlined) as the number of record threads grows from 1 to the core count:
+//recording alone (model matrices, culling, instance lists on the workers),
+//a serial frame (record, wait, submit) and a pipelined one (record frame
+//N + 1 while the GL thread submits frame N). GPU work is finished outside
+//the timed part, so the columns are what the CPU spends per frame.
+//
+//  record_bench [--objects=50000] [--frames=60] [--threads=<cores>]
+//               [--size=320x180]
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_common.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "job_system.h"
+#include "scene.h"
+#include "stb_image.h"
+
+//count cubes in a grid covering the floor
+static std::vector<glm::mat4> grid(int count) {
+  int side = static_cast<int>(std::ceil(std::sqrt(double(count))));
+  std::vector<glm::mat4> transforms;
+  transforms.reserve(count);
+  for (int i{}; i < count; ++i) {
+    glm::vec3 pos(-4.5f + 9.0f * (i % side) / side, 0.01f,
+                  -4.5f + 9.0f * (i / side) / side);
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), pos);
+    transforms.push_back(glm::scale(model, glm::vec3(4.0f / side)));
+  }
+  return transforms;
+}
+
+int main(int argc, char *argv[]) {
+  int objects = bench::intArg(argc, argv, "objects", 50000);
+  int frames = bench::intArg(argc, argv, "frames", 60);
+  int maxThreads = bench::intArg(argc, argv, "threads",
+    static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+  std::string size = bench::stringArg(argc, argv, "size", "320x180");
+  int width = 320, height = 180;
+  std::sscanf(size.c_str(), "%dx%d", &width, &height);
+
+  bench::GLContext context(width, height);
+  stbi_set_flip_vertically_on_load(true);
+  unsigned int fbo = context.target().fbo();
+  std::vector<glm::mat4> transforms = grid(objects);
+  glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+                                          (float)width / (float)height,
+                                          0.1f, 100.0f);
+  auto viewAt = [](int frame) {
+    float angle = frame * 0.01f;
+    return glm::lookAt(glm::vec3(7.0f * std::sin(angle), 5.0f,
+                                 7.0f * std::cos(angle)),
+                       glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+  };
+
+  std::vector<int> threadCounts;
+  for (int threads{1}; threads < maxThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  std::printf("%d objects, %d frames, %dx%d\n", objects, frames, width,
+              height);
+  std::printf("%8s %10s %10s %12s %9s\n", "threads", "record ms",
+              "serial ms", "pipelined ms", "speedup");
+  double baseline{};
+  for (int threads : threadCounts) {
+    JobSystem jobs(static_cast<unsigned int>(threads));
+    Scene scene(DEPTHGL_ROOT, jobs);
+    scene.resize(width, height);
+    scene.setSelection(transforms);
+    for (int i{1}; i < objects; i += 2) {
+      scene.setSelected(i, false);
+    }
+    scene.setSpin(1.0f);
+    int frame{};
+    auto next = [&]() {
+      scene.setTime(frame * (1.0f / 60.0f));
+      return viewAt(frame++);
+    };
+    scene.render(next(), projection, fbo); //warm up
+    glFinish();
+
+    //recording only; submitted untimed
+    std::vector<double> recordMs, serialMs, pipelinedMs;
+    for (int i{}; i < frames; ++i) {
+      glm::mat4 view = next();
+      bench::Clock::time_point start = bench::Clock::now();
+      scene.record(view, projection);
+      scene.finishRecording();
+      recordMs.push_back(bench::msSince(start));
+      scene.submit(fbo);
+      glFinish();
+    }
+
+    for (int i{}; i < frames; ++i) {
+      glm::mat4 view = next();
+      bench::Clock::time_point start = bench::Clock::now();
+      scene.render(view, projection, fbo);
+      serialMs.push_back(bench::msSince(start));
+      glFinish();
+    }
+
+    scene.record(next(), projection);
+    for (int i{}; i < frames; ++i) {
+      glm::mat4 view = next();
+      bench::Clock::time_point start = bench::Clock::now();
+      scene.record(view, projection);
+      scene.submit(fbo); //the frame before this one
+      pipelinedMs.push_back(bench::msSince(start));
+      glFinish();
+    }
+    scene.submit(fbo);
+    glFinish();
+
+    double serial = bench::percentile(serialMs, 50);
+    double pipelined = bench::percentile(pipelinedMs, 50);
+    if (baseline == 0.0) {
+      baseline = serial;
+    }
+    std::printf("%8d %10.2f %10.2f %12.2f %8.2fx\n", threads,
+                bench::percentile(recordMs, 50), serial, pipelined,
+                baseline / pipelined);
+  }
+  return 0;
+}
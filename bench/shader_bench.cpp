@@ -0,0 +1,111 @@
+//startup cost of building every program the scene and the JFA outline use:
+//straight from source, from source while filling an empty program binary
+//cache, and from a warm cache.
+//
+//  shader_bench [--runs=10] [--cache=dir]
+//
+//drivers often keep their own shader cache (Mesa: MESA_SHADER_CACHE_DISABLE=1
+//turns it off), which makes the source path look cheaper than a first run
+//on a clean machine really is.
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench_common.h"
+#include "program_cache.h"
+#include "shader.h"
+
+namespace fs = std::filesystem;
+
+static const std::pair<const char *, const char *> PROGRAMS[] = {
+  {"vertex.glsl", "fragment.glsl"},
+  {"vertexInstanced.glsl", "fragment.glsl"},
+  {"vertexInstanced.glsl", "shaderSingleColor.glsl"},
+  {"fullscreen.glsl", "jfaSeed.glsl"},
+  {"fullscreen.glsl", "jfaStep.glsl"},
+  {"fullscreen.glsl", "jfaComposite.glsl"},
+};
+
+struct BuildSamples {
+  std::vector<double> total, compile, link, binaryLoad, binaryStore;
+  unsigned int hits{}, programs{};
+};
+
+static void buildAll(BuildSamples &out) {
+  std::string shaderDir = bench::rootPath("src/shaders");
+  Shader::resetBuildStats();
+  bench::Clock::time_point start = bench::Clock::now();
+  {
+    std::vector<std::unique_ptr<Shader>> shaders;
+    for (const auto &program : PROGRAMS) {
+      shaders.push_back(std::make_unique<Shader>(
+        (shaderDir + "/" + program.first).c_str(),
+        (shaderDir + "/" + program.second).c_str()));
+    }
+    glFinish();
+  }
+  const ShaderBuildStats &stats = Shader::buildStats();
+  out.total.push_back(bench::msSince(start));
+  out.compile.push_back(stats.compileMs);
+  out.link.push_back(stats.linkMs);
+  out.binaryLoad.push_back(stats.binaryLoadMs);
+  out.binaryStore.push_back(stats.binaryStoreMs);
+  out.hits += stats.cacheHits;
+  out.programs += stats.programs;
+}
+
+static void report(const char *label, const BuildSamples &s) {
+  std::printf("%-8s total %8.2f  compile %8.2f  link %8.2f  "
+              "binary load %7.2f  binary store %7.2f  (median ms)  "
+              "hits %u/%u\n",
+              label,
+              bench::percentile(s.total, 50),
+              bench::percentile(s.compile, 50),
+              bench::percentile(s.link, 50),
+              bench::percentile(s.binaryLoad, 50),
+              bench::percentile(s.binaryStore, 50),
+              s.hits, s.programs);
+}
+
+int main(int argc, char *argv[]) {
+  int runs = bench::intArg(argc, argv, "runs", 10);
+  std::string cacheDir = bench::stringArg(argc, argv, "cache",
+    (fs::temp_directory_path() / "depthgl_shader_bench").string());
+
+  bench::GLContext context;
+  if (!ProgramCache::setDirectory(cacheDir)) {
+    std::cout << "driver has no program binary support, nothing to compare"
+              << std::endl;
+    return 1;
+  }
+
+  BuildSamples source, cold, warm;
+  for (int run{}; run < runs; ++run) {
+    ProgramCache::setDirectory("");
+    buildAll(source);
+
+    std::error_code ec;
+    fs::remove_all(cacheDir, ec);
+    ProgramCache::setDirectory(cacheDir);
+    buildAll(cold);
+    buildAll(warm);
+  }
+  fs::remove_all(cacheDir);
+
+  const char *renderer =
+    reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+  std::printf("%zu programs, %d runs, %s\n",
+              sizeof(PROGRAMS) / sizeof(PROGRAMS[0]), runs,
+              renderer ? renderer : "?");
+  report("source", source);
+  report("cold", cold);
+  report("warm", warm);
+  return 0;
+}
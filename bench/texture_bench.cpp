@@ -0,0 +1,139 @@
+//GPU size and load time of every image in textures/ (plus the backpack's):
+//decoded with stb_image and uploaded as GL_RGB(A)8 with glGenerateMipmap vs.
+//loaded through TextureCache from a block compressed DDS (see tools/texconv)
+//next to the image: the check that the DDS still matches its source, the
+//read and the level by level glCompressedTexImage2D. the images are copied
+//into --cache and their DDS files encoded there up front so the source tree
+//stays untouched; encoding time isn't counted. "hash ms" is what the
+//staleness check costs when size and mtime don't match and it has to hash
+//the source.
+//
+//  texture_bench [--runs=5] [--cache=/tmp/depthgl_texture_bench]
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "block_compress.h"
+#include "dds.h"
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "stb_image.h"
+#include "texture_cache.h"
+#include "texture_loader.h"
+
+namespace fs = std::filesystem;
+
+int main(int argc, char *argv[]) {
+  int runs = bench::intArg(argc, argv, "runs", 5);
+  fs::path cacheDir = bench::stringArg(argc, argv, "cache",
+    (fs::temp_directory_path() / "depthgl_texture_bench").string());
+
+  bench::GLContext context;
+  stbi_set_flip_vertically_on_load(true);
+  if (!glext.textureS3tc) {
+    std::printf("driver has no EXT_texture_compression_s3tc; BC1/BC3 "
+                "uploads will be skipped\n");
+  }
+
+  std::vector<std::string> sources;
+  for (const char *dir : {"textures", "models/backpack"}) {
+    std::error_code ec;
+    for (const fs::directory_entry &entry :
+         fs::directory_iterator(bench::rootPath(dir), ec)) {
+      std::string ext = entry.path().extension().string();
+      if (ext == ".png" || ext == ".jpg") {
+        sources.push_back(entry.path().string());
+      }
+    }
+  }
+  fs::create_directories(cacheDir);
+
+  std::printf("%-24s %11s %9s %9s  %-4s %9s %9s %9s %9s\n", "texture",
+              "size", "raw KiB", "raw ms", "bc", "bc KiB", "bc ms", "hash ms",
+              "disk KiB");
+  TextureCache &cache = TextureCache::instance();
+  size_t rawTotal{}, bcTotal{};
+  double rawMsTotal{}, bcMsTotal{};
+  for (const std::string &source : sources) {
+    int width, height, channels;
+    unsigned char *rgba = stbi_load(source.c_str(), &width, &height,
+                                    &channels, 4);
+    if (!rgba) {
+      continue;
+    }
+    BlockFormat format = pickBlockFormat(rgba, width, height);
+    fs::path copyPath = cacheDir / fs::path(source).filename();
+    std::error_code copyError;
+    fs::copy_file(source, copyPath, fs::copy_options::overwrite_existing,
+                  copyError);
+    std::string ddsPath = fs::path(copyPath).replace_extension(".dds")
+      .string();
+    DdsSourceStamp stamp;
+    stampDdsSource(copyPath.string(), stamp);
+    CompressedImage compressed = compressImage(rgba, width, height, format,
+                                               true);
+    writeDds(ddsPath, compressed, &stamp);
+    stbi_image_free(rgba);
+    size_t bcBytes = compressedImageBytes(compressed);
+
+    std::vector<double> rawMs, bcMs, hashMs;
+    size_t rawBytes{};
+    for (int run{}; run < runs; ++run) {
+      unsigned int id;
+      {
+        bench::Clock::time_point start = bench::Clock::now();
+        unsigned char *pixels = stbi_load(source.c_str(), &width, &height,
+                                          &channels, 0);
+        glGenTextures(1, &id);
+        uploadTexture2D(id, pixels, width, height, channels);
+        glFinish();
+        rawMs.push_back(bench::msSince(start));
+        stbi_image_free(pixels);
+        glState().deleteTextures(1, &id);
+        rawBytes = static_cast<size_t>(width) * height * channels * 4 / 3;
+      }
+      {
+        //the handle is the only one, so every run misses and loads again
+        size_t residentBefore = cache.stats().residentBytes;
+        bench::Clock::time_point start = bench::Clock::now();
+        SharedTexture texture = cache.acquire(copyPath.string());
+        glFinish();
+        double ms = bench::msSince(start);
+        //anything else means it fell back to decoding the image
+        bool uploaded =
+          cache.stats().residentBytes - residentBefore == bcBytes;
+        bcMs.push_back(uploaded ? ms : 0.0);
+      }
+      {
+        bench::Clock::time_point start = bench::Clock::now();
+        hashDdsSource(copyPath.string());
+        hashMs.push_back(bench::msSince(start));
+      }
+    }
+
+    std::error_code ec;
+    uintmax_t diskBytes = fs::file_size(ddsPath, ec);
+    double rawMedian = bench::percentile(rawMs, 50);
+    double bcMedian = bench::percentile(bcMs, 50);
+    std::printf("%-24s %5dx%-5d %9zu %9.2f  %-4s %9zu %9.2f %9.2f %9ju\n",
+                fs::path(source).filename().string().c_str(), width, height,
+                rawBytes / 1024, rawMedian, blockFormatName(format),
+                bcBytes / 1024, bcMedian, bench::percentile(hashMs, 50),
+                ec ? uintmax_t{} : diskBytes / 1024);
+    rawTotal += rawBytes;
+    bcTotal += bcBytes;
+    rawMsTotal += rawMedian;
+    bcMsTotal += bcMedian;
+  }
+
+  std::printf("total: %zu KiB in %.2f ms uncompressed, %zu KiB in %.2f ms "
+              "block compressed (%.1fx smaller)\n",
+              rawTotal / 1024, rawMsTotal, bcTotal / 1024, bcMsTotal,
+              bcTotal ? static_cast<double>(rawTotal) / bcTotal : 0.0);
+  return 0;
+}
@@ -0,0 +1,96 @@
+//vertex buffer size, upload time and draw time of a model with the full
+//float32 Vertex layout vs. Mesh's VERTEX_COMPACT quantized layout. every
+//vertex is fetched at least once per draw, so the buffer size is also the
+//floor on vertex fetch bandwidth per frame. index buffer sizes are printed
+//too; both layouts get Mesh's automatic 8/16 bit indices.
+//
+//  vertex_bench [--model=path/to/model.obj] [--frames=200] [--runs=3]
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "frame_uniforms.h"
+#include "gl_state.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "model.h"
+#include "shader.h"
+#include "stb_image.h"
+
+struct FormatResult {
+  size_t vertexBytes{}, indexBytes{};
+  std::vector<double> uploadMs, frameMs;
+};
+
+static void run(const std::string &path, VertexFormat format, Shader &shader,
+                int frames, FormatResult &result) {
+  ModelLoadOptions options;
+  options.keepCpuData = false;
+  options.vertexFormat = format;
+  Model model(path, options);
+  result.vertexBytes = model.vertexBytes();
+  result.indexBytes = model.indexBytes();
+  result.uploadMs.push_back(model.loadTimings().uploadMs);
+
+  FrameUniforms frameUniforms;
+  frameUniforms.update(glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f),
+                                   glm::vec3(0.0f), glm::vec3(0, 1, 0)),
+                       glm::perspective(glm::radians(45.0f), 800.0f / 600.0f,
+                                        0.1f, 100.0f), 0.0f);
+  shader.use();
+  shader.setMat4("model", glm::mat4(1.0f));
+  model.Draw(shader); //warm up
+  glFinish();
+  bench::Clock::time_point start = bench::Clock::now();
+  for (int frame{}; frame < frames; ++frame) {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    model.Draw(shader);
+  }
+  glFinish();
+  result.frameMs.push_back(bench::msSince(start) / frames);
+}
+
+int main(int argc, char *argv[]) {
+  std::string path = bench::stringArg(argc, argv, "model",
+    bench::rootPath("models/backpack/backpack.obj"));
+  int frames = bench::intArg(argc, argv, "frames", 200);
+  int runs = bench::intArg(argc, argv, "runs", 3);
+
+  bench::GLContext context;
+  glState().enable(GL_DEPTH_TEST);
+  stbi_set_flip_vertically_on_load(true);
+  std::string vertexPath = bench::rootPath("src/shaders/vertex.glsl");
+  std::string fragmentPath = bench::rootPath("src/shaders/fragment.glsl");
+  Shader fullShader(vertexPath.c_str(), fragmentPath.c_str());
+  Shader compactShader(vertexPath.c_str(), fragmentPath.c_str(),
+                       {"COMPACT_VERTICES"});
+  {
+    Model primer(path); //warm the mesh cache so only the upload differs
+  }
+
+  FormatResult full, compact;
+  for (int i{}; i < runs; ++i) {
+    run(path, VERTEX_FULL, fullShader, frames, full);
+    run(path, VERTEX_COMPACT, compactShader, frames, compact);
+  }
+
+  std::printf("%s, %d runs x %d frames (median ms)\n", path.c_str(), runs,
+              frames);
+  std::printf("full     %3zu B/vertex  %8zu KiB  upload %8.2f  frame %8.3f\n",
+              vertexStride(VERTEX_FULL), full.vertexBytes / 1024,
+              bench::percentile(full.uploadMs, 50),
+              bench::percentile(full.frameMs, 50));
+  std::printf("compact  %3zu B/vertex  %8zu KiB  upload %8.2f  frame %8.3f\n",
+              vertexStride(VERTEX_COMPACT), compact.vertexBytes / 1024,
+              bench::percentile(compact.uploadMs, 50),
+              bench::percentile(compact.frameMs, 50));
+  std::printf("indices  %8zu KiB\n", full.indexBytes / 1024);
+  if (compact.vertexBytes != 0) {
+    std::printf("vertex memory and fetch per frame: %.2fx smaller\n",
+                static_cast<double>(full.vertexBytes) / compact.vertexBytes);
+  }
+  return 0;
+}
@@ -0,0 +1,327 @@
+#include "block_compress.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+size_t blockBytes(BlockFormat format) {
+  return format == BLOCK_BC1 ? 8 : 16;
+}
+
+const char *blockFormatName(BlockFormat format) {
+  switch (format) {
+    case BLOCK_BC1:
+      return "BC1";
+    case BLOCK_BC3:
+      return "BC3";
+    case BLOCK_BC5:
+      return "BC5";
+  }
+  return "?";
+}
+
+// ==============================BC4 (one channel)=============================
+//8 value mode only: endpoints are the block's max and min, the six values in
+//between are interpolated. out gets 8 bytes
+static void encodeChannelBlock(const unsigned char values[16],
+                               unsigned char *out) {
+  unsigned char hi = *std::max_element(values, values + 16);
+  unsigned char lo = *std::min_element(values, values + 16);
+  out[0] = hi;
+  out[1] = lo;
+
+  int palette[8] = {hi, lo};
+  for (int i{1}; i < 7; ++i) {
+    palette[i + 1] = ((7 - i) * hi + i * lo) / 7;
+  }
+  uint64_t bits{};
+  for (int t{}; t < 16; ++t) {
+    int best{}, bestError{256};
+    if (hi != lo) {
+      for (int i{}; i < 8; ++i) {
+        int error = std::abs(palette[i] - values[t]);
+        if (error < bestError) {
+          bestError = error;
+          best = i;
+        }
+      }
+    }
+    bits |= uint64_t(best) << (3 * t);
+  }
+  for (int i{}; i < 6; ++i) {
+    out[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+  }
+}
+
+// ==============================BC1 (colour)==================================
+static uint16_t packColor565(const float c[3]) {
+  auto quantize = [](float v, int maxValue) {
+    int q = static_cast<int>(std::lround(v / 255.0f * maxValue));
+    return std::clamp(q, 0, maxValue);
+  };
+  return static_cast<uint16_t>((quantize(c[0], 31) << 11)
+                               | (quantize(c[1], 63) << 5)
+                               | quantize(c[2], 31));
+}
+
+static void unpackColor565(uint16_t packed, int out[3]) {
+  int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+  out[0] = (r << 3) | (r >> 2);
+  out[1] = (g << 2) | (g >> 4);
+  out[2] = (b << 3) | (b >> 2);
+}
+
+//picks the nearest of the 4 colour mode palette entries for every texel;
+//returns the total squared error
+static int assignIndices(const int texels[16][3], uint16_t c0, uint16_t c1,
+                         int indices[16]) {
+  int palette[4][3];
+  unpackColor565(c0, palette[0]);
+  unpackColor565(c1, palette[1]);
+  for (int k{}; k < 3; ++k) {
+    palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+    palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+  }
+  int total{};
+  for (int t{}; t < 16; ++t) {
+    int best{}, bestError{1 << 30};
+    for (int i{}; i < 4; ++i) {
+      int error{};
+      for (int k{}; k < 3; ++k) {
+        int d = palette[i][k] - texels[t][k];
+        error += d * d;
+      }
+      if (error < bestError) {
+        bestError = error;
+        best = i;
+      }
+    }
+    indices[t] = best;
+    total += bestError;
+  }
+  return total;
+}
+
+//endpoints along the principal axis of the block's colours, then one least
+//squares refit against the indices they produce. always emits 4 colour mode
+//(c0 > c1), which is what BC3 requires and BC1 needs for opaque blocks.
+//out gets 8 bytes
+static void encodeColorBlock(const int texels[16][3], unsigned char *out) {
+  float mean[3]{};
+  for (int t{}; t < 16; ++t) {
+    for (int k{}; k < 3; ++k) {
+      mean[k] += texels[t][k] / 16.0f;
+    }
+  }
+  float cov[6]{}; //xx xy xz yy yz zz
+  for (int t{}; t < 16; ++t) {
+    float d[3] = {texels[t][0] - mean[0], texels[t][1] - mean[1],
+                  texels[t][2] - mean[2]};
+    cov[0] += d[0] * d[0];
+    cov[1] += d[0] * d[1];
+    cov[2] += d[0] * d[2];
+    cov[3] += d[1] * d[1];
+    cov[4] += d[1] * d[2];
+    cov[5] += d[2] * d[2];
+  }
+  //power iteration; a handful of steps is plenty for a 3x3
+  float axis[3] = {1.0f, 1.0f, 1.0f};
+  for (int iteration{}; iteration < 8; ++iteration) {
+    float next[3] = {
+      cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+      cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+      cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+    float length = std::sqrt(next[0] * next[0] + next[1] * next[1]
+                             + next[2] * next[2]);
+    if (length < 1e-6f) {
+      break; //flat block: any axis works
+    }
+    for (int k{}; k < 3; ++k) {
+      axis[k] = next[k] / length;
+    }
+  }
+
+  float lo{}, hi{};
+  for (int t{}; t < 16; ++t) {
+    float p{};
+    for (int k{}; k < 3; ++k) {
+      p += (texels[t][k] - mean[k]) * axis[k];
+    }
+    lo = std::min(lo, p);
+    hi = std::max(hi, p);
+  }
+  //pull the ends in a little: the extremes are rarely worth an endpoint
+  float inset = (hi - lo) / 16.0f;
+  lo += inset;
+  hi -= inset;
+  float e0[3], e1[3];
+  for (int k{}; k < 3; ++k) {
+    e0[k] = mean[k] + axis[k] * hi;
+    e1[k] = mean[k] + axis[k] * lo;
+  }
+  uint16_t c0 = packColor565(e0), c1 = packColor565(e1);
+  int indices[16];
+  int error = assignIndices(texels, c0, c1, indices);
+
+  //least squares endpoints for those indices (weights along c0 -> c1)
+  static const float WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+  float aa{}, ab{}, bb{};
+  float ax[3]{}, bx[3]{};
+  for (int t{}; t < 16; ++t) {
+    float b = WEIGHTS[indices[t]], a = 1.0f - b;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for (int k{}; k < 3; ++k) {
+      ax[k] += a * texels[t][k];
+      bx[k] += b * texels[t][k];
+    }
+  }
+  float det = aa * bb - ab * ab;
+  if (std::fabs(det) > 1e-6f) {
+    float r0[3], r1[3];
+    for (int k{}; k < 3; ++k) {
+      r0[k] = std::clamp((ax[k] * bb - bx[k] * ab) / det, 0.0f, 255.0f);
+      r1[k] = std::clamp((bx[k] * aa - ax[k] * ab) / det, 0.0f, 255.0f);
+    }
+    uint16_t refined0 = packColor565(r0), refined1 = packColor565(r1);
+    int refinedIndices[16];
+    int refinedError = assignIndices(texels, refined0, refined1,
+                                     refinedIndices);
+    if (refinedError < error) {
+      c0 = refined0;
+      c1 = refined1;
+      error = refinedError;
+      std::memcpy(indices, refinedIndices, sizeof(indices));
+    }
+  }
+
+  if (c0 < c1) {
+    //same palette with the ends swapped: 0<->1, 2<->3
+    std::swap(c0, c1);
+    for (int &index : indices) {
+      index ^= 1;
+    }
+  } else if (c0 == c1) {
+    for (int &index : indices) {
+      index = 0;
+    }
+  }
+
+  uint32_t bits{};
+  for (int t{}; t < 16; ++t) {
+    bits |= uint32_t(indices[t]) << (2 * t);
+  }
+  out[0] = static_cast<unsigned char>(c0);
+  out[1] = static_cast<unsigned char>(c0 >> 8);
+  out[2] = static_cast<unsigned char>(c1);
+  out[3] = static_cast<unsigned char>(c1 >> 8);
+  for (int i{}; i < 4; ++i) {
+    out[4 + i] = static_cast<unsigned char>(bits >> (8 * i));
+  }
+}
+
+std::vector<unsigned char> encodeBlocks(const unsigned char *rgba, int width,
+                                        int height, BlockFormat format) {
+  int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+  size_t stride = blockBytes(format);
+  std::vector<unsigned char> out(static_cast<size_t>(blocksX) * blocksY
+                                 * stride);
+
+  for (int by{}; by < blocksY; ++by) {
+    for (int bx{}; bx < blocksX; ++bx) {
+      int texels[16][3];
+      unsigned char channel[4][16];
+      for (int t{}; t < 16; ++t) {
+        int x = std::min(bx * 4 + (t & 3), width - 1);
+        int y = std::min(by * 4 + (t >> 2), height - 1);
+        const unsigned char *p = rgba + (static_cast<size_t>(y) * width + x)
+          * 4;
+        for (int k{}; k < 4; ++k) {
+          channel[k][t] = p[k];
+        }
+        for (int k{}; k < 3; ++k) {
+          texels[t][k] = p[k];
+        }
+      }
+
+      unsigned char *block = out.data()
+        + (static_cast<size_t>(by) * blocksX + bx) * stride;
+      switch (format) {
+        case BLOCK_BC1:
+          encodeColorBlock(texels, block);
+          break;
+        case BLOCK_BC3:
+          encodeChannelBlock(channel[3], block);
+          encodeColorBlock(texels, block + 8);
+          break;
+        case BLOCK_BC5:
+          encodeChannelBlock(channel[0], block);
+          encodeChannelBlock(channel[1], block + 8);
+          break;
+      }
+    }
+  }
+  return out;
+}
+
+//2x2 box filter; odd dimensions fold the last row/column in twice
+static std::vector<unsigned char> downsample(const std::vector<unsigned char>
+                                               &src, int width, int height,
+                                             int &outWidth, int &outHeight) {
+  outWidth = std::max(1, width / 2);
+  outHeight = std::max(1, height / 2);
+  std::vector<unsigned char> dst(static_cast<size_t>(outWidth) * outHeight
+                                 * 4);
+  for (int y{}; y < outHeight; ++y) {
+    int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+    for (int x{}; x < outWidth; ++x) {
+      int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+      for (int k{}; k < 4; ++k) {
+        int sum = src[(static_cast<size_t>(y0) * width + x0) * 4 + k]
+          + src[(static_cast<size_t>(y0) * width + x1) * 4 + k]
+          + src[(static_cast<size_t>(y1) * width + x0) * 4 + k]
+          + src[(static_cast<size_t>(y1) * width + x1) * 4 + k];
+        dst[(static_cast<size_t>(y) * outWidth + x) * 4 + k] =
+          static_cast<unsigned char>((sum + 2) / 4);
+      }
+    }
+  }
+  return dst;
+}
+
+CompressedImage compressImage(const unsigned char *rgba, int width,
+                              int height, BlockFormat format, bool mipmaps) {
+  CompressedImage image;
+  image.format = format;
+  image.levels.push_back({width, height,
+                          encodeBlocks(rgba, width, height, format)});
+  if (!mipmaps) {
+    return image;
+  }
+
+  std::vector<unsigned char> level(rgba, rgba + static_cast<size_t>(width)
+                                   * height * 4);
+  while (width > 1 || height > 1) {
+    int nextWidth, nextHeight;
+    level = downsample(level, width, height, nextWidth, nextHeight);
+    width = nextWidth;
+    height = nextHeight;
+    image.levels.push_back({width, height,
+                            encodeBlocks(level.data(), width, height,
+                                         format)});
+  }
+  return image;
+}
+
+BlockFormat pickBlockFormat(const unsigned char *rgba, int width,
+                            int height) {
+  size_t count = static_cast<size_t>(width) * height;
+  for (size_t i{}; i < count; ++i) {
+    if (rgba[i * 4 + 3] != 255) {
+      return BLOCK_BC3;
+    }
+  }
+  return BLOCK_BC1;
+}
@@ -0,0 +1,43 @@
+#ifndef BLOCK_COMPRESS_H
+#define BLOCK_COMPRESS_H
+
+#include <cstddef>
+#include <vector>
+
+//CPU encoders for the block compressed formats GL can sample directly.
+//every format works on 4x4 texel blocks; partial blocks at the right/bottom
+//edge repeat the last row/column.
+enum BlockFormat {
+  BLOCK_BC1, //DXT1: opaque RGB, 8 bytes per block (4 bpp)
+  BLOCK_BC3, //DXT5: RGB + smooth alpha, 16 bytes per block (8 bpp)
+  BLOCK_BC5  //RGTC2/ATI2: two independent channels (eg normal map XY), 16
+             //bytes per block. z has to be rebuilt in the shader
+};
+
+//one mip level, blocks in row major order
+struct CompressedLevel {
+  int width, height;
+  std::vector<unsigned char> data;
+};
+
+struct CompressedImage {
+  BlockFormat format{BLOCK_BC1};
+  std::vector<CompressedLevel> levels; //0 = full size
+};
+
+size_t blockBytes(BlockFormat format);
+const char *blockFormatName(BlockFormat format);
+
+//encodes one RGBA8 level
+std::vector<unsigned char> encodeBlocks(const unsigned char *rgba, int width,
+                                        int height, BlockFormat format);
+
+//box filters a full mip chain (down to 1x1 when mipmaps is set) and encodes
+//every level of it
+CompressedImage compressImage(const unsigned char *rgba, int width,
+                              int height, BlockFormat format, bool mipmaps);
+
+//BC3 if any texel isn't fully opaque, else BC1
+BlockFormat pickBlockFormat(const unsigned char *rgba, int width, int height);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <cmath>
+#include <limits>
+
+#include "glm/glm.hpp"
+
+//axis aligned box. default constructed it's empty (min > max), and growing
+//an empty box by a point gives that point
+struct Aabb {
+  glm::vec3 min{std::numeric_limits<float>::max()};
+  glm::vec3 max{-std::numeric_limits<float>::max()};
+
+  bool empty() const {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+  }
+  void grow(const glm::vec3 &point) {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+  }
+  void grow(const Aabb &other) {
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+  }
+  glm::vec3 center() const { return (min + max) * 0.5f; }
+  glm::vec3 extent() const { return (max - min) * 0.5f; }
+};
+
+struct BoundingSphere {
+  glm::vec3 center{0.0f};
+  float radius{-1.0f}; //negative: empty
+};
+
+//smallest box around box after transform (Arvo): the new extent on each
+//axis is the absolute matrix applied to the old one
+inline Aabb transformAabb(const Aabb &box, const glm::mat4 &transform) {
+  if (box.empty()) {
+    return box;
+  }
+  glm::vec3 center = glm::vec3(transform * glm::vec4(box.center(), 1.0f));
+  glm::vec3 extent = box.extent();
+  glm::vec3 newExtent(0.0f);
+  for (int column{}; column < 3; ++column) {
+    for (int row{}; row < 3; ++row) {
+      newExtent[row] += std::abs(transform[column][row]) * extent[column];
+    }
+  }
+  return {center - newExtent, center + newExtent};
+}
+
+#endif
@@ -0,0 +1,425 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <limits>
+
+//binned SAH: centroids are dropped into this many buckets per axis and
+//only the planes between buckets are tried
+static const int BVH_BINS = 16;
+//leaves this small are never split, leaves up to this big may stay leaves
+//if splitting doesn't pay
+static const uint32_t BVH_MIN_SPLIT = 2;
+static const uint32_t BVH_MAX_LEAF = 8;
+//cost of visiting a node relative to testing one object
+static const float BVH_TRAVERSAL_COST = 1.0f;
+//past this depth nodes are halved instead of SAH split, which caps the tree
+//at BVH_SAH_DEPTH + 32 levels however skewed the input is. the queries'
+//fixed size stacks rely on that
+static const int BVH_SAH_DEPTH = 56;
+static const int BVH_STACK_SIZE = 96;
+
+static float surfaceArea(const Aabb &box) {
+  if (box.empty()) {
+    return 0.0f;
+  }
+  glm::vec3 d = box.max - box.min;
+  return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+// ==============================BUILD=========================================
+void Bvh::build(const std::vector<Aabb> &bounds) {
+  uint32_t objectCount = static_cast<uint32_t>(bounds.size());
+  nodes.clear();
+  parents.clear();
+  items.resize(objectCount);
+  leafOf.assign(objectCount, 0);
+  objectBounds = bounds;
+  if (objectCount == 0) {
+    return;
+  }
+
+  //boxes and centroids travel with the indices while partitioning, so every
+  //pass over a node's objects reads memory front to back
+  struct BuildItem {
+    Aabb box;
+    glm::vec3 centroid;
+    uint32_t object;
+  };
+  std::vector<BuildItem> work(objectCount);
+  for (uint32_t i{}; i < objectCount; ++i) {
+    work[i] = {bounds[i], bounds[i].center(), i};
+  }
+
+  nodes.reserve(2 * objectCount);
+  parents.reserve(2 * objectCount);
+  nodes.push_back({glm::vec3(0.0f), 0, glm::vec3(0.0f), objectCount});
+  parents.push_back(0);
+
+  struct Bin {
+    Aabb box;
+    uint32_t count{};
+  };
+  struct Pending {
+    uint32_t node;
+    int depth;
+  };
+  std::vector<Pending> pending{{0, 0}};
+  while (!pending.empty()) {
+    uint32_t index = pending.back().node;
+    int depth = pending.back().depth;
+    pending.pop_back();
+    uint32_t first = nodes[index].leftFirst;
+    uint32_t count = nodes[index].count;
+
+    Aabb box, centroidBox;
+    for (uint32_t i = first; i < first + count; ++i) {
+      box.grow(work[i].box);
+      centroidBox.grow(work[i].centroid);
+    }
+    nodes[index].min = box.min;
+    nodes[index].max = box.max;
+    if (count <= BVH_MIN_SPLIT) {
+      continue;
+    }
+
+    //best plane over all three axes
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1, bestPlane{};
+    glm::vec3 centroidSize = centroidBox.max - centroidBox.min;
+    //one pass bins all three axes at once. small nodes get fewer bins:
+    //there are only so many ways to split a handful of objects, and most
+    //nodes are small
+    int binCount = static_cast<int>(std::min<uint32_t>(BVH_BINS, count));
+    Bin bins[3][BVH_BINS];
+    glm::vec3 scale(0.0f);
+    for (int axis{}; axis < 3; ++axis) {
+      if (centroidSize[axis] > 0.0f) {
+        scale[axis] = binCount / centroidSize[axis];
+      }
+    }
+    if (depth < BVH_SAH_DEPTH) {
+      for (uint32_t i = first; i < first + count; ++i) {
+        glm::vec3 offset = (work[i].centroid - centroidBox.min) * scale;
+        for (int axis{}; axis < 3; ++axis) {
+          Bin &bin = bins[axis][std::min(binCount - 1,
+                                         static_cast<int>(offset[axis]))];
+          ++bin.count;
+          bin.box.grow(work[i].box);
+        }
+      }
+    }
+    for (int axis{}; axis < 3 && depth < BVH_SAH_DEPTH; ++axis) {
+      if (centroidSize[axis] <= 0.0f) {
+        continue;
+      }
+      const Bin *axisBins = bins[axis];
+      //sweep from the right to get each plane's right side, then from the
+      //left to price it
+      float rightArea[BVH_BINS - 1];
+      uint32_t rightCount[BVH_BINS - 1];
+      Aabb sweep;
+      uint32_t sweepCount{};
+      for (int plane = binCount - 2; plane >= 0; --plane) {
+        sweep.grow(axisBins[plane + 1].box);
+        sweepCount += axisBins[plane + 1].count;
+        rightArea[plane] = surfaceArea(sweep);
+        rightCount[plane] = sweepCount;
+      }
+      sweep = Aabb();
+      sweepCount = 0;
+      for (int plane{}; plane < binCount - 1; ++plane) {
+        sweep.grow(axisBins[plane].box);
+        sweepCount += axisBins[plane].count;
+        if (sweepCount == 0 || rightCount[plane] == 0) {
+          continue;
+        }
+        float cost = sweepCount * surfaceArea(sweep)
+          + rightCount[plane] * rightArea[plane];
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestAxis = axis;
+          bestPlane = plane;
+        }
+      }
+    }
+
+    float area = surfaceArea(box);
+    float splitCost = area > 0.0f
+      ? BVH_TRAVERSAL_COST + bestCost / area
+      : std::numeric_limits<float>::max();
+    if (count <= BVH_MAX_LEAF && splitCost >= static_cast<float>(count)
+        && bestAxis >= 0) {
+      continue;
+    }
+
+    BuildItem *begin = work.data() + first;
+    BuildItem *middle;
+    if (bestAxis >= 0) {
+      float axisScale = scale[bestAxis];
+      float minimum = centroidBox.min[bestAxis];
+      middle = std::partition(begin, begin + count,
+                              [&](const BuildItem &item) {
+        int bin = std::min(binCount - 1, static_cast<int>(
+          (item.centroid[bestAxis] - minimum) * axisScale));
+        return bin <= bestPlane;
+      });
+    } else {
+      //every centroid in one spot (no plane separates them), or too deep
+      //already: halve the list
+      middle = begin + count / 2;
+    }
+    uint32_t leftCount = static_cast<uint32_t>(middle - begin);
+
+    uint32_t left = static_cast<uint32_t>(nodes.size());
+    nodes.push_back({glm::vec3(0.0f), first, glm::vec3(0.0f), leftCount});
+    nodes.push_back({glm::vec3(0.0f), first + leftCount, glm::vec3(0.0f),
+                     count - leftCount});
+    parents.push_back(index);
+    parents.push_back(index);
+    nodes[index].leftFirst = left;
+    nodes[index].count = 0;
+    pending.push_back({left + 1, depth + 1});
+    pending.push_back({left, depth + 1});
+  }
+
+  for (uint32_t i{}; i < objectCount; ++i) {
+    items[i] = work[i].object;
+  }
+  for (uint32_t n{}; n < nodes.size(); ++n) {
+    const BvhNode &node = nodes[n];
+    for (uint32_t i{}; i < node.count; ++i) {
+      leafOf[items[node.leftFirst + i]] = n;
+    }
+  }
+}
+
+// ==============================REFIT=========================================
+void Bvh::refitLeaf(BvhNode &node) {
+  Aabb box;
+  for (uint32_t i{}; i < node.count; ++i) {
+    box.grow(objectBounds[items[node.leftFirst + i]]);
+  }
+  node.min = box.min;
+  node.max = box.max;
+}
+
+void Bvh::refit(const std::vector<Aabb> &bounds) {
+  objectBounds = bounds;
+  for (size_t n = nodes.size(); n-- > 0;) {
+    BvhNode &node = nodes[n];
+    if (node.count != 0) {
+      refitLeaf(node);
+    } else {
+      const BvhNode &left = nodes[node.leftFirst];
+      const BvhNode &right = nodes[node.leftFirst + 1];
+      node.min = glm::min(left.min, right.min);
+      node.max = glm::max(left.max, right.max);
+    }
+  }
+}
+
+void Bvh::refit(const std::vector<Aabb> &bounds,
+                const std::vector<uint32_t> &changed) {
+  for (uint32_t object : changed) {
+    objectBounds[object] = bounds[object];
+  }
+  for (uint32_t object : changed) {
+    uint32_t n = leafOf[object];
+    refitLeaf(nodes[n]);
+    while (n != 0) {
+      n = parents[n];
+      BvhNode &node = nodes[n];
+      const BvhNode &left = nodes[node.leftFirst];
+      const BvhNode &right = nodes[node.leftFirst + 1];
+      glm::vec3 min = glm::min(left.min, right.min);
+      glm::vec3 max = glm::max(left.max, right.max);
+      if (min == node.min && max == node.max) {
+        break; //nothing above can change either
+      }
+      node.min = min;
+      node.max = max;
+    }
+  }
+}
+
+// ==============================QUERIES=======================================
+void Bvh::appendSubtree(uint32_t node, std::vector<uint32_t> &out) const {
+  uint32_t stack[BVH_STACK_SIZE];
+  int top{};
+  stack[top++] = node;
+  while (top > 0) {
+    const BvhNode &n = nodes[stack[--top]];
+    if (n.count != 0) {
+      out.insert(out.end(), items.begin() + n.leftFirst,
+                 items.begin() + n.leftFirst + n.count);
+    } else {
+      stack[top++] = n.leftFirst + 1;
+      stack[top++] = n.leftFirst;
+    }
+  }
+}
+
+size_t Bvh::queryFrustum(const Frustum &frustum,
+                         std::vector<uint32_t> &out) const {
+  size_t before = out.size();
+  if (nodes.empty()) {
+    return 0;
+  }
+  uint32_t stack[BVH_STACK_SIZE];
+  int top{};
+  stack[top++] = 0;
+  while (top > 0) {
+    uint32_t index = stack[--top];
+    const BvhNode &node = nodes[index];
+    glm::vec3 center = (node.min + node.max) * 0.5f;
+    glm::vec3 extent = (node.max - node.min) * 0.5f;
+    bool outside{false}, inside{true};
+    for (const glm::vec4 &plane : frustum.planes) {
+      glm::vec3 normal(plane);
+      float distance = glm::dot(normal, center) + plane.w;
+      float radius = glm::dot(glm::abs(normal), extent);
+      if (distance + radius < 0.0f) {
+        outside = true;
+        break;
+      }
+      if (distance - radius < 0.0f) {
+        inside = false;
+      }
+    }
+    if (outside) {
+      continue;
+    }
+    if (inside) {
+      appendSubtree(index, out); //no need to test anything below
+    } else if (node.count == 1) {
+      out.push_back(items[node.leftFirst]); //the leaf box is the object's
+    } else if (node.count != 0) {
+      for (uint32_t i{}; i < node.count; ++i) {
+        uint32_t object = items[node.leftFirst + i];
+        if (frustum.intersects(objectBounds[object])) {
+          out.push_back(object);
+        }
+      }
+    } else {
+      stack[top++] = node.leftFirst + 1;
+      stack[top++] = node.leftFirst;
+    }
+  }
+  return out.size() - before;
+}
+
+static bool overlaps(const glm::vec3 &min, const glm::vec3 &max,
+                     const Aabb &box) {
+  return !glm::any(glm::lessThan(max, box.min))
+    && !glm::any(glm::greaterThan(min, box.max));
+}
+
+size_t Bvh::queryOverlap(const Aabb &box, std::vector<uint32_t> &out) const {
+  size_t before = out.size();
+  if (nodes.empty() || box.empty()) {
+    return 0;
+  }
+  uint32_t stack[BVH_STACK_SIZE];
+  int top{};
+  stack[top++] = 0;
+  while (top > 0) {
+    const BvhNode &node = nodes[stack[--top]];
+    if (!overlaps(node.min, node.max, box)) {
+      continue;
+    }
+    if (node.count != 0) {
+      for (uint32_t i{}; i < node.count; ++i) {
+        uint32_t object = items[node.leftFirst + i];
+        const Aabb &objectBox = objectBounds[object];
+        if (overlaps(objectBox.min, objectBox.max, box)) {
+          out.push_back(object);
+        }
+      }
+    } else {
+      stack[top++] = node.leftFirst + 1;
+      stack[top++] = node.leftFirst;
+    }
+  }
+  return out.size() - before;
+}
+
+//slab test: distance to where the ray enters the box, or maxT if it doesn't
+//within [0, maxT)
+static float rayEnter(const glm::vec3 &min, const glm::vec3 &max,
+                      const glm::vec3 &origin,
+                      const glm::vec3 &inverseDirection, float maxT) {
+  glm::vec3 t0 = (min - origin) * inverseDirection;
+  glm::vec3 t1 = (max - origin) * inverseDirection;
+  glm::vec3 near = glm::min(t0, t1), far = glm::max(t0, t1);
+  float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+  float exit = std::min(std::min(far.x, far.y), far.z);
+  return enter <= exit && enter < maxT ? enter : maxT;
+}
+
+bool Bvh::raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                  BvhRayHit &hit, float maxT,
+                  const RayObjectTest &exact) const {
+  if (nodes.empty()) {
+    return false;
+  }
+  glm::vec3 inverseDirection = 1.0f / direction;
+  float closest = maxT;
+  bool found{false};
+
+  struct Entry {
+    uint32_t node;
+    float enter;
+  };
+  Entry stack[BVH_STACK_SIZE];
+  int top{};
+  float rootEnter = rayEnter(nodes[0].min, nodes[0].max, origin,
+                             inverseDirection, closest);
+  if (rootEnter < closest) {
+    stack[top++] = {0, rootEnter};
+  }
+  while (top > 0) {
+    Entry entry = stack[--top];
+    if (entry.enter >= closest) {
+      continue; //something closer turned up since this was pushed
+    }
+    const BvhNode &node = nodes[entry.node];
+    if (node.count != 0) {
+      for (uint32_t i{}; i < node.count; ++i) {
+        uint32_t object = items[node.leftFirst + i];
+        const Aabb &box = objectBounds[object];
+        float t = rayEnter(box.min, box.max, origin, inverseDirection,
+                           closest);
+        if (t >= closest) {
+          continue;
+        }
+        if (exact) {
+          t = closest;
+          if (!exact(object, t) || t >= closest) {
+            continue;
+          }
+        }
+        closest = t;
+        hit = {object, t};
+        found = true;
+      }
+      continue;
+    }
+    //near child on top so it's searched first
+    uint32_t left = node.leftFirst, right = node.leftFirst + 1;
+    float leftEnter = rayEnter(nodes[left].min, nodes[left].max, origin,
+                               inverseDirection, closest);
+    float rightEnter = rayEnter(nodes[right].min, nodes[right].max, origin,
+                                inverseDirection, closest);
+    if (leftEnter > rightEnter) {
+      std::swap(left, right);
+      std::swap(leftEnter, rightEnter);
+    }
+    if (rightEnter < closest) {
+      stack[top++] = {right, rightEnter};
+    }
+    if (leftEnter < closest) {
+      stack[top++] = {left, leftEnter};
+    }
+  }
+  return found;
+}
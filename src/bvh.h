@@ -0,0 +1,81 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "bounds.h"
+#include "frustum.h"
+#include "glm/glm.hpp"
+
+//one node, 32 bytes so two share a cache line. children are always
+//allocated as a pair (right = left + 1) and after their parent, so a
+//reverse walk over the array visits children before parents
+struct BvhNode {
+  glm::vec3 min;
+  uint32_t  leftFirst; //interior: left child; leaf: first slot in items
+  glm::vec3 max;
+  uint32_t  count;     //objects in the leaf, 0 for interior nodes
+};
+static_assert(sizeof(BvhNode) == 32, "BvhNode should stay 32 bytes");
+
+struct BvhRayHit {
+  uint32_t object;
+  float t; //along the ray's direction, in its units
+};
+
+//bounding volume hierarchy over world space boxes of scene objects, which
+//are referred to by their index in the array passed to build(). built with
+//a binned surface area heuristic; when objects move, refit() keeps the tree
+//shape and only grows/shrinks boxes, which is fine until the objects have
+//moved far from where they were at build time. build again then.
+//
+//queries only read the tree, so any number of threads may run them at once
+//as long as nobody builds or refits meanwhile.
+class Bvh {
+public:
+  //exact per object test for raycast: return false on a miss, or true with
+  //t set to the hit distance (only hits closer than the t passed in count)
+  using RayObjectTest = std::function<bool(uint32_t object, float &t)>;
+
+  void build(const std::vector<Aabb> &bounds);
+  //bounds has the same objects as at build() with new boxes. bottom up over
+  //every node
+  void refit(const std::vector<Aabb> &bounds);
+  //same, but only the leaves holding changed objects and their ancestors.
+  //stops climbing once a box comes out unchanged. for a few movers per frame
+  void refit(const std::vector<Aabb> &bounds,
+             const std::vector<uint32_t> &changed);
+
+  //each query appends object indices to out and returns how many it added
+  size_t queryFrustum(const Frustum &frustum,
+                      std::vector<uint32_t> &out) const;
+  size_t queryOverlap(const Aabb &box, std::vector<uint32_t> &out) const;
+  //closest object along the ray within maxT. nodes are visited front to
+  //back; without exact, hitting an object's box counts as hitting it
+  bool raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+               BvhRayHit &hit,
+               float maxT = std::numeric_limits<float>::max(),
+               const RayObjectTest &exact = nullptr) const;
+
+  size_t nodeCount() const { return nodes.size(); }
+  size_t objectCount() const { return leafOf.size(); }
+  const std::vector<BvhNode> &nodeArray() const { return nodes; }
+
+private:
+  std::vector<BvhNode>  nodes;   //root at 0
+  std::vector<uint32_t> items;   //object indices, grouped by leaf
+  std::vector<uint32_t> parents; //per node; the root's is itself
+  std::vector<uint32_t> leafOf;  //per object: the leaf it's in
+  //per object, as of the last build/refit: leaves hold several objects, so
+  //queries test these before reporting one
+  std::vector<Aabb>     objectBounds;
+
+  void refitLeaf(BvhNode &node);
+  void appendSubtree(uint32_t node, std::vector<uint32_t> &out) const;
+};
+
+#endif
@@ -0,0 +1,225 @@
+#include "dds.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include "hash.h"
+#include "mapped_file.h"
+
+namespace fs = std::filesystem;
+
+static const char DDS_MAGIC[4] = {'D', 'D', 'S', ' '};
+
+static const uint32_t DDSD_CAPS        = 0x1;
+static const uint32_t DDSD_HEIGHT      = 0x2;
+static const uint32_t DDSD_WIDTH       = 0x4;
+static const uint32_t DDSD_PIXELFORMAT = 0x1000;
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static const uint32_t DDSD_LINEARSIZE  = 0x80000;
+static const uint32_t DDPF_FOURCC      = 0x4;
+static const uint32_t DDSCAPS_COMPLEX  = 0x8;
+static const uint32_t DDSCAPS_TEXTURE  = 0x1000;
+static const uint32_t DDSCAPS_MIPMAP   = 0x400000;
+
+static constexpr uint32_t fourCC(char a, char b, char c, char d) {
+  return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8
+    | uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+}
+
+static size_t levelBytes(BlockFormat format, uint32_t width,
+                         uint32_t height) {
+  return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4)
+    * blockBytes(format);
+}
+
+uint64_t hashDdsSource(const std::string &sourcePath) {
+  MappedFile source(sourcePath);
+  if (!source.isOpen()) {
+    return 0;
+  }
+  return fnv1a64(source.data(), source.size());
+}
+
+//size and mtime only
+static bool statDdsSource(const std::string &sourcePath,
+                          DdsSourceStamp &stamp) {
+  std::error_code ec;
+  uintmax_t size = fs::file_size(sourcePath, ec);
+  if (ec) {
+    return false;
+  }
+  fs::file_time_type mtime = fs::last_write_time(sourcePath, ec);
+  if (ec) {
+    return false;
+  }
+  stamp.size = size;
+  stamp.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+  return true;
+}
+
+bool stampDdsSource(const std::string &sourcePath, DdsSourceStamp &stamp) {
+  stamp = DdsSourceStamp{};
+  if (!statDdsSource(sourcePath, stamp)) {
+    return false;
+  }
+  stamp.hash = hashDdsSource(sourcePath);
+  return stamp.hash != 0;
+}
+
+bool ddsSourceMatches(const DdsSourceStamp &stored,
+                      const std::string &sourcePath) {
+  if (stored.hash == 0) {
+    return false;
+  }
+  DdsSourceStamp current;
+  if (!statDdsSource(sourcePath, current)) {
+    return false;
+  }
+  if (current.size == stored.size && current.mtime == stored.mtime) {
+    return true;
+  }
+  return hashDdsSource(sourcePath) == stored.hash;
+}
+
+static void storeWords(uint32_t *words, uint64_t value) {
+  words[0] = static_cast<uint32_t>(value);
+  words[1] = static_cast<uint32_t>(value >> 32);
+}
+
+static uint64_t loadWords(const uint32_t *words) {
+  return uint64_t(words[1]) << 32 | words[0];
+}
+
+bool writeDds(const std::string &path, const CompressedImage &image,
+              const DdsSourceStamp *source) {
+  if (image.levels.empty()) {
+    return false;
+  }
+  const CompressedLevel &base = image.levels[0];
+
+  DdsHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.size = sizeof(DdsHeader);
+  header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT
+    | DDSD_LINEARSIZE;
+  header.height = static_cast<uint32_t>(base.height);
+  header.width = static_cast<uint32_t>(base.width);
+  header.pitchOrLinearSize = static_cast<uint32_t>(base.data.size());
+  header.mipMapCount = static_cast<uint32_t>(image.levels.size());
+  if (source && source->hash != 0) {
+    header.reserved1[0] = DDS_SOURCE_TAG;
+    storeWords(header.reserved1 + 1, source->hash);
+    storeWords(header.reserved1 + 3, source->size);
+    storeWords(header.reserved1 + 5, static_cast<uint64_t>(source->mtime));
+  }
+  header.pixelFormat.size = sizeof(DdsPixelFormat);
+  header.pixelFormat.flags = DDPF_FOURCC;
+  switch (image.format) {
+    case BLOCK_BC1:
+      header.pixelFormat.fourCC = fourCC('D', 'X', 'T', '1');
+      break;
+    case BLOCK_BC3:
+      header.pixelFormat.fourCC = fourCC('D', 'X', 'T', '5');
+      break;
+    case BLOCK_BC5:
+      header.pixelFormat.fourCC = fourCC('A', 'T', 'I', '2');
+      break;
+  }
+  header.caps = DDSCAPS_TEXTURE;
+  if (image.levels.size() > 1) {
+    header.flags |= DDSD_MIPMAPCOUNT;
+    header.caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+  }
+
+  //temp file + rename like the other caches, so a half written file never
+  //shadows its source image
+  std::string tmpPath = path + ".tmp";
+  std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cout << "ERROR::DDS::CANNOT_WRITE " << tmpPath << std::endl;
+    return false;
+  }
+  out.write(DDS_MAGIC, sizeof(DDS_MAGIC));
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (const CompressedLevel &level : image.levels) {
+    out.write(reinterpret_cast<const char *>(level.data.data()),
+              static_cast<std::streamsize>(level.data.size()));
+  }
+  out.close();
+  if (!out) {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+bool readDds(const std::string &path, CompressedImage &image,
+             DdsSourceStamp *source) {
+  MappedFile file(path);
+  if (!file.isOpen()
+    || file.size() < sizeof(DDS_MAGIC) + sizeof(DdsHeader)
+    || std::memcmp(file.data(), DDS_MAGIC, sizeof(DDS_MAGIC)) != 0) {
+    return false;
+  }
+  DdsHeader header;
+  std::memcpy(&header, file.data() + sizeof(DDS_MAGIC), sizeof(header));
+  if (header.size != sizeof(DdsHeader)
+    || !(header.pixelFormat.flags & DDPF_FOURCC)
+    || header.width == 0 || header.height == 0) {
+    return false;
+  }
+
+  BlockFormat format;
+  switch (header.pixelFormat.fourCC) {
+    case fourCC('D', 'X', 'T', '1'):
+      format = BLOCK_BC1;
+      break;
+    case fourCC('D', 'X', 'T', '5'):
+      format = BLOCK_BC3;
+      break;
+    case fourCC('A', 'T', 'I', '2'):
+    case fourCC('B', 'C', '5', 'U'):
+      format = BLOCK_BC5;
+      break;
+    default:
+      return false;
+  }
+
+  uint32_t levelCount = (header.flags & DDSD_MIPMAPCOUNT)
+    ? std::max<uint32_t>(header.mipMapCount, 1) : 1;
+  CompressedImage result;
+  result.format = format;
+  size_t offset = sizeof(DDS_MAGIC) + sizeof(DdsHeader);
+  uint32_t width = header.width, height = header.height;
+  for (uint32_t i{}; i < levelCount; ++i) {
+    size_t bytes = levelBytes(format, width, height);
+    if (offset + bytes > file.size()) {
+      return false;
+    }
+    CompressedLevel level;
+    level.width = static_cast<int>(width);
+    level.height = static_cast<int>(height);
+    level.data.assign(file.data() + offset, file.data() + offset + bytes);
+    result.levels.push_back(std::move(level));
+    offset += bytes;
+    width = std::max<uint32_t>(width / 2, 1);
+    height = std::max<uint32_t>(height / 2, 1);
+  }
+  image = std::move(result);
+  if (source) {
+    *source = DdsSourceStamp{};
+    if (header.reserved1[0] == DDS_SOURCE_TAG) {
+      source->hash = loadWords(header.reserved1 + 1);
+      source->size = loadWords(header.reserved1 + 3);
+      source->mtime = static_cast<int64_t>(loadWords(header.reserved1 + 5));
+    } else if (header.reserved1[0] == DDS_SOURCE_TAG_V1) {
+      source->hash = loadWords(header.reserved1 + 1); //hash check only
+    }
+  }
+  return true;
+}
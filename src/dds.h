@@ -0,0 +1,72 @@
+#ifndef DDS_H
+#define DDS_H
+
+#include <cstdint>
+#include <string>
+
+#include "block_compress.h"
+
+//minimal DDS container for CompressedImage: the legacy 124 byte header with
+//a FourCC pixel format (DXT1, DXT5 or ATI2; BC5U is accepted on read),
+//followed by every mip level's blocks back to back. that's the flavour every
+//DDS tool reads and writes; DX10 headers, cube maps, arrays and uncompressed
+//layouts aren't supported.
+//
+//DDS files written for a source image carry a DdsSourceStamp of it in
+//reserved1: DDS_SOURCE_TAG, then hash, size and mtime as 64 bit values, low
+//word first ("DGS1" files only have the hash). that way a converted file
+//whose source has changed since can be told apart.
+constexpr uint32_t DDS_SOURCE_TAG = 0x32534744;    //"DGS2"
+constexpr uint32_t DDS_SOURCE_TAG_V1 = 0x31534744; //"DGS1"
+
+//what a DDS remembers about the image it was converted from. size and mtime
+//are the cheap check, the content hash decides when they differ (a fresh
+//checkout touches every file)
+struct DdsSourceStamp {
+  uint64_t hash{0}; //0: no source recorded
+  uint64_t size{0};
+  int64_t  mtime{0}; //filesystem clock ticks
+};
+
+struct DdsPixelFormat {
+  uint32_t size; //32
+  uint32_t flags;
+  uint32_t fourCC;
+  uint32_t rgbBitCount;
+  uint32_t rBitMask, gBitMask, bBitMask, aBitMask;
+};
+
+struct DdsHeader {
+  uint32_t size; //124
+  uint32_t flags;
+  uint32_t height;
+  uint32_t width;
+  uint32_t pitchOrLinearSize;
+  uint32_t depth;
+  uint32_t mipMapCount;
+  uint32_t reserved1[11];
+  DdsPixelFormat pixelFormat;
+  uint32_t caps, caps2, caps3, caps4;
+  uint32_t reserved2;
+};
+
+//content hash of the image a DDS is converted from; 0 if it can't be read
+uint64_t hashDdsSource(const std::string &sourcePath);
+//hash, size and mtime of sourcePath; false (stamp.hash 0) if it can't be read
+bool stampDdsSource(const std::string &sourcePath, DdsSourceStamp &stamp);
+//whether sourcePath is still the image stored was made from. only stats the
+//file when size and mtime match, hashes it when they don't
+bool ddsSourceMatches(const DdsSourceStamp &stored,
+                      const std::string &sourcePath);
+
+//source: stamp of the image it was made from, null for none
+bool writeDds(const std::string &path, const CompressedImage &image,
+              const DdsSourceStamp *source = nullptr);
+
+//false (with image untouched) for anything that isn't a DDS we understand or
+//is truncated. source (if given) gets the stored stamp, hash 0 if the file
+//has none
+bool readDds(const std::string &path, CompressedImage &image,
+             DdsSourceStamp *source = nullptr);
+
+#endif
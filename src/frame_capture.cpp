@@ -0,0 +1,96 @@
+#include "frame_capture.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+#include "gl_state.h"
+
+FrameCapture::FrameCapture(int width, int height, size_t depth)
+: slots(depth ? depth : 1), captureWidth(width), captureHeight(height) {
+  for (Slot &slot : slots) {
+    glGenBuffers(1, &slot.pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER,
+                 static_cast<GLsizeiptr>(width) * height * 4, NULL,
+                 GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+FrameCapture::~FrameCapture() {
+  for (Slot &slot : slots) {
+    if (slot.fence) {
+      glDeleteSync(slot.fence);
+    }
+    glDeleteBuffers(1, &slot.pbo);
+  }
+}
+
+void FrameCapture::capture(unsigned int fbo, uint64_t frame,
+                           const Sink &sink) {
+  //ring is full: the GPU is that far behind. the slot is only reused once
+  //its readback is delivered or dropped
+  while (pending == slots.size()) {
+    deliverOldest(sink, true);
+  }
+  Slot &slot = slots[next];
+  glState().bindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  //with a PBO bound the last argument is an offset and this returns at once
+  glReadPixels(0, 0, captureWidth, captureHeight, GL_RGBA, GL_UNSIGNED_BYTE,
+               (void*)0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  slot.frame = frame;
+
+  next = (next + 1) % slots.size();
+  ++pending;
+}
+
+void FrameCapture::poll(const Sink &sink) {
+  while (pending && deliverOldest(sink, false)) {
+  }
+}
+
+void FrameCapture::flush(const Sink &sink) {
+  while (pending) {
+    deliverOldest(sink, true);
+  }
+}
+
+bool FrameCapture::deliverOldest(const Sink &sink, bool wait) {
+  Slot &slot = slots[(next + slots.size() - pending) % slots.size()];
+  //GL_TIMEOUT_IGNORED isn't allowed for client waits, so wait in 1s steps
+  GLenum status;
+  do {
+    status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                              wait ? 1000000000ull : 0);
+  } while (wait && status == GL_TIMEOUT_EXPIRED);
+  if (status == GL_TIMEOUT_EXPIRED) {
+    return false;
+  }
+  glDeleteSync(slot.fence);
+  slot.fence = nullptr;
+  --pending;
+  if (status == GL_WAIT_FAILED) {
+    //waiting again won't help: drop the frame, keep the slot usable
+    std::cout << "ERROR::FRAME_CAPTURE::WAIT_FAILED " << slot.frame
+              << std::endl;
+    return true;
+  }
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+  const unsigned char *pixels = static_cast<const unsigned char *>(
+    glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                     static_cast<GLsizeiptr>(captureWidth) * captureHeight * 4,
+                     GL_MAP_READ_BIT));
+  if (pixels) {
+    sink(slot.frame, pixels, captureWidth, captureHeight);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  return true;
+}
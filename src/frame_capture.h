@@ -0,0 +1,53 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+//asynchronous framebuffer readback through a ring of pixel buffer objects.
+//capture() only queues a glReadPixels into a PBO plus a fence, so the CPU
+//never waits for the frame it just submitted; the pixels are handed out a
+//few frames later once the GPU is done with them.
+class FrameCapture {
+public:
+  //called with tightly packed RGBA8 rows, bottom row first (GL order)
+  using Sink = std::function<void(uint64_t frame, const unsigned char *rgba,
+                                  int width, int height)>;
+
+  //depth: how many readbacks may be in flight before capture() has to wait
+  FrameCapture(int width, int height, size_t depth = 3);
+  ~FrameCapture();
+
+  FrameCapture(const FrameCapture &) = delete;
+  FrameCapture &operator=(const FrameCapture &) = delete;
+
+  //queues a readback of fbo's first color attachment. only blocks if all
+  //depth slots are still in flight, and then only for the oldest one.
+  void capture(unsigned int fbo, uint64_t frame, const Sink &sink);
+
+  //delivers every readback that has already finished (never blocks)
+  void poll(const Sink &sink);
+
+  //waits for and delivers everything still in flight
+  void flush(const Sink &sink);
+
+private:
+  struct Slot {
+    unsigned int pbo{0};
+    GLsync fence{nullptr};
+    uint64_t frame{0};
+  };
+  std::vector<Slot> slots;
+  size_t next{0};    //slot the next capture goes into
+  size_t pending{0}; //slots in flight, oldest at next - pending
+  int captureWidth, captureHeight;
+
+  //frees the oldest slot, delivering its pixels; one whose fence failed is
+  //dropped. false if it isn't done yet (only when !wait)
+  bool deliverOldest(const Sink &sink, bool wait);
+};
+
+#endif
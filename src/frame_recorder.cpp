@@ -0,0 +1,87 @@
+#include "frame_recorder.h"
+
+#include <algorithm>
+
+//fewer objects than this per chunk and handing them out costs more than
+//recording them
+static const size_t MIN_CHUNK = 1024;
+//chunks per worker, so a worker that got easy objects can take another
+static const size_t CHUNKS_PER_THREAD = 4;
+
+void CommandBuffer::reset() {
+  for (size_t group{}; group < RECORD_GROUPS; ++group) {
+    instances[group].clear();
+    nearest[group] = 1e30f;
+  }
+  visible = 0;
+  culled = 0;
+}
+
+size_t RecordedFrame::instanceCount(size_t group) const {
+  size_t count{};
+  for (const CommandBuffer &buffer : buffers) {
+    count += buffer.instances[group].size();
+  }
+  return count;
+}
+
+float RecordedFrame::nearest(size_t group) const {
+  float distance = 1e30f;
+  for (const CommandBuffer &buffer : buffers) {
+    distance = std::min(distance, buffer.nearest[group]);
+  }
+  return distance;
+}
+
+FrameRecorder::FrameRecorder(JobSystem &jobs) : jobs(jobs) {}
+
+FrameRecorder::~FrameRecorder() {
+  //the chunks point into frames; they have to be done before it goes
+  jobs.wait(pending);
+}
+
+void FrameRecorder::record(const glm::mat4 &view,
+                           const glm::mat4 &projection, float time,
+                           size_t objectCount, RecordChunk chunk) {
+  wait();
+  if (recorded - replayed == 2) {
+    ++replayed; //nobody took the oldest, its slot is needed
+  }
+  RecordedFrame &frame = frames[recorded % 2];
+  ++recorded;
+  frame.view = view;
+  frame.projection = projection;
+  frame.time = time;
+
+  size_t chunks = std::min(jobs.workerCount() * CHUNKS_PER_THREAD,
+                           (objectCount + MIN_CHUNK - 1) / MIN_CHUNK);
+  chunks = std::max<size_t>(chunks, 1);
+  size_t chunkSize = (objectCount + chunks - 1) / chunks;
+  frame.buffers.resize(chunks);
+
+  chunkFn = std::move(chunk);
+  for (size_t i{}; i < chunks; ++i) {
+    size_t first = std::min(objectCount, i * chunkSize);
+    size_t last = std::min(objectCount, first + chunkSize);
+    jobs.run([this, &frame, i, first, last]() {
+      CommandBuffer &buffer = frame.buffers[i];
+      buffer.reset();
+      chunkFn(frame, first, last, buffer);
+    }, &pending);
+  }
+}
+
+const RecordedFrame *FrameRecorder::next() {
+  if (replayed == recorded) {
+    return nullptr;
+  }
+  //anything older than the latest recording finished before it started
+  if (replayed + 1 == recorded) {
+    wait();
+  }
+  return &frames[replayed++ % 2];
+}
+
+void FrameRecorder::wait() {
+  jobs.wait(pending); //rethrows anything a chunk threw
+}
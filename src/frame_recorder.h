@@ -0,0 +1,83 @@
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "job_system.h"
+
+//draw lists a frame can record into, e.g. selected / not selected
+static const size_t RECORD_GROUPS = 2;
+
+//what one worker recorded for one chunk of objects: the model matrices of
+//the visible ones per group, ready to go into an instance buffer, and what
+//the sort keys need. plain CPU data, nothing here touches GL
+struct CommandBuffer {
+  std::vector<glm::mat4> instances[RECORD_GROUPS];
+  float    nearest[RECORD_GROUPS]; //closest visible object per group
+  uint32_t visible;
+  uint32_t culled;
+
+  //empties the lists but keeps their memory
+  void reset();
+};
+
+//one frame's worth of command buffers, in object order, plus the camera it
+//was recorded for
+struct RecordedFrame {
+  glm::mat4 view;
+  glm::mat4 projection;
+  float time;
+  std::vector<CommandBuffer> buffers; //one per chunk, in object order
+
+  size_t instanceCount(size_t group) const;
+  float nearest(size_t group) const;
+};
+
+//records frames on worker threads while the GL thread replays the previous
+//one. record() hands the objects out in chunks, each chunk into its own
+//command buffer so workers never share anything, and returns right away;
+//next() waits for the oldest recorded frame and gives it to the GL thread.
+//two frames live at a time, so a loop of record(N + 1), then replay of
+//next() (frame N), keeps the workers busy during submission. the objects the
+//chunks read must not change until wait() says the recording is done
+class FrameRecorder {
+public:
+  //records objects [first, last) of the frame into buffer (already reset)
+  using RecordChunk = std::function<void(const RecordedFrame &frame,
+                                         size_t first, size_t last,
+                                         CommandBuffer &buffer)>;
+
+  //chunks run as jobs on jobs, which has to outlive the recorder
+  explicit FrameRecorder(JobSystem &jobs);
+  ~FrameRecorder();
+
+  FrameRecorder(const FrameRecorder &) = delete;
+  FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+  //starts recording objectCount objects for the given camera. waits for the
+  //recording still in flight first; a frame that was recorded but never
+  //taken by next() is dropped
+  void record(const glm::mat4 &view, const glm::mat4 &projection, float time,
+              size_t objectCount, RecordChunk chunk);
+  //the oldest frame not replayed yet, once it's done recording; null if
+  //there is none. stays valid until the next record(), which may reuse
+  //its slot
+  const RecordedFrame *next();
+  //blocks until nothing is being recorded, running chunks itself meanwhile
+  void wait();
+
+  size_t threadCount() const { return jobs.workerCount(); }
+
+private:
+  JobSystem &jobs;
+  RecordedFrame frames[2];
+  size_t recorded{0}, replayed{0}; //frames started / handed out
+  JobCounter pending; //chunks of the recording in flight
+  RecordChunk chunkFn; //the in-flight recording's, kept alive for it
+};
+
+#endif
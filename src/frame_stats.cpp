@@ -0,0 +1,11 @@
+#include "frame_stats.h"
+
+static FrameStats stats;
+
+FrameStats &currentFrameStats() {
+  return stats;
+}
+
+void resetFrameStats() {
+  stats = FrameStats();
+}
@@ -0,0 +1,23 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <cstdint>
+
+//per frame counters. nothing is counted unless something feeds these:
+//installGLCallCounters() for the GL side, the renderers for their own bits.
+struct FrameStats {
+  uint32_t drawCalls{};
+  uint32_t stateChanges{};   //binds, enables, stencil/depth/blend state...
+  uint32_t uniformUploads{};
+  uint32_t bufferUploads{};  //glBufferData/SubData, buffer maps
+  uint32_t objectsVisible{}; //passed frustum culling (meshes, instances)
+  uint32_t objectsCulled{};
+  uint32_t stateIssued{};    //GLStateCache calls that reached GL
+  uint32_t stateElided{};    //and the ones it dropped as redundant
+};
+
+//stats of the frame currently being recorded (GL thread only)
+FrameStats &currentFrameStats();
+void resetFrameStats();
+
+#endif
@@ -0,0 +1,42 @@
+#include "frame_uniforms.h"
+
+#include <glad/glad.h>
+
+//frames that can be queued up before the driver makes us wait anyway
+static const size_t FRAME_SLOTS = 3;
+
+FrameUniforms::FrameUniforms() {
+  //glBindBufferRange offsets have to be multiples of this (256 on most
+  //desktop GPUs)
+  GLint alignment{};
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  size_t align = alignment > 0 ? static_cast<size_t>(alignment) : 256;
+  slotSize = (sizeof(FrameData) + align - 1) / align * align;
+
+  glGenBuffers(1, &ubo);
+  glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+  glBufferData(GL_UNIFORM_BUFFER, slotSize * FRAME_SLOTS, NULL,
+               GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+FrameUniforms::~FrameUniforms() {
+  glDeleteBuffers(1, &ubo);
+}
+
+void FrameUniforms::update(const glm::mat4 &view, const glm::mat4 &projection,
+                           float time) {
+  frame.view = view;
+  frame.projection = projection;
+  frame.viewProjection = projection * view;
+  //the view matrix' inverse has the camera's world position as translation
+  frame.cameraPosition = glm::vec4(glm::vec3(glm::inverse(view)[3]), 1.0f);
+  frame.time = time;
+
+  slot = (slot + 1) % FRAME_SLOTS;
+  GLintptr offset = static_cast<GLintptr>(slot * slotSize);
+  //binding the range binds the generic target too, which SubData writes
+  glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, ubo, offset,
+                    sizeof(FrameData));
+  glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(FrameData), &frame);
+}
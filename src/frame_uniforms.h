@@ -0,0 +1,58 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <cstddef>
+
+#include "glm/glm.hpp"
+
+//uniform buffer binding point of the FrameData block. Shader binds the
+//block of every program that declares it here at link time
+const unsigned int FRAME_DATA_BINDING = 0;
+const char *const FRAME_DATA_BLOCK = "FrameData";
+
+//std140 image of the block every vertex shader declares:
+//
+//  layout (std140) uniform FrameData {
+//      mat4 view;
+//      mat4 projection;
+//      mat4 viewProjection;
+//      vec4 cameraPosition; // w unused
+//      float time;
+//  };
+struct FrameData {
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::mat4 viewProjection;
+  glm::vec4 cameraPosition;
+  float     time;
+  float     padding[3];
+};
+static_assert(sizeof(FrameData) == 224, "FrameData must match std140");
+
+//the per frame camera block, written once per frame for every program
+//instead of a view and a projection upload per program. the buffer holds a
+//few frames' worth of blocks and update() moves on to the next one each
+//time, so the GPU may still read last frame's while this one is written
+class FrameUniforms {
+public:
+  FrameUniforms();
+  ~FrameUniforms();
+
+  FrameUniforms(const FrameUniforms &) = delete;
+  FrameUniforms &operator=(const FrameUniforms &) = delete;
+
+  //fills the next slot (camera position comes out of view) and binds it to
+  //FRAME_DATA_BINDING
+  void update(const glm::mat4 &view, const glm::mat4 &projection,
+              float time);
+  const FrameData &data() const { return frame; }
+
+private:
+  unsigned int ubo{0};
+  size_t slotSize{0}; //sizeof(FrameData) rounded up to the offset alignment
+  size_t slot{0};
+  FrameData frame{};
+};
+
+#endif
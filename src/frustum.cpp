@@ -0,0 +1,224 @@
+#include "frustum.h"
+
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+//Gribb/Hartmann: each plane is the last row of the matrix plus or minus
+//one of the others (GL clip space, -w <= x, y, z <= w)
+Frustum::Frustum(const glm::mat4 &clipFromSpace) {
+  glm::vec4 row[4];
+  for (int i{}; i < 4; ++i) {
+    row[i] = glm::vec4(clipFromSpace[0][i], clipFromSpace[1][i],
+                       clipFromSpace[2][i], clipFromSpace[3][i]);
+  }
+  planes[0] = row[3] + row[0];
+  planes[1] = row[3] - row[0];
+  planes[2] = row[3] + row[1];
+  planes[3] = row[3] - row[1];
+  planes[4] = row[3] + row[2];
+  planes[5] = row[3] - row[2];
+  for (glm::vec4 &plane : planes) {
+    float length = glm::length(glm::vec3(plane));
+    if (length > 0.0f) {
+      plane /= length;
+    }
+  }
+}
+
+bool Frustum::intersects(const Aabb &box) const {
+  if (box.empty()) {
+    return false;
+  }
+  glm::vec3 center = box.center();
+  glm::vec3 extent = box.extent();
+  for (const glm::vec4 &plane : planes) {
+    glm::vec3 normal(plane);
+    float distance = glm::dot(normal, center) + plane.w;
+    float radius = glm::dot(glm::abs(normal), extent);
+    if (distance + radius < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::intersects(const BoundingSphere &sphere) const {
+  if (sphere.radius < 0.0f) {
+    return false;
+  }
+  for (const glm::vec4 &plane : planes) {
+    if (glm::dot(glm::vec3(plane), sphere.center) + plane.w
+        < -sphere.radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ==============================BATCH=========================================
+void AabbBatch::clear() {
+  for (std::vector<float> *v : {&centerX, &centerY, &centerZ,
+                                &extentX, &extentY, &extentZ}) {
+    v->clear();
+  }
+}
+
+void AabbBatch::reserve(size_t count) {
+  for (std::vector<float> *v : {&centerX, &centerY, &centerZ,
+                                &extentX, &extentY, &extentZ}) {
+    v->reserve(count);
+  }
+}
+
+void AabbBatch::push_back(const Aabb &box) {
+  for (std::vector<float> *v : {&centerX, &centerY, &centerZ,
+                                &extentX, &extentY, &extentZ}) {
+    v->push_back(0.0f);
+  }
+  set(size() - 1, box);
+}
+
+void AabbBatch::set(size_t i, const Aabb &box) {
+  glm::vec3 center(0.0f);
+  glm::vec3 extent(-std::numeric_limits<float>::max());
+  if (!box.empty()) {
+    center = box.center();
+    extent = box.extent();
+  }
+  centerX[i] = center.x;
+  centerY[i] = center.y;
+  centerZ[i] = center.z;
+  extentX[i] = extent.x;
+  extentY[i] = extent.y;
+  extentZ[i] = extent.z;
+}
+
+// ==============================CULLING=======================================
+//boxes [first, count) one at a time; also the tail of the SIMD loops
+static size_t cullRange(const Frustum &frustum, const float *cx,
+                        const float *cy, const float *cz, const float *ex,
+                        const float *ey, const float *ez, size_t first,
+                        size_t count, uint8_t *visible) {
+  size_t visibleCount{};
+  for (size_t i = first; i < count; ++i) {
+    bool inside = true;
+    for (const glm::vec4 &p : frustum.planes) {
+      float distance = p.x * cx[i] + p.y * cy[i] + p.z * cz[i] + p.w;
+      float radius = std::abs(p.x) * ex[i] + std::abs(p.y) * ey[i]
+        + std::abs(p.z) * ez[i];
+      if (distance + radius < 0.0f) {
+        inside = false;
+        break;
+      }
+    }
+    visible[i] = inside;
+    visibleCount += inside;
+  }
+  return visibleCount;
+}
+
+size_t cullAabbsScalar(const Frustum &frustum, const AabbBatch &boxes,
+                       uint8_t *visible) {
+  return cullRange(frustum, boxes.centerX.data(), boxes.centerY.data(),
+                   boxes.centerZ.data(), boxes.extentX.data(),
+                   boxes.extentY.data(), boxes.extentZ.data(), 0,
+                   boxes.size(), visible);
+}
+
+size_t cullAabbs(const Frustum &frustum, const AabbBatch &boxes,
+                 uint8_t *visible) {
+  const float *cx = boxes.centerX.data(), *cy = boxes.centerY.data();
+  const float *cz = boxes.centerZ.data(), *ex = boxes.extentX.data();
+  const float *ey = boxes.extentY.data(), *ez = boxes.extentZ.data();
+  size_t count = boxes.size();
+  size_t visibleCount{};
+  size_t i{};
+
+#if defined(__AVX__)
+  //plane components broadcast once, absolute normals precomputed
+  __m256 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+  for (int p{}; p < 6; ++p) {
+    const glm::vec4 &plane = frustum.planes[p];
+    nx[p] = _mm256_set1_ps(plane.x);
+    ny[p] = _mm256_set1_ps(plane.y);
+    nz[p] = _mm256_set1_ps(plane.z);
+    nw[p] = _mm256_set1_ps(plane.w);
+    ax[p] = _mm256_set1_ps(std::abs(plane.x));
+    ay[p] = _mm256_set1_ps(std::abs(plane.y));
+    az[p] = _mm256_set1_ps(std::abs(plane.z));
+  }
+  const __m256 zero = _mm256_setzero_ps();
+  for (; i + 8 <= count; i += 8) {
+    __m256 x = _mm256_loadu_ps(cx + i), y = _mm256_loadu_ps(cy + i);
+    __m256 z = _mm256_loadu_ps(cz + i), w = _mm256_loadu_ps(ex + i);
+    __m256 h = _mm256_loadu_ps(ey + i), d = _mm256_loadu_ps(ez + i);
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int p{}; p < 6; ++p) {
+      __m256 distance = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(nx[p], x), _mm256_mul_ps(ny[p], y)),
+        _mm256_add_ps(_mm256_mul_ps(nz[p], z), nw[p]));
+      __m256 radius = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(ax[p], w), _mm256_mul_ps(ay[p], h)),
+        _mm256_mul_ps(az[p], d));
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(
+        _mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+    }
+    int mask = _mm256_movemask_ps(inside);
+    for (int k{}; k < 8; ++k) {
+      visible[i + k] = (mask >> k) & 1;
+      visibleCount += visible[i + k];
+    }
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  __m128 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+  for (int p{}; p < 6; ++p) {
+    const glm::vec4 &plane = frustum.planes[p];
+    nx[p] = _mm_set1_ps(plane.x);
+    ny[p] = _mm_set1_ps(plane.y);
+    nz[p] = _mm_set1_ps(plane.z);
+    nw[p] = _mm_set1_ps(plane.w);
+    ax[p] = _mm_set1_ps(std::abs(plane.x));
+    ay[p] = _mm_set1_ps(std::abs(plane.y));
+    az[p] = _mm_set1_ps(std::abs(plane.z));
+  }
+  const __m128 zero = _mm_setzero_ps();
+  for (; i + 4 <= count; i += 4) {
+    __m128 x = _mm_loadu_ps(cx + i), y = _mm_loadu_ps(cy + i);
+    __m128 z = _mm_loadu_ps(cz + i), w = _mm_loadu_ps(ex + i);
+    __m128 h = _mm_loadu_ps(ey + i), d = _mm_loadu_ps(ez + i);
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int p{}; p < 6; ++p) {
+      __m128 distance = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)),
+        _mm_add_ps(_mm_mul_ps(nz[p], z), nw[p]));
+      __m128 radius = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(ax[p], w), _mm_mul_ps(ay[p], h)),
+        _mm_mul_ps(az[p], d));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius),
+                                               zero));
+    }
+    int mask = _mm_movemask_ps(inside);
+    for (int k{}; k < 4; ++k) {
+      visible[i + k] = (mask >> k) & 1;
+      visibleCount += visible[i + k];
+    }
+  }
+#endif
+
+  return visibleCount + cullRange(frustum, cx, cy, cz, ex, ey, ez, i, count,
+                                  visible);
+}
+
+const char *cullSimdPath() {
+#if defined(__AVX__)
+  return "avx";
+#elif defined(__SSE2__) || defined(_M_X64)
+  return "sse";
+#else
+  return "scalar";
+#endif
+}
@@ -0,0 +1,59 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bounds.h"
+#include "glm/glm.hpp"
+
+//the six clip planes of a view volume, pointing inwards, as (normal, w) with
+//normalized normals: a point p is inside a plane when dot(normal, p) + w >= 0.
+//built from projection * view they're in world space; multiply the model
+//matrix in as well and they're in that object's space, so its local bounds
+//can be tested without transforming them
+struct Frustum {
+  glm::vec4 planes[6]; //left, right, bottom, top, near, far
+
+  Frustum() = default;
+  explicit Frustum(const glm::mat4 &clipFromSpace);
+
+  bool intersects(const Aabb &box) const;
+  bool intersects(const BoundingSphere &sphere) const;
+};
+
+//boxes as structure of arrays (centre and half extent per axis), the layout
+//the batch culler wants. build it once and keep it; only what moved needs
+//set() again
+class AabbBatch {
+public:
+  size_t size() const { return centerX.size(); }
+  void clear();
+  void reserve(size_t count);
+  //an empty box is stored inverted so no frustum ever sees it
+  void push_back(const Aabb &box);
+  void set(size_t i, const Aabb &box);
+
+private:
+  friend size_t cullAabbs(const Frustum &, const AabbBatch &, uint8_t *);
+  friend size_t cullAabbsScalar(const Frustum &, const AabbBatch &,
+                                uint8_t *);
+  std::vector<float> centerX, centerY, centerZ;
+  std::vector<float> extentX, extentY, extentZ;
+};
+
+//writes 1 (possibly visible) or 0 (entirely outside one plane) per box into
+//visible, which must hold boxes.size() bytes, and returns the visible count.
+//cullAabbs runs 8 boxes at a time with AVX when built for it, 4 with SSE on
+//any other x86-64 build, and falls back to cullAabbsScalar elsewhere. the
+//test is conservative: big boxes near a frustum corner can pass
+size_t cullAabbs(const Frustum &frustum, const AabbBatch &boxes,
+                 uint8_t *visible);
+size_t cullAabbsScalar(const Frustum &frustum, const AabbBatch &boxes,
+                       uint8_t *visible);
+
+//"avx", "sse" or "scalar": what cullAabbs was built with
+const char *cullSimdPath();
+
+#endif
@@ -0,0 +1,91 @@
+#include "gl_call_counter.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+#include "frame_stats.h"
+
+namespace {
+
+//one instantiation per hooked glad pointer; keeps the driver's entry point
+//around and counts into a FrameStats member on every call
+template <auto *Slot, typename Fn = decltype(*Slot)> struct Hook;
+
+template <auto *Slot, typename R, typename... Args>
+struct Hook<Slot, R (APIENTRYP &)(Args...)> {
+  static inline R (APIENTRYP real)(Args...) = nullptr;
+  static inline uint32_t FrameStats::*counter = nullptr;
+
+  static R APIENTRY call(Args... args) {
+    ++(currentFrameStats().*counter);
+    return real(args...);
+  }
+
+  static void install(uint32_t FrameStats::*statsCounter) {
+    if (real || !*Slot) {
+      return; //already hooked, or not provided by this context
+    }
+    real = *Slot;
+    counter = statsCounter;
+    *Slot = &call;
+  }
+
+  static void uninstall() {
+    if (real) {
+      *Slot = real;
+      real = nullptr;
+    }
+  }
+};
+
+template <auto *... Slots> struct HookGroup {
+  static void install(uint32_t FrameStats::*statsCounter) {
+    (Hook<Slots>::install(statsCounter), ...);
+  }
+  static void uninstall() {
+    (Hook<Slots>::uninstall(), ...);
+  }
+};
+
+using DrawHooks = HookGroup<
+  &glad_glDrawArrays, &glad_glDrawElements,
+  &glad_glDrawArraysInstanced, &glad_glDrawElementsInstanced,
+  &glad_glDrawRangeElements, &glad_glDrawElementsBaseVertex,
+  &glad_glDrawElementsInstancedBaseVertex,
+  &glad_glMultiDrawArrays, &glad_glMultiDrawElements,
+  &glad_glMultiDrawElementsBaseVertex>;
+
+using StateHooks = HookGroup<
+  &glad_glUseProgram, &glad_glBindVertexArray, &glad_glBindTexture,
+  &glad_glActiveTexture, &glad_glBindFramebuffer, &glad_glBindBuffer,
+  &glad_glBindBufferBase, &glad_glBindBufferRange,
+  &glad_glEnable, &glad_glDisable,
+  &glad_glStencilFunc, &glad_glStencilMask, &glad_glStencilOp,
+  &glad_glDepthFunc, &glad_glDepthMask, &glad_glBlendFunc,
+  &glad_glColorMask, &glad_glViewport, &glad_glClearColor>;
+
+using UniformHooks = HookGroup<
+  &glad_glUniform1i, &glad_glUniform1f, &glad_glUniform2f,
+  &glad_glUniform3f, &glad_glUniform4f, &glad_glUniform1iv,
+  &glad_glUniform3fv, &glad_glUniform4fv,
+  &glad_glUniformMatrix3fv, &glad_glUniformMatrix4fv>;
+
+using BufferHooks = HookGroup<
+  &glad_glBufferData, &glad_glBufferSubData, &glad_glMapBufferRange>;
+
+} // namespace
+
+void installGLCallCounters() {
+  DrawHooks::install(&FrameStats::drawCalls);
+  StateHooks::install(&FrameStats::stateChanges);
+  UniformHooks::install(&FrameStats::uniformUploads);
+  BufferHooks::install(&FrameStats::bufferUploads);
+}
+
+void uninstallGLCallCounters() {
+  DrawHooks::uninstall();
+  StateHooks::uninstall();
+  UniformHooks::uninstall();
+  BufferHooks::uninstall();
+}
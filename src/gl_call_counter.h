@@ -0,0 +1,11 @@
+#ifndef GL_CALL_COUNTER_H
+#define GL_CALL_COUNTER_H
+
+//swaps glad's function pointers for draws, state changes, uniform and buffer
+//uploads with thin wrappers that bump currentFrameStats() and forward to the
+//driver. nothing in the render code has to know: every call is seen, and an
+//uninstalled counter costs nothing. call after glad has been loaded.
+void installGLCallCounters();
+void uninstallGLCallCounters();
+
+#endif
@@ -0,0 +1,44 @@
+#include "gl_ext.h"
+
+#include <cstring>
+
+GLExtensions glext;
+
+static bool versionAtLeast(int major, int minor) {
+  return GLVersion.major > major
+    || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+bool hasGLExtension(const char *name) {
+  int count{};
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (int i{}; i < count; ++i) {
+    const char *ext = reinterpret_cast<const char *>(
+      glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+    if (ext && std::strcmp(ext, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void loadGLExtensions(GLADloadproc load) {
+  glext = GLExtensions();
+
+  if (versionAtLeast(4, 1) || hasGLExtension("GL_ARB_get_program_binary")) {
+    glext.getProgramBinary =
+      (PFNGLEXTGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+    glext.programBinaryLoad =
+      (PFNGLEXTPROGRAMBINARYPROC)load("glProgramBinary");
+    glext.programParameteri =
+      (PFNGLEXTPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+    int formats{};
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    //a driver may expose the entry points and still have no formats (no
+    //shader disk cache built in, for one); treat that as unsupported
+    glext.programBinary = glext.getProgramBinary && glext.programBinaryLoad
+      && glext.programParameteri && formats > 0;
+  }
+
+  glext.textureS3tc = hasGLExtension("GL_EXT_texture_compression_s3tc");
+}
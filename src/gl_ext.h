@@ -0,0 +1,53 @@
+#ifndef GL_EXT_H
+#define GL_EXT_H
+
+#include <glad/glad.h>
+
+//the bits of GL newer than the 3.3 core glad was generated for. they are
+//resolved through the same loader glad used, right after gladLoadGLLoader;
+//anything the driver lacks stays null, so check the has* flags first.
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH           0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+#define GL_PROGRAM_BINARY_FORMATS          0x87FF
+#endif
+
+//EXT_texture_compression_s3tc (BC1-3). BC4/5 are core as RGTC
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT  0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+typedef void (APIENTRYP PFNGLEXTGETPROGRAMBINARYPROC)(
+  GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat,
+  void *binary);
+typedef void (APIENTRYP PFNGLEXTPROGRAMBINARYPROC)(
+  GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLEXTPROGRAMPARAMETERIPROC)(
+  GLuint program, GLenum pname, GLint value);
+
+struct GLExtensions {
+  //GL 4.1 / ARB_get_program_binary with at least one binary format
+  bool programBinary{false};
+  PFNGLEXTGETPROGRAMBINARYPROC getProgramBinary{nullptr};
+  PFNGLEXTPROGRAMBINARYPROC programBinaryLoad{nullptr};
+  PFNGLEXTPROGRAMPARAMETERIPROC programParameteri{nullptr};
+
+  //EXT_texture_compression_s3tc: BC1/BC3 uploads
+  bool textureS3tc{false};
+};
+
+//filled by loadGLExtensions, all false/null before that
+extern GLExtensions glext;
+
+//call once the context is current and glad is loaded
+void loadGLExtensions(GLADloadproc load);
+
+//GL_EXTENSIONS lookup through glGetStringi
+bool hasGLExtension(const char *name);
+
+#endif
@@ -0,0 +1,242 @@
+#include "gl_state.h"
+
+#include <glad/glad.h>
+
+#include "frame_stats.h"
+
+GLStateCache &glState() {
+  static GLStateCache cache;
+  return cache;
+}
+
+bool GLStateCache::redundant(bool same) {
+  FrameStats &stats = currentFrameStats();
+  if (same && eliding) {
+    ++stats.stateElided;
+    return true;
+  }
+  ++stats.stateIssued;
+  return false;
+}
+
+void GLStateCache::invalidate() {
+  program = UNKNOWN;
+  vao = UNKNOWN;
+  drawFramebuffer = UNKNOWN;
+  readFramebuffer = UNKNOWN;
+  activeUnit = UNKNOWN;
+  for (GLuint &texture : textures2D) {
+    texture = UNKNOWN;
+  }
+  for (int8_t &cap : caps) {
+    cap = -1;
+  }
+  stencilFuncKnown = false;
+  stencilWriteMask = UNKNOWN;
+  stencilOpKnown = false;
+  depthFuncValue = UNKNOWN;
+  depthWrite = -1;
+  blendFuncKnown = false;
+}
+
+// ==============================BINDINGS======================================
+void GLStateCache::useProgram(GLuint id) {
+  if (redundant(program == id)) {
+    return;
+  }
+  program = id;
+  glUseProgram(id);
+}
+
+void GLStateCache::bindVertexArray(GLuint id) {
+  if (redundant(vao == id)) {
+    return;
+  }
+  vao = id;
+  glBindVertexArray(id);
+}
+
+void GLStateCache::bindFramebuffer(GLenum target, GLuint fbo) {
+  bool same = (target != GL_READ_FRAMEBUFFER ? drawFramebuffer == fbo : true)
+    && (target != GL_DRAW_FRAMEBUFFER ? readFramebuffer == fbo : true);
+  if (redundant(same)) {
+    return;
+  }
+  if (target != GL_READ_FRAMEBUFFER) {
+    drawFramebuffer = fbo;
+  }
+  if (target != GL_DRAW_FRAMEBUFFER) {
+    readFramebuffer = fbo;
+  }
+  glBindFramebuffer(target, fbo);
+}
+
+void GLStateCache::activeTexture(GLenum unit) {
+  if (redundant(activeUnit == unit)) {
+    return;
+  }
+  activeUnit = unit;
+  glActiveTexture(unit);
+}
+
+void GLStateCache::bindTexture(GLenum target, GLuint texture) {
+  unsigned int unit = activeUnit - GL_TEXTURE0;
+  bool tracked = target == GL_TEXTURE_2D && activeUnit != UNKNOWN
+    && unit < TRACKED_UNITS;
+  if (redundant(tracked && textures2D[unit] == texture)) {
+    return;
+  }
+  if (tracked) {
+    textures2D[unit] = texture;
+  } else if (target == GL_TEXTURE_2D && activeUnit == UNKNOWN) {
+    //bound to some unit we don't know; all of them are suspect now
+    for (GLuint &bound : textures2D) {
+      bound = UNKNOWN;
+    }
+  }
+  glBindTexture(target, texture);
+}
+
+void GLStateCache::bindTexture2D(unsigned int unit, GLuint texture) {
+  if (unit < TRACKED_UNITS && eliding && textures2D[unit] == texture) {
+    ++currentFrameStats().stateElided;
+    return;
+  }
+  activeTexture(GL_TEXTURE0 + unit);
+  bindTexture(GL_TEXTURE_2D, texture);
+}
+
+// ==============================FIXED FUNCTION================================
+void GLStateCache::setCap(GLenum cap, bool on) {
+  int index{-1};
+  switch (cap) {
+    case GL_DEPTH_TEST:   index = CAP_DEPTH_TEST; break;
+    case GL_STENCIL_TEST: index = CAP_STENCIL_TEST; break;
+    case GL_BLEND:        index = CAP_BLEND; break;
+    case GL_CULL_FACE:    index = CAP_CULL_FACE; break;
+    case GL_SCISSOR_TEST: index = CAP_SCISSOR_TEST; break;
+  }
+  if (redundant(index >= 0 && caps[index] == on)) {
+    return;
+  }
+  if (index >= 0) {
+    caps[index] = on;
+  }
+  if (on) {
+    glEnable(cap);
+  } else {
+    glDisable(cap);
+  }
+}
+
+void GLStateCache::enable(GLenum cap) {
+  setCap(cap, true);
+}
+
+void GLStateCache::disable(GLenum cap) {
+  setCap(cap, false);
+}
+
+void GLStateCache::stencilFunc(GLenum func, GLint ref, GLuint mask) {
+  if (redundant(stencilFuncKnown && stencilFuncValue == func
+                && stencilRef == ref && stencilFuncMask == mask)) {
+    return;
+  }
+  stencilFuncKnown = true;
+  stencilFuncValue = func;
+  stencilRef = ref;
+  stencilFuncMask = mask;
+  glStencilFunc(func, ref, mask);
+}
+
+void GLStateCache::stencilMask(GLuint mask) {
+  if (redundant(stencilWriteMask == mask)) {
+    return;
+  }
+  stencilWriteMask = mask;
+  glStencilMask(mask);
+}
+
+void GLStateCache::stencilOp(GLenum stencilFail, GLenum depthFail,
+                             GLenum depthPass) {
+  if (redundant(stencilOpKnown && stencilOps[0] == stencilFail
+                && stencilOps[1] == depthFail
+                && stencilOps[2] == depthPass)) {
+    return;
+  }
+  stencilOpKnown = true;
+  stencilOps[0] = stencilFail;
+  stencilOps[1] = depthFail;
+  stencilOps[2] = depthPass;
+  glStencilOp(stencilFail, depthFail, depthPass);
+}
+
+void GLStateCache::depthFunc(GLenum func) {
+  if (redundant(depthFuncValue == func)) {
+    return;
+  }
+  depthFuncValue = func;
+  glDepthFunc(func);
+}
+
+void GLStateCache::depthMask(GLboolean flag) {
+  if (redundant(depthWrite == (flag ? 1 : 0))) {
+    return;
+  }
+  depthWrite = flag ? 1 : 0;
+  glDepthMask(flag);
+}
+
+void GLStateCache::blendFunc(GLenum source, GLenum destination) {
+  if (redundant(blendFuncKnown && blendSource == source
+                && blendDestination == destination)) {
+    return;
+  }
+  blendFuncKnown = true;
+  blendSource = source;
+  blendDestination = destination;
+  glBlendFunc(source, destination);
+}
+
+// ==============================DELETES=======================================
+//GL drops bindings of deleted objects (and hands their names out again), so
+//the shadow has to forget them too
+
+void GLStateCache::deleteProgram(GLuint id) {
+  if (program == id) {
+    program = UNKNOWN;
+  }
+  glDeleteProgram(id);
+}
+
+void GLStateCache::deleteVertexArrays(GLsizei count, const GLuint *vaos) {
+  for (GLsizei i{}; i < count; ++i) {
+    if (vao == vaos[i]) {
+      vao = 0;
+    }
+  }
+  glDeleteVertexArrays(count, vaos);
+}
+
+void GLStateCache::deleteFramebuffers(GLsizei count, const GLuint *fbos) {
+  for (GLsizei i{}; i < count; ++i) {
+    if (drawFramebuffer == fbos[i]) {
+      drawFramebuffer = 0;
+    }
+    if (readFramebuffer == fbos[i]) {
+      readFramebuffer = 0;
+    }
+  }
+  glDeleteFramebuffers(count, fbos);
+}
+
+void GLStateCache::deleteTextures(GLsizei count, const GLuint *ids) {
+  for (GLsizei i{}; i < count; ++i) {
+    for (GLuint &bound : textures2D) {
+      if (bound == ids[i]) {
+        bound = 0;
+      }
+    }
+  }
+  glDeleteTextures(count, ids);
+}
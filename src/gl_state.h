@@ -0,0 +1,89 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+
+//shadow copy of the GL state the renderers keep flipping: program, VAO,
+//framebuffers, 2D texture per unit, the active unit, enables, stencil,
+//depth and blend state. every setter compares against the shadow and only
+//calls GL when the value actually changes, so passes can set what they need
+//without caring what ran before them.
+//
+//this only works if everything goes through here: a direct glBindTexture
+//behind its back leaves the shadow wrong and the next call that looks
+//redundant gets dropped. deletes go through it too, since GL unbinds deleted
+//objects and reuses their names. state starts out unknown, so the first call
+//of every kind is issued. GL thread only.
+class GLStateCache {
+public:
+  static const unsigned int TRACKED_UNITS = 32;
+
+  void useProgram(GLuint program);
+  void bindVertexArray(GLuint vao);
+  //GL_FRAMEBUFFER sets both the draw and the read binding, like GL
+  void bindFramebuffer(GLenum target, GLuint fbo);
+  void activeTexture(GLenum unit); //GL_TEXTURE0 + i
+  //binds to the active unit; only GL_TEXTURE_2D is shadowed
+  void bindTexture(GLenum target, GLuint texture);
+  //texture on GL_TEXTURE_2D of unit. doesn't touch the active unit at all
+  //when it's already bound there
+  void bindTexture2D(unsigned int unit, GLuint texture);
+
+  void enable(GLenum cap);
+  void disable(GLenum cap);
+  void stencilFunc(GLenum func, GLint ref, GLuint mask);
+  void stencilMask(GLuint mask);
+  void stencilOp(GLenum stencilFail, GLenum depthFail, GLenum depthPass);
+  void depthFunc(GLenum func);
+  void depthMask(GLboolean flag);
+  void blendFunc(GLenum source, GLenum destination);
+
+  void deleteProgram(GLuint program);
+  void deleteVertexArrays(GLsizei count, const GLuint *vaos);
+  void deleteFramebuffers(GLsizei count, const GLuint *fbos);
+  void deleteTextures(GLsizei count, const GLuint *textures);
+
+  //forget everything, e.g. after making another context current
+  void invalidate();
+  //false: every call goes to GL (still counted), to compare against
+  void setEliding(bool on) { eliding = on; }
+  bool isEliding() const { return eliding; }
+
+private:
+  static const GLuint UNKNOWN = 0xFFFFFFFFu;
+  //enable caps with a shadow; others always go through
+  enum Cap { CAP_DEPTH_TEST, CAP_STENCIL_TEST, CAP_BLEND, CAP_CULL_FACE,
+             CAP_SCISSOR_TEST, CAP_COUNT };
+
+  bool eliding{true};
+  GLuint program{UNKNOWN};
+  GLuint vao{UNKNOWN};
+  GLuint drawFramebuffer{UNKNOWN}, readFramebuffer{UNKNOWN};
+  GLenum activeUnit{UNKNOWN};
+  GLuint textures2D[TRACKED_UNITS];
+  int8_t caps[CAP_COUNT]; //-1 unknown, 0 off, 1 on
+
+  bool stencilFuncKnown{false};
+  GLenum stencilFuncValue{}; GLint stencilRef{}; GLuint stencilFuncMask{};
+  GLuint stencilWriteMask{UNKNOWN};
+  bool stencilOpKnown{false};
+  GLenum stencilOps[3]{};
+  GLenum depthFuncValue{UNKNOWN};
+  int depthWrite{-1};
+  bool blendFuncKnown{false};
+  GLenum blendSource{}, blendDestination{};
+
+  friend GLStateCache &glState();
+  GLStateCache() { invalidate(); }
+
+  //true (and counted as elided) when the call can be skipped; otherwise
+  //counts it as issued
+  bool redundant(bool same);
+  void setCap(GLenum cap, bool on);
+};
+
+//the cache every renderer goes through
+GLStateCache &glState();
+
+#endif
@@ -0,0 +1,136 @@
+#include "gpu_profiler.h"
+
+#include <glad/glad.h>
+
+#include <fstream>
+#include <iomanip>
+
+GpuProfiler::GpuProfiler(size_t framesInFlight, size_t maxScopesPerFrame)
+: slots(framesInFlight < 2 ? 2 : framesInFlight),
+  maxScopes(maxScopesPerFrame), epoch(Clock::now()) {
+  for (FrameSlot &slot : slots) {
+    slot.queries.resize(maxScopes * 2);
+    glGenQueries(static_cast<GLsizei>(slot.queries.size()),
+                 slot.queries.data());
+    slot.scopes.reserve(maxScopes);
+  }
+}
+
+GpuProfiler::~GpuProfiler() {
+  for (FrameSlot &slot : slots) {
+    glDeleteQueries(static_cast<GLsizei>(slot.queries.size()),
+                    slot.queries.data());
+  }
+}
+
+void GpuProfiler::beginFrame() {
+  current = (current + 1) % slots.size();
+  FrameSlot &slot = slots[current];
+  //the oldest set comes back around; it was issued framesInFlight - 1
+  //frames ago so its results are (almost always) ready
+  if (slot.pending) {
+    resolve(slot);
+  }
+  slot.scopes.clear();
+  slot.frame = frameIndex++;
+
+  //pair the GPU clock with ours once per frame so GPU scopes can be put on
+  //the CPU timeline in the trace
+  GLint64 gpuNow{};
+  glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+  int64_t cpuNow = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    Clock::now() - epoch).count();
+  slot.gpuToCpuNs = cpuNow - gpuNow;
+
+  openDepth = 0;
+  inFrame = true;
+}
+
+void GpuProfiler::endFrame() {
+  slots[current].pending = !slots[current].scopes.empty();
+  inFrame = false;
+}
+
+int GpuProfiler::beginScope(const char *name) {
+  FrameSlot &slot = slots[current];
+  if (!inFrame || slot.scopes.size() == maxScopes) {
+    return -1;
+  }
+  int id = static_cast<int>(slot.scopes.size());
+  Scope scope;
+  scope.name = name;
+  scope.depth = openDepth++;
+  scope.cpuBegin = Clock::now();
+  scope.cpuEnd = scope.cpuBegin;
+  slot.scopes.push_back(scope);
+  glQueryCounter(slot.queries[id * 2], GL_TIMESTAMP);
+  return id;
+}
+
+void GpuProfiler::endScope(int scope) {
+  if (scope < 0) {
+    return;
+  }
+  FrameSlot &slot = slots[current];
+  glQueryCounter(slot.queries[scope * 2 + 1], GL_TIMESTAMP);
+  slot.scopes[scope].cpuEnd = Clock::now();
+  --openDepth;
+}
+
+void GpuProfiler::resolve(FrameSlot &slot) {
+  latestTimings.clear();
+  for (size_t i{}; i < slot.scopes.size(); ++i) {
+    const Scope &scope = slot.scopes[i];
+    GLuint64 begin{}, end{};
+    //GL_QUERY_RESULT only waits if the GPU is frames behind
+    glGetQueryObjectui64v(slot.queries[i * 2], GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(slot.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+
+    double cpuMs = std::chrono::duration<double, std::milli>(
+      scope.cpuEnd - scope.cpuBegin).count();
+    double gpuMs = (end - begin) / 1.0e6;
+    latestTimings.push_back({scope.name, scope.depth, gpuMs, cpuMs});
+
+    if (tracing) {
+      double cpuBeginUs = std::chrono::duration<double, std::micro>(
+        scope.cpuBegin - epoch).count();
+      trace.push_back({scope.name, 1, cpuBeginUs, cpuMs * 1000.0});
+      double gpuBeginUs =
+        (static_cast<int64_t>(begin) + slot.gpuToCpuNs) / 1000.0;
+      trace.push_back({scope.name, 2, gpuBeginUs, gpuMs * 1000.0});
+    }
+  }
+  latestFrameIndex = slot.frame;
+  slot.pending = false;
+}
+
+void GpuProfiler::flush() {
+  //oldest first so latest() ends up on the newest frame
+  for (size_t i{1}; i <= slots.size(); ++i) {
+    FrameSlot &slot = slots[(current + i) % slots.size()];
+    if (slot.pending) {
+      resolve(slot);
+    }
+  }
+}
+
+bool GpuProfiler::writeChromeTrace(const std::string &path) const {
+  std::ofstream out(path);
+  if (!out) {
+    return false;
+  }
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+      << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, "
+         "\"args\": {\"name\": \"CPU\"}},\n"
+      << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, "
+         "\"args\": {\"name\": \"GPU\"}}";
+  for (const TraceEvent &event : trace) {
+    out << ",\n{\"name\": \"" << event.name << "\", \"cat\": \""
+        << (event.tid == 1 ? "cpu" : "gpu") << "\", \"ph\": \"X\", "
+        << "\"pid\": 1, \"tid\": " << event.tid << ", \"ts\": "
+        << event.beginUs << ", \"dur\": " << event.durationUs << "}";
+  }
+  out << "\n]}\n";
+  return static_cast<bool>(out);
+}
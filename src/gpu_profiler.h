@@ -0,0 +1,112 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//per pass GPU (and matching CPU) timings from GL_TIMESTAMP queries.
+//queries are spread over framesInFlight sets, so a frame's results are only
+//read back framesInFlight - 1 frames later, when the GPU is long done with
+//them: no stalls in the normal case.
+//
+//  profiler.beginFrame();
+//  { ProfileScope scope(&profiler, "floor"); ...draws... }
+//  profiler.endFrame();
+class GpuProfiler {
+public:
+  struct PassTiming {
+    const char *name; //the pointer given to beginScope (string literals)
+    int depth;        //nesting level, 0 = top level
+    double gpuMs;
+    double cpuMs;
+  };
+
+  explicit GpuProfiler(size_t framesInFlight = 3,
+                       size_t maxScopesPerFrame = 64);
+  ~GpuProfiler();
+
+  GpuProfiler(const GpuProfiler &) = delete;
+  GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+  void beginFrame();
+  void endFrame();
+
+  //returns an id for endScope, or -1 if this frame is out of scope slots
+  int beginScope(const char *name);
+  void endScope(int scope);
+
+  //scopes of the most recent frame whose results are in, in begin order
+  const std::vector<PassTiming> &latest() const { return latestTimings; }
+  uint64_t latestFrame() const { return latestFrameIndex; }
+
+  //keep every resolved scope as a trace event (off by default, it grows)
+  void setTraceEnabled(bool enabled) { tracing = enabled; }
+  //chrome://tracing / Perfetto JSON: CPU scopes on tid 1, GPU on tid 2.
+  //call after flush() to include the frames still in flight.
+  bool writeChromeTrace(const std::string &path) const;
+
+  //blocks until every issued frame is resolved (eg before writing a trace)
+  void flush();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Scope {
+    const char *name;
+    int depth;
+    Clock::time_point cpuBegin, cpuEnd;
+  };
+  struct FrameSlot {
+    std::vector<unsigned int> queries; //2 per scope: begin, end
+    std::vector<Scope> scopes;
+    uint64_t frame{0};
+    int64_t gpuToCpuNs{0}; //add to a GPU timestamp to get CPU clock ns
+    bool pending{false};
+  };
+  struct TraceEvent {
+    const char *name;
+    int tid;
+    double beginUs, durationUs;
+  };
+
+  std::vector<FrameSlot> slots;
+  size_t maxScopes;
+  size_t current{0};
+  uint64_t frameIndex{0};
+  int openDepth{0};
+  bool inFrame{false};
+
+  std::vector<PassTiming> latestTimings;
+  uint64_t latestFrameIndex{0};
+  bool tracing{false};
+  std::vector<TraceEvent> trace;
+  Clock::time_point epoch;
+
+  void resolve(FrameSlot &slot);
+};
+
+//RAII profiler scope. a null profiler makes it a no-op, so call sites can
+//stay unconditional.
+class ProfileScope {
+public:
+  ProfileScope(GpuProfiler *profiler, const char *name)
+  : profiler(profiler), scope(profiler ? profiler->beginScope(name) : -1) {}
+  ~ProfileScope() {
+    if (profiler) {
+      profiler->endScope(scope);
+    }
+  }
+
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+  GpuProfiler *profiler;
+  int scope;
+};
+
+#endif
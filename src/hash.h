@@ -0,0 +1,27 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//64 bit FNV-1a. not cryptographic, just a cheap content fingerprint for the
+//on-disk caches; chain calls by passing the previous result as seed.
+constexpr uint64_t FNV1A_SEED = 0xcbf29ce484222325ull;
+
+inline uint64_t fnv1a64(const void *data, size_t size,
+                        uint64_t seed = FNV1A_SEED) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  uint64_t hash = seed;
+  for (size_t i{}; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+inline uint64_t fnv1a64(const std::string &str, uint64_t seed = FNV1A_SEED) {
+  return fnv1a64(str.data(), str.size(), seed);
+}
+
+#endif
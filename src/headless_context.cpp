@@ -0,0 +1,144 @@
+#include "headless_context.h"
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <iostream>
+
+#include "gl_ext.h"
+#include "gl_state.h"
+
+#ifdef DEPTHGL_HAS_EGL
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::~HeadlessContext() {
+  destroy();
+}
+
+#ifdef DEPTHGL_HAS_EGL
+
+static bool hasExtension(const char *extensions, const char *name) {
+  if (!extensions) {
+    return false;
+  }
+  size_t length = std::strlen(name);
+  for (const char *p = std::strstr(extensions, name); p;
+       p = std::strstr(p + length, name)) {
+    if ((p == extensions || p[-1] == ' ')
+      && (p[length] == ' ' || p[length] == '\0')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool HeadlessContext::create() {
+  EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+  const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY,
+                                                EGL_EXTENSIONS);
+  if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+      eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+      eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                      EGL_DEFAULT_DISPLAY, NULL);
+    }
+  }
+  if (eglDisplay == EGL_NO_DISPLAY) {
+    eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  EGLint major, minor;
+  if (eglDisplay == EGL_NO_DISPLAY
+    || !eglInitialize(eglDisplay, &major, &minor)) {
+    std::cout << "ERROR::HEADLESS::EGL_INIT_FAILED" << std::endl;
+    return false;
+  }
+  display = eglDisplay;
+
+  if (!hasExtension(eglQueryString(eglDisplay, EGL_EXTENSIONS),
+                    "EGL_KHR_surfaceless_context")) {
+    std::cout << "ERROR::HEADLESS::NO_SURFACELESS_CONTEXT" << std::endl;
+    destroy();
+    return false;
+  }
+
+  //no surface ever gets created, so the config only matters for the API
+  const EGLint configAttribs[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_NONE
+  };
+  EGLConfig config;
+  EGLint configCount{};
+  if (!eglChooseConfig(eglDisplay, configAttribs, &config, 1, &configCount)
+    || configCount == 0) {
+    //surfaceless displays may expose no pbuffer configs; any GL one will do
+    const EGLint anyGL[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    if (!eglChooseConfig(eglDisplay, anyGL, &config, 1, &configCount)
+      || configCount == 0) {
+      std::cout << "ERROR::HEADLESS::NO_CONFIG" << std::endl;
+      destroy();
+      return false;
+    }
+  }
+
+  eglBindAPI(EGL_OPENGL_API);
+  const EGLint contextAttribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+  EGLContext eglContext = eglCreateContext(eglDisplay, config,
+                                           EGL_NO_CONTEXT, contextAttribs);
+  if (eglContext == EGL_NO_CONTEXT) {
+    std::cout << "ERROR::HEADLESS::CONTEXT_CREATION_FAILED" << std::endl;
+    destroy();
+    return false;
+  }
+  context = eglContext;
+
+  if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                      eglContext)) {
+    std::cout << "ERROR::HEADLESS::MAKE_CURRENT_FAILED" << std::endl;
+    destroy();
+    return false;
+  }
+
+  if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    destroy();
+    return false;
+  }
+  loadGLExtensions((GLADloadproc)eglGetProcAddress);
+  glState().invalidate(); //a fresh context, whatever the shadow says
+  return true;
+}
+
+void HeadlessContext::destroy() {
+  if (display) {
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context) {
+      eglDestroyContext(display, context);
+    }
+    eglTerminate(display);
+  }
+  display = nullptr;
+  context = nullptr;
+}
+
+#else
+
+bool HeadlessContext::create() {
+  std::cout << "ERROR::HEADLESS::BUILT_WITHOUT_EGL" << std::endl;
+  return false;
+}
+
+void HeadlessContext::destroy() {
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+//window-less 3.3 core context through EGL, for render farm / CI boxes with no
+//display. prefers Mesa's surfaceless platform (works with llvmpipe, no X or
+//GPU needed) and falls back to the default EGL display. there is no default
+//framebuffer: render into an OffscreenTarget.
+//
+//only available when the build found EGL (DEPTHGL_HAS_EGL); otherwise
+//create() always fails.
+class HeadlessContext {
+public:
+  HeadlessContext() = default;
+  ~HeadlessContext();
+
+  HeadlessContext(const HeadlessContext &) = delete;
+  HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+  //creates the context, makes it current and loads GL through glad
+  bool create();
+  void destroy();
+
+private:
+  void *display{nullptr};
+  void *context{nullptr};
+};
+
+#endif
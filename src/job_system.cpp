@@ -0,0 +1,290 @@
+#include "job_system.h"
+
+#include <cstdlib>
+
+//how often an idle worker looks for work again before it goes to sleep
+static const int IDLE_SPINS = 64;
+
+//which system and deque the calling thread works for, if it's a worker
+struct WorkerIdentity {
+  const JobSystem *system{nullptr};
+  int index{-1};
+};
+static thread_local WorkerIdentity worker;
+//where a thread that isn't one of ours starts stealing
+static thread_local uint32_t foreignVictim{0};
+
+bool WorkStealingDeque::push(Job *job) {
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  int64_t t = top.load(std::memory_order_acquire);
+  if (b - t >= CAPACITY) {
+    return false;
+  }
+  jobs[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+  bottom.store(b + 1, std::memory_order_release); //publishes the job
+  return true;
+}
+
+Job *WorkStealingDeque::pop() {
+  int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = top.load(std::memory_order_relaxed);
+  if (t > b) { //empty
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  Job *job = jobs[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  if (t == b) {
+    //the last one: race the thieves for it
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed)) {
+      job = nullptr;
+    }
+    bottom.store(b + 1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+Job *WorkStealingDeque::steal() {
+  int64_t t = top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t b = bottom.load(std::memory_order_acquire);
+  if (t >= b) {
+    return nullptr;
+  }
+  Job *job = jobs[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+  if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                   std::memory_order_relaxed)) {
+    return nullptr; //somebody else got it
+  }
+  return job;
+}
+
+JobSystem::JobSystem(unsigned int workerCount)
+: owner(std::this_thread::get_id()) {
+  if (workerCount == 0) {
+    workerCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  states.reserve(workerCount + 1);
+  for (unsigned int i{}; i <= workerCount; ++i) {
+    states.push_back(std::make_unique<ThreadState>());
+    states.back()->victim = i + 1;
+  }
+  workers.reserve(workerCount);
+  for (unsigned int i{}; i < workerCount; ++i) {
+    workers.emplace_back(&JobSystem::workerLoop, this,
+                         static_cast<int>(i + 1));
+  }
+}
+
+JobSystem::~JobSystem() {
+  stopping.store(true);
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+  }
+  sleepCv.notify_all();
+  for (std::thread &thread : workers) {
+    thread.join();
+  }
+  //nothing left to steal them, run what the workers didn't get to
+  while (Job *job = find(0)) {
+    execute(job);
+  }
+}
+
+int JobSystem::threadIndex() const {
+  if (worker.system == this) {
+    return worker.index;
+  }
+  return std::this_thread::get_id() == owner ? 0 : -1;
+}
+
+Job *JobSystem::allocate() {
+  int self = threadIndex();
+  if (self >= 0) {
+    ThreadState &state = *states[self];
+    Job &job = state.ring[state.nextJob++ % JOB_RING];
+    //a slot is only reused once its job ran; when they all still wait,
+    //fall back to the heap
+    if (!job.busy.exchange(true, std::memory_order_acquire)) {
+      job.heap = false;
+      return &job;
+    }
+  }
+  Job *job = new Job;
+  job->heap = true;
+  return job;
+}
+
+void JobSystem::schedule(Job *job) {
+  int self = threadIndex();
+  if (self >= 0) {
+    if (!states[self]->deque.push(job)) {
+      execute(job); //deque full: nobody is short of work anyway
+      return;
+    }
+  } else {
+    std::lock_guard<std::mutex> lock(injectMutex);
+    injected.push_back(job);
+    injectedCount.fetch_add(1);
+  }
+  wake();
+}
+
+void JobSystem::wake() {
+  //seq_cst on both sides: either the sleeper sees the new epoch or we see
+  //the sleeper
+  epoch.fetch_add(1);
+  if (sleepers.load() > 0) {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    sleepCv.notify_one();
+  }
+}
+
+Job *JobSystem::find(int self) {
+  if (self >= 0) {
+    if (Job *job = states[self]->deque.pop()) {
+      return job;
+    }
+  }
+  if (injectedCount.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> lock(injectMutex);
+    if (!injected.empty()) {
+      Job *job = injected.back();
+      injected.pop_back();
+      injectedCount.fetch_sub(1);
+      return job;
+    }
+  }
+  size_t count = states.size();
+  uint32_t start = self >= 0 ? states[self]->victim++ : foreignVictim++;
+  for (size_t i{}; i < count; ++i) {
+    size_t victim = (start + i) % count;
+    if (static_cast<int>(victim) == self) {
+      continue;
+    }
+    if (Job *job = states[victim]->deque.steal()) {
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+void JobSystem::execute(Job *job) {
+  std::exception_ptr error;
+  try {
+    job->invoke(*job);
+  } catch (...) {
+    if (!job->counter) {
+      std::terminate(); //nobody could ever see it
+    }
+    error = std::current_exception();
+  }
+  job->destroy(*job);
+  JobCounter *counter = job->counter;
+  if (job->heap) {
+    delete job;
+  } else {
+    job->busy.store(false, std::memory_order_release);
+  }
+  if (counter) {
+    finish(*counter, error);
+  }
+}
+
+void JobSystem::keepError(JobCounter &counter, std::exception_ptr error) {
+  std::lock_guard<std::mutex> lock(counter.mutex);
+  if (!counter.error) {
+    counter.error = error;
+  }
+}
+
+void JobSystem::finish(JobCounter &counter, std::exception_ptr error) {
+  if (error) {
+    keepError(counter, error);
+  }
+  //not the last one: nothing else to do, and nothing else to touch
+  int64_t pending = counter.pending.load(std::memory_order_relaxed);
+  while (pending > 1) {
+    if (counter.pending.compare_exchange_weak(pending, pending - 1,
+                                              std::memory_order_acq_rel)) {
+      return;
+    }
+  }
+  //the last one drops it to zero under the lock: a waiter takes the lock
+  //before it returns, so the counter outlives this
+  std::vector<Job *> ready;
+  {
+    std::lock_guard<std::mutex> lock(counter.mutex);
+    if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      ready.swap(counter.continuations);
+    }
+  }
+  for (Job *job : ready) {
+    schedule(job);
+  }
+}
+
+void JobSystem::addContinuation(JobCounter &dependency, Job *job) {
+  {
+    std::lock_guard<std::mutex> lock(dependency.mutex);
+    if (!dependency.done()) {
+      dependency.continuations.push_back(job);
+      return;
+    }
+  }
+  schedule(job);
+}
+
+void JobSystem::wait(JobCounter &counter) {
+  int self = threadIndex();
+  while (!counter.done()) {
+    if (Job *job = find(self)) {
+      execute(job);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(counter.mutex);
+    error.swap(counter.error);
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void JobSystem::workerLoop(int index) {
+  worker.system = this;
+  worker.index = index;
+  for (;;) {
+    Job *job = find(index);
+    for (int spin{}; !job && spin < IDLE_SPINS; ++spin) {
+      std::this_thread::yield();
+      job = find(index);
+    }
+    if (job) {
+      execute(job);
+      continue;
+    }
+
+    uint64_t seen = epoch.load();
+    if ((job = find(index))) { //added before we read the epoch
+      execute(job);
+      continue;
+    }
+    if (stopping.load()) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    sleepers.fetch_add(1);
+    sleepCv.wait(lock, [&] {
+      return epoch.load() != seen || stopping.load();
+    });
+    sleepers.fetch_sub(1);
+  }
+}
@@ -0,0 +1,229 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class JobSystem;
+
+//a unit of work. the callable lives inline when it's small enough (no
+//allocation per job), boxed on the heap otherwise
+struct Job {
+  static const size_t STORAGE = 64;
+
+  void (*invoke)(Job &job);
+  void (*destroy)(Job &job);
+  class JobCounter *counter;   //signalled when the job is done; may be null
+  std::atomic<bool> busy{false}; //ring slot taken
+  bool heap{false};              //not from a ring: delete when done
+  alignas(std::max_align_t) unsigned char storage[STORAGE];
+};
+
+//counts unfinished jobs. wait() on it (through the JobSystem) to join them;
+//runAfter() jobs start once it drops to zero. it can be reused once it
+//reached zero. the first exception a counted job throws is kept and
+//rethrown by JobSystem::wait
+class JobCounter {
+public:
+  JobCounter() = default;
+  JobCounter(const JobCounter &) = delete;
+  JobCounter &operator=(const JobCounter &) = delete;
+
+  bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+  friend class JobSystem;
+  std::atomic<int64_t> pending{0};
+  std::mutex mutex;               //continuations and error
+  std::vector<Job *> continuations;
+  std::exception_ptr error;
+};
+
+//single owner, many thieves deque of jobs (Chase-Lev, in the C11 atomics
+//form of Le et al.). the owning thread pushes and pops at the bottom, other
+//threads steal from the top. fixed size: push fails when it's full
+class WorkStealingDeque {
+public:
+  static const int64_t CAPACITY = 4096; //power of two
+
+  bool push(Job *job);
+  Job *pop();
+  Job *steal();
+
+private:
+  alignas(64) std::atomic<int64_t> top{0};
+  alignas(64) std::atomic<int64_t> bottom{0};
+  std::atomic<Job *> jobs[CAPACITY];
+};
+
+//work stealing job system. every worker has its own deque; a worker that
+//runs dry steals from the others. the thread that created the system has a
+//deque too, and wait() makes it run jobs instead of blocking, so it helps
+//with whatever it's waiting for. any other thread can submit as well
+//(through a locked queue) and waits by helping too.
+//
+//jobs must not touch GL. a job without a counter must not throw
+class JobSystem {
+public:
+  //workerCount == 0 picks std::thread::hardware_concurrency()
+  explicit JobSystem(unsigned int workerCount = 0);
+  //runs whatever is still queued, then stops the workers
+  ~JobSystem();
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  //queues function(); counter (if any) counts it until it has run
+  template <class F>
+  void run(F &&function, JobCounter *counter = nullptr) {
+    Job *job = makeJob(std::forward<F>(function), counter);
+    schedule(job);
+  }
+
+  //queues function() to run once dependency reaches zero (right away if
+  //it's there already)
+  template <class F>
+  void runAfter(JobCounter &dependency, F &&function,
+                JobCounter *counter = nullptr) {
+    Job *job = makeJob(std::forward<F>(function), counter);
+    addContinuation(dependency, job);
+  }
+
+  //runs jobs until counter reaches zero, then rethrows the first exception
+  //a job counted by it threw
+  void wait(JobCounter &counter);
+
+  //body(i) for every i in [0, count), blocking until all are done; the
+  //calling thread takes part. the range is split in halves, lazily, down to
+  //grain indices per job; grain 0 picks about 8 jobs per thread, and 1 for
+  //few, big items
+  template <class F>
+  void parallelFor(size_t count, const F &body, size_t grain = 0) {
+    if (count == 0) {
+      return;
+    }
+    if (grain == 0) {
+      grain = std::max<size_t>(1, count / (threadCount() * 8));
+    }
+    JobCounter counter;
+    try {
+      splitRange(0, count, grain, body, counter);
+    } catch (...) {
+      //the queued halves still point at counter: wait for them first
+      keepError(counter, std::current_exception());
+    }
+    wait(counter);
+  }
+
+  //workers plus the creating thread
+  size_t threadCount() const { return workers.size() + 1; }
+  size_t workerCount() const { return workers.size(); }
+
+private:
+  static const size_t JOB_RING = 4096; //recycled jobs per thread
+
+  //per thread: its deque and the ring its jobs come from
+  struct alignas(64) ThreadState {
+    ThreadState() : ring(JOB_RING) {}
+
+    WorkStealingDeque deque;
+    std::vector<Job> ring;
+    size_t nextJob{0};
+    uint32_t victim{0}; //where stealing starts, rotated
+  };
+
+  std::vector<std::thread> workers;
+  //[0]: the creating thread, [1 + i]: worker i
+  std::vector<std::unique_ptr<ThreadState>> states;
+  std::thread::id owner;
+
+  //jobs from threads that aren't ours
+  std::mutex injectMutex;
+  std::vector<Job *> injected;
+  std::atomic<size_t> injectedCount{0};
+
+  //sleeping workers: epoch changes whenever work is added
+  std::mutex sleepMutex;
+  std::condition_variable sleepCv;
+  std::atomic<uint64_t> epoch{0};
+  std::atomic<int> sleepers{0};
+  std::atomic<bool> stopping{false};
+
+  //index into states for the calling thread, or -1 for a foreign one
+  int threadIndex() const;
+  Job *allocate();
+  void schedule(Job *job);
+  void wake();
+  //a job from here or anywhere else, or null
+  Job *find(int self);
+  void execute(Job *job);
+  void finish(JobCounter &counter, std::exception_ptr error);
+  void keepError(JobCounter &counter, std::exception_ptr error);
+  void addContinuation(JobCounter &dependency, Job *job);
+  void workerLoop(int index);
+
+  template <class F>
+  Job *makeJob(F &&function, JobCounter *counter) {
+    using Fn = typename std::decay<F>::type;
+    Job *job = allocate();
+    if constexpr (sizeof(Fn) <= Job::STORAGE
+                  && alignof(Fn) <= alignof(std::max_align_t)) {
+      new (job->storage) Fn(std::forward<F>(function));
+      job->invoke = [](Job &j) {
+        (*std::launder(reinterpret_cast<Fn *>(j.storage)))();
+      };
+      job->destroy = [](Job &j) {
+        std::launder(reinterpret_cast<Fn *>(j.storage))->~Fn();
+      };
+    } else {
+      Fn *boxed = new Fn(std::forward<F>(function));
+      std::memcpy(job->storage, &boxed, sizeof boxed);
+      job->invoke = [](Job &j) {
+        Fn *fn;
+        std::memcpy(&fn, j.storage, sizeof fn);
+        (*fn)();
+      };
+      job->destroy = [](Job &j) {
+        Fn *fn;
+        std::memcpy(&fn, j.storage, sizeof fn);
+        delete fn;
+      };
+    }
+    job->counter = counter;
+    if (counter) {
+      counter->pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    return job;
+  }
+
+  //queues the upper halves of [begin, end) as jobs until grain is left,
+  //then runs that part here
+  template <class F>
+  void splitRange(size_t begin, size_t end, size_t grain, const F &body,
+                  JobCounter &counter) {
+    while (end - begin > grain) {
+      size_t middle = begin + (end - begin) / 2;
+      run([this, middle, end, grain, &body, &counter]() {
+        splitRange(middle, end, grain, body, counter);
+      }, &counter);
+      end = middle;
+    }
+    for (size_t i{begin}; i < end; ++i) {
+      body(i);
+    }
+  }
+};
+
+#endif
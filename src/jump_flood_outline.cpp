@@ -0,0 +1,168 @@
+#include "jump_flood_outline.h"
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <iostream>
+
+#include "gl_state.h"
+#include "glm/glm.hpp"
+#include "outline_renderer.h"
+#include "shader.h"
+
+JumpFloodOutline::JumpFloodOutline(const std::string &shaderDir)
+: seedShader((shaderDir + "/fullscreen.glsl").c_str(),
+             (shaderDir + "/jfaSeed.glsl").c_str()),
+  stepShader((shaderDir + "/fullscreen.glsl").c_str(),
+             (shaderDir + "/jfaStep.glsl").c_str()),
+  compositeShader((shaderDir + "/fullscreen.glsl").c_str(),
+                  (shaderDir + "/jfaComposite.glsl").c_str()) {
+  stepSize = stepShader.uniform("stepSize");
+  compositeWidth = compositeShader.uniform("outlineWidth");
+  compositeColor = compositeShader.uniform("outlineColor");
+
+  //texture units are fixed: seeds on 1
+  stepShader.use();
+  stepShader.setInt("seeds", 1);
+  compositeShader.use();
+  compositeShader.setInt("seeds", 1);
+
+  //core profile wants some VAO bound even for attribute-less draws
+  glGenVertexArrays(1, &emptyVAO);
+}
+
+JumpFloodOutline::~JumpFloodOutline() {
+  releaseTargets();
+  glState().deleteVertexArrays(1, &emptyVAO);
+}
+
+static unsigned int makeTarget(unsigned int &fbo, GLint internalFormat,
+                               GLenum format, GLenum type,
+                               int width, int height) {
+  unsigned int texture;
+  glGenTextures(1, &texture);
+  glState().bindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format,
+               type, NULL);
+  //only ever read with texelFetch, but integer textures must not filter
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  glGenFramebuffers(1, &fbo);
+  glState().bindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         texture, 0);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cout << "ERROR::JUMP_FLOOD::FRAMEBUFFER_INCOMPLETE" << std::endl;
+  }
+  return texture;
+}
+
+void JumpFloodOutline::resize(int width, int height) {
+  if (width == targetWidth && height == targetHeight) {
+    return;
+  }
+  releaseTargets();
+  targetWidth = width;
+  targetHeight = height;
+  if (width <= 0 || height <= 0) {
+    return; //minimized window
+  }
+
+  //seeds are pixel coordinates; 16 bits each covers any sane resolution
+  //and 0xFFFF marks "no seed yet"
+  for (int i{}; i < 2; ++i) {
+    seedTexture[i] = makeTarget(seedFBO[i], GL_RG16UI, GL_RG_INTEGER,
+                                GL_UNSIGNED_SHORT, width, height);
+  }
+  //the first seed target gets a copy of the scene's stencil to seed from;
+  //same format as OffscreenTarget's and the window's, or the blit fails
+  glGenRenderbuffers(1, &stencilRBO);
+  glBindRenderbuffer(GL_RENDERBUFFER, stencilRBO);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  glState().bindFramebuffer(GL_FRAMEBUFFER, seedFBO[0]);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                            GL_RENDERBUFFER, stencilRBO);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cout << "ERROR::JUMP_FLOOD::FRAMEBUFFER_INCOMPLETE" << std::endl;
+  }
+  glState().bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void JumpFloodOutline::releaseTargets() {
+  if (seedFBO[0]) {
+    glState().deleteFramebuffers(2, seedFBO);
+    glState().deleteTextures(2, seedTexture);
+    glDeleteRenderbuffers(1, &stencilRBO);
+  }
+  stencilRBO = 0;
+  seedFBO[0] = seedFBO[1] = seedTexture[0] = seedTexture[1] = 0;
+}
+
+int JumpFloodOutline::passCount() const {
+  //steps of 2^k .. 4, 2, 1 reach any seed up to 2^(k+1) - 1 pixels away
+  int reach = static_cast<int>(std::ceil(outlineWidth)) + 1;
+  int passes{1};
+  for (int step{1}; step * 2 <= reach; step *= 2) {
+    ++passes;
+  }
+  return passes;
+}
+
+void JumpFloodOutline::draw(const OutlineRenderer &objects,
+                            unsigned int targetFbo) {
+  if (!seedFBO[0] || objects.drawCount() == 0) {
+    return;
+  }
+  glState().disable(GL_DEPTH_TEST);
+  glViewport(0, 0, targetWidth, targetHeight);
+  glState().bindVertexArray(emptyVAO);
+
+  //1. the selection's mask is the stencil the object pass already wrote:
+  //copy it next to the first seed target, no geometry is drawn again
+  glState().bindFramebuffer(GL_READ_FRAMEBUFFER, targetFbo);
+  glState().bindFramebuffer(GL_DRAW_FRAMEBUFFER, seedFBO[0]);
+  glState().stencilMask(0xFF);
+  glBlitFramebuffer(0, 0, targetWidth, targetHeight, 0, 0, targetWidth,
+                    targetHeight, GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+
+  //2. every covered pixel seeds itself, the rest starts without a seed
+  int current{0};
+  glState().bindFramebuffer(GL_FRAMEBUFFER, seedFBO[current]);
+  const GLuint noSeed[4]{0xFFFF, 0xFFFF, 0, 0};
+  glClearBufferuiv(GL_COLOR, 0, noSeed);
+  glState().stencilFunc(GL_EQUAL, 1, 0xFF);
+  glState().stencilMask(0x00);
+  seedShader.use();
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glState().disable(GL_STENCIL_TEST);
+
+  //3. flood with halving steps, ping-ponging between the two seed targets
+  stepShader.use();
+  for (int pass{passCount() - 1}; pass >= 0; --pass) {
+    glState().bindTexture2D(1, seedTexture[current]);
+    glState().bindFramebuffer(GL_FRAMEBUFFER, seedFBO[1 - current]);
+    stepShader.setInt(stepSize, 1 << pass);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    current = 1 - current;
+  }
+
+  //4. blend the outline over whatever is in the target, except over the
+  //selection itself
+  glState().bindTexture2D(1, seedTexture[current]);
+  glState().bindFramebuffer(GL_FRAMEBUFFER, targetFbo);
+  glState().enable(GL_STENCIL_TEST);
+  glState().stencilFunc(GL_NOTEQUAL, 1, 0xFF);
+  glState().enable(GL_BLEND);
+  glState().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  compositeShader.use();
+  compositeShader.setFloat(compositeWidth, outlineWidth);
+  compositeShader.setVec3(compositeColor, outlineColor);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glState().disable(GL_BLEND);
+
+  glState().enable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,61 @@
+#ifndef JUMP_FLOOD_OUTLINE_H
+#define JUMP_FLOOD_OUTLINE_H
+
+#include <glad/glad.h>
+#include <string>
+
+#include "glm/glm.hpp"
+#include "outline_renderer.h"
+#include "shader.h"
+
+//screen space alternative to OutlineRenderer::drawOutline. the mask is the
+//stencil the object pass left behind (1 where the selection is), so no
+//geometry is drawn again: a jump flood turns it into a nearest-seed field
+//in log2(width) + 1 fullscreen passes, and a final pass draws every pixel
+//within width of the mask. borders are pixel accurate and uniform for any
+//shape, and the cost only depends on resolution and width, not on how many
+//triangles the selection has.
+class JumpFloodOutline {
+public:
+  //shaderDir: directory holding the fullscreen/jfa*/vertexInstanced shaders
+  explicit JumpFloodOutline(const std::string &shaderDir);
+  ~JumpFloodOutline();
+
+  JumpFloodOutline(const JumpFloodOutline &) = delete;
+  JumpFloodOutline &operator=(const JumpFloodOutline &) = delete;
+
+  //(re)allocates the offscreen targets; cheap no-op if the size is unchanged
+  void resize(int width, int height);
+
+  void setWidth(float pixels) { outlineWidth = pixels; }
+  void setColor(const glm::vec3 &color) { outlineColor = color; }
+  float width() const { return outlineWidth; }
+
+  //number of fullscreen jump flood rounds the current width needs
+  int passCount() const;
+
+  //renders the outline of objects' selection onto targetFbo, whose stencil
+  //must hold 1 where objects.drawObjects drew it. targetFbo's depth/stencil
+  //has to be single sampled depth24/stencil8 and the size given to resize().
+  //expects depth and stencil testing enabled on entry (the render loop
+  //default) and leaves them that way, but not the stencil func or mask; the
+  //outline itself is drawn through everything, like the stencil path does
+  void draw(const OutlineRenderer &objects, unsigned int targetFbo = 0);
+
+private:
+  Shader seedShader, stepShader, compositeShader;
+  UniformHandle stepSize;
+  UniformHandle compositeWidth, compositeColor;
+
+  int targetWidth{0}, targetHeight{0};
+  unsigned int emptyVAO{0};
+  unsigned int stencilRBO{0}; //copy of the target's, on seedFBO[0]
+  unsigned int seedFBO[2]{0, 0}, seedTexture[2]{0, 0};
+
+  float outlineWidth{4.0f};
+  glm::vec3 outlineColor{1.0f, 0.0f, 0.0f};
+
+  void releaseTargets();
+};
+
+#endif
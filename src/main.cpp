@@ -1,24 +1,40 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
 #include <filesystem>
+#include <string>
 
 #include "camera.h"
+#include "frame_capture.h"
+#include "gl_ext.h"
+#include "gpu_profiler.h"
 #include "glm/detail/type_mat.hpp"
 #include "glm/detail/type_vec.hpp"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
-#include "model.h"
-#include "shader.h"
+#include "headless_context.h"
+#include "job_system.h"
+#include "offscreen_target.h"
+#include "picking.h"
+#include "png_writer.h"
+#include "program_cache.h"
+#include "scene.h"
 #include "stb_image.h"
+#include "texture_cache.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void key_callback(GLFWwindow* window, int key, int scancode, int action,
+                  int mods);
+void mouse_button_callback(GLFWwindow* window, int button, int action,
+                           int mods);
 void process_input(GLFWwindow *window);
-unsigned int loadTexture(char const *path);
+int runHeadless(int argc, char *argv[]);
 
 const unsigned int SCREEN_WIDTH = 800;
 const unsigned int SCREEN_HEIGHT = 600;
@@ -37,6 +53,15 @@ float lastFrame{};
 
 glm::vec3 lightPosition(1.2f, 1.0f, 2.0f);
 
+//how the selection outline is drawn; O switches between the two
+OutlineMode outlineMode = OUTLINE_STENCIL_SCALE;
+
+//C releases the cursor from mouse look (and captures it again); a left
+//click picks the cube under it, or under the screen centre while captured,
+//and toggles its outline
+bool cursorCaptured = true;
+bool pickRequested = false;
+
 namespace fs = std::filesystem;
 //projectRoot assumes build was compiled from cmake-build-debug, which is not ideal
 //however the fix involves a decent amount of hackish code and im the only one running this
@@ -44,7 +69,52 @@ namespace fs = std::filesystem;
 fs::path projectRoot = fs::current_path().parent_path(); //mehhhh
 fs::path srcRoot = projectRoot / "src";
 
+//value of a --name=value command line option, or fallback
+static std::string optionValue(int argc, char *argv[], const std::string &name,
+                               const std::string &fallback) {
+  std::string prefix = "--" + name + "=";
+  for (int i{1}; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--" + name) {
+      return "1";
+    }
+    if (arg.compare(0, prefix.size(), prefix) == 0) {
+      return arg.substr(prefix.size());
+    }
+  }
+  return fallback;
+}
+
+//linked programs are cached in <root>/.shadercache; --shader-cache=off (or
+//another directory) to change that
+static std::string shaderCacheDir(int argc, char *argv[]) {
+  std::string dir = optionValue(argc, argv, "shader-cache",
+                                (projectRoot / ".shadercache").string());
+  return dir == "off" ? "" : dir;
+}
+
+static void printShaderStats() {
+  const ShaderBuildStats &stats = Shader::buildStats();
+  std::cout << "shaders: " << stats.programs << " programs ("
+            << stats.cacheHits << " from cache), read " << stats.readMs
+            << " ms, compile " << stats.compileMs << " ms, link "
+            << stats.linkMs << " ms, binary load " << stats.binaryLoadMs
+            << " ms, binary store " << stats.binaryStoreMs << " ms"
+            << std::endl;
+}
+
+static void printTextureStats() {
+  TextureCache::Stats stats = TextureCache::instance().stats();
+  std::cout << "textures: " << stats.liveTextures << " resident ("
+            << stats.residentBytes / 1024 << " KiB), " << stats.hits
+            << " cache hits, " << stats.misses << " misses" << std::endl;
+}
+
 int main(int argc, char *argv[]) {
+  if (optionValue(argc, argv, "headless", "") != "") {
+    return runHeadless(argc, argv);
+  }
+
 // ======================GLAD+GLFW INITIALIZATION==============================
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -62,6 +132,8 @@ int main(int argc, char *argv[]) {
   glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
   glfwSetCursorPosCallback(window, mouse_callback);
   glfwSetScrollCallback(window, scroll_callback);
+  glfwSetKeyCallback(window, key_callback);
+  glfwSetMouseButtonCallback(window, mouse_button_callback);
 
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
@@ -70,110 +142,24 @@ int main(int argc, char *argv[]) {
     std::cout << "Failed to initialize GLAD" << std::endl;
     return -1;
   }
+  loadGLExtensions((GLADloadproc)glfwGetProcAddress);
+  ProgramCache::setDirectory(shaderCacheDir(argc, argv));
   stbi_set_flip_vertically_on_load(true);
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-
-    glEnable(GL_STENCIL_TEST);
-    glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
-    glStencilOp(GL_KEEP, GL_REPLACE, GL_REPLACE);
-
-  //=============================SHADER INITIALIZATION===========================
- 
-  fs::path shaderRoot = srcRoot / "shaders";
-  Shader shader((srcRoot / "shaders" / "vertex.glsl").c_str(),
-                (srcRoot / "shaders" / "fragment.glsl").c_str());
-  Shader singleColorShader((srcRoot / "shaders" / "vertex.glsl").c_str(),
-                (srcRoot / "shaders" / "shaderSingleColor.glsl").c_str());
-
-float cubeVertices[] = {
-        // positions          // texture Coords
-        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-         0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-
-        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-         0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-         0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-         0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
-         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
-    };
-    float planeVertices[] = {
-        // positions          // texture Coords (note we set these higher than 1 (together with GL_REPEAT as texture wrapping mode). this will cause the floor texture to repeat)
-         5.0f, -0.5f,  5.0f,  2.0f, 0.0f,
-        -5.0f, -0.5f,  5.0f,  0.0f, 0.0f,
-        -5.0f, -0.5f, -5.0f,  0.0f, 2.0f,
-
-         5.0f, -0.5f,  5.0f,  2.0f, 0.0f,
-        -5.0f, -0.5f, -5.0f,  0.0f, 2.0f,
-         5.0f, -0.5f, -5.0f,  2.0f, 2.0f								
-    };
-
-  // cube VAO
-  unsigned int cubeVAO, cubeVBO;
-  glGenVertexArrays(1, &cubeVAO);
-  glGenBuffers(1, &cubeVBO);
-  glBindVertexArray(cubeVAO);
-  glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), &cubeVertices, GL_STATIC_DRAW);
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-  glBindVertexArray(0);
-  // plane VAO
-  unsigned int planeVAO, planeVBO;
-  glGenVertexArrays(1, &planeVAO);
-  glGenBuffers(1, &planeVBO);
-  glBindVertexArray(planeVAO);
-  glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), &planeVertices, GL_STATIC_DRAW);
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-  glBindVertexArray(0);
-  //enable polygon mode
-  //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-  unsigned int cubeTexture  = loadTexture((projectRoot / "textures" / "marble.jpg").c_str());
-  unsigned int floorTexture = loadTexture((projectRoot /  "textures" / "metal.png").c_str());
-
-  shader.use();
-  shader.setInt("texture1", 0);
-
+  //======================SCENE (SHADERS, GEOMETRY, TEXTURES)====================
+  {
+  //the app's one set of workers; everything off the GL thread shares it
+  JobSystem jobs;
+  Scene scene(projectRoot, jobs);
+  printShaderStats();
+  printTextureStats();
+  //--trace=out.json: per pass CPU/GPU timings as a chrome trace on exit
+  std::string tracePath = optionValue(argc, argv, "trace", "");
+  GpuProfiler profiler;
+  profiler.setTraceEnabled(!tracePath.empty());
+  scene.setProfiler(&profiler);
+
+  uint64_t framesRecorded{};
   // =============================RENDERING LOOP=================================
   while (!glfwWindowShouldClose(window)) {
     float currentFrame = glfwGetTime();
@@ -183,87 +169,147 @@ float cubeVertices[] = {
     // input
     process_input(window);
 
-    // rendering commands
-    glClearColor(0.05f, 0.05, 0.05f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-    
-    glm::mat4 model = glm::mat4(1.0f);
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    scene.resize(framebufferWidth, framebufferHeight);
+    scene.setOutlineMode(outlineMode);
+
     glm::mat4 view = camera.GetViewMatrix();
     glm::mat4 projection =
       glm::perspective(glm::radians(camera.Zoom),
                        (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT,
                        0.1f, 100.0f);
-    singleColorShader.use();
-    singleColorShader.setMat4("view", view);
-    singleColorShader.setMat4("projection", projection);
-
-    shader.use();
-    shader.setMat4("view", view);
-    shader.setMat4("projection", projection);
-
-
-    // floor (leave stencil buffer be)
-    glStencilMask(0x00);
-    glBindVertexArray(planeVAO);
-    glBindTexture(GL_TEXTURE_2D, floorTexture);
-    shader.setMat4("model", glm::mat4(1.0f));
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
-
-// 1st render pass: draw cubes and update stencil buffer with their fragments
-    //update visible fragments 
-    glStencilFunc(GL_ALWAYS , 1 , 0xFF); //fragment always passes stencil test
-    glStencilMask(0xFF); //enable writing to stencil buffer
-
-    // cubes
-    glBindVertexArray(cubeVAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, cubeTexture); 	
-    model = glm::translate(model, glm::vec3(-1.0f, 0.01f, -1.0f));
-    shader.setMat4("model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(2.0f, 0.01f, 0.0f));
-    shader.setMat4("model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-
-// 2nd render pass: scale cubes and draw them where they don't overlap with
-// cubes from the 1st render pass 
-// TLDR: draw borders
-    glStencilFunc(GL_NOTEQUAL, 1 , 0xFF);
-    glStencilMask(0x00); //disable writing to stencil buffer
-    glDisable(GL_DEPTH_TEST); //borders can be seen through objects
-    singleColorShader.use(); 
-    float scaler = 1.1f;
-
-    //draw border cubes
-    glBindVertexArray(cubeVAO);
-    glBindTexture(GL_TEXTURE_2D, cubeTexture);
-    model = glm::mat4(1.0);
-    model = glm::translate(model, glm::vec3(-1.0, 0.01f, -1.0f));
-    model = glm::scale(model, glm::vec3(scaler));
-    singleColorShader.setMat4("model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(2.0f, 0.01f, 0.0f));
-    model = glm::scale(model, glm::vec3(scaler, scaler, scaler));
-    singleColorShader.setMat4("model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-
-    glBindVertexArray(0); 
-    glStencilMask(0xFF); //enable to clear buffer to zero
-    glStencilFunc(GL_ALWAYS, 0, 0xFF); //clear buffer to zero
-    glEnable(GL_DEPTH_TEST);
+    if (pickRequested) {
+      pickRequested = false;
+      int windowWidth, windowHeight;
+      glfwGetWindowSize(window, &windowWidth, &windowHeight);
+      double cursorX = windowWidth / 2.0, cursorY = windowHeight / 2.0;
+      if (!cursorCaptured) {
+        glfwGetCursorPos(window, &cursorX, &cursorY);
+      }
+      int object = scene.pick(rayFromScreen(
+        static_cast<float>(cursorX), static_cast<float>(cursorY),
+        windowWidth, windowHeight, view, projection));
+      if (object >= 0) {
+        scene.setSelected(object, !scene.isSelected(object));
+      }
+    }
+    scene.setTime(currentFrame);
+    //the workers record this frame while the GL thread submits the one
+    //before it, so what's on screen is one frame behind the input
+    scene.record(view, projection);
+    if (framesRecorded++ > 0) {
+      profiler.beginFrame();
+      scene.submit();
+      profiler.endFrame();
+    }
 
     // check + call events & swap buffers
     glfwSwapBuffers(window);
     glfwPollEvents();
   }
+  if (!tracePath.empty()) {
+    profiler.flush();
+    profiler.writeChromeTrace(tracePath);
+  }
+  } //scene's GL objects go before the context does
 
   glfwTerminate();
   return 0;
 }
 
+// renders --frames=N frames at --size=WxH into an FBO with no window at all
+// (EGL, works on Mesa llvmpipe). with --capture=DIR every frame is read back
+// asynchronously and written to DIR/frame_00000.png...
+int runHeadless(int argc, char *argv[]) {
+  int frames = std::stoi(optionValue(argc, argv, "frames", "60"));
+  std::string size = optionValue(argc, argv, "size", "800x600");
+  std::string captureDir = optionValue(argc, argv, "capture", "");
+  std::string tracePath = optionValue(argc, argv, "trace", "");
+  int width = SCREEN_WIDTH, height = SCREEN_HEIGHT;
+  size_t x = size.find('x');
+  if (x != std::string::npos) {
+    width = std::stoi(size.substr(0, x));
+    height = std::stoi(size.substr(x + 1));
+  }
+  if (optionValue(argc, argv, "outline", "stencil") == "jfa") {
+    outlineMode = OUTLINE_JUMP_FLOOD;
+  }
+
+  HeadlessContext context;
+  if (!context.create()) {
+    return -1;
+  }
+  ProgramCache::setDirectory(shaderCacheDir(argc, argv));
+  stbi_set_flip_vertically_on_load(true);
+  if (!captureDir.empty()) {
+    fs::create_directories(captureDir);
+  }
+
+  {
+  OffscreenTarget target(width, height);
+  if (!target.complete()) {
+    return -1;
+  }
+  JobSystem jobs; //shared by everything off the GL thread
+  Scene scene(projectRoot, jobs);
+  printShaderStats();
+  printTextureStats();
+  scene.resize(width, height);
+  scene.setOutlineMode(outlineMode);
+  GpuProfiler profiler;
+  profiler.setTraceEnabled(!tracePath.empty());
+  scene.setProfiler(&profiler);
+  FrameCapture capture(width, height);
+  FrameCapture::Sink writeFrame = [&](uint64_t frame,
+                                      const unsigned char *rgba,
+                                      int w, int h) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%05llu.png",
+                  static_cast<unsigned long long>(frame));
+    //GL rows are bottom up
+    if (!writePng((fs::path(captureDir) / name).string(), rgba, w, h, 4,
+                  true)) {
+      std::cout << "ERROR::HEADLESS::PNG_WRITE_FAILED " << name << std::endl;
+    }
+  };
+
+  glViewport(0, 0, width, height);
+  //no input here; a fixed timestep keeps runs reproducible
+  deltaTime = 1.0f / 60.0f;
+  for (int frame{}; frame < frames; ++frame) {
+    glm::mat4 view = camera.GetViewMatrix();
+    glm::mat4 projection =
+      glm::perspective(glm::radians(camera.Zoom),
+                       (float)width / (float)height, 0.1f, 100.0f);
+    scene.setTime(frame * deltaTime);
+    profiler.beginFrame();
+    scene.render(view, projection, target.fbo());
+    profiler.endFrame();
+
+    if (!captureDir.empty()) {
+      capture.capture(target.fbo(), static_cast<uint64_t>(frame), writeFrame);
+      capture.poll(writeFrame);
+    }
+  }
+  if (!captureDir.empty()) {
+    capture.flush(writeFrame);
+  }
+  profiler.flush();
+  for (const GpuProfiler::PassTiming &pass : profiler.latest()) {
+    std::cout << pass.name << ": gpu " << pass.gpuMs << " ms, cpu "
+              << pass.cpuMs << " ms" << std::endl;
+  }
+  if (!tracePath.empty()) {
+    profiler.writeChromeTrace(tracePath);
+  }
+  glFinish();
+  std::cout << "rendered " << frames << " frames at " << width << "x"
+            << height << std::endl;
+  }
+  return 0;
+}
+
 
 void process_input(GLFWwindow *window) {
   if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
@@ -286,11 +332,35 @@ void process_input(GLFWwindow *window) {
   }
 }
 
+void key_callback(GLFWwindow* window, int key, int scancode, int action,
+                  int mods) {
+  if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+    outlineMode = (outlineMode == OUTLINE_STENCIL_SCALE)
+      ? OUTLINE_JUMP_FLOOD : OUTLINE_STENCIL_SCALE;
+  }
+  if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+    cursorCaptured = !cursorCaptured;
+    glfwSetInputMode(window, GLFW_CURSOR, cursorCaptured
+                     ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
+    firstMouse = true; //no jump when mouse look comes back
+  }
+}
+
+void mouse_button_callback(GLFWwindow* window, int button, int action,
+                           int mods) {
+  if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+    pickRequested = true; //the render loop has the matrices
+  }
+}
+
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
   glViewport(0, 0, width, height);
 }
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
+  if (!cursorCaptured) {
+    return;
+  }
   if (firstMouse){
     lastX = xpos;
     lastY = ypos;
@@ -308,40 +378,3 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset){
   camera.ProcessMouseScroll(yoffset);
 }
-
-unsigned int loadTexture(char const *path)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
-}
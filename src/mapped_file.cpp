@@ -0,0 +1,64 @@
+#include "mapped_file.h"
+
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_USE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+bool MappedFile::open(const std::string &path) {
+  close();
+#ifdef MAPPED_FILE_USE_MMAP
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+  void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                       MAP_PRIVATE, fd, 0);
+  ::close(fd); //the mapping keeps its own reference to the file
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  bytes = static_cast<const unsigned char *>(mapping);
+  length = static_cast<size_t>(info.st_size);
+  return true;
+#else
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  fallback.assign(std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>());
+  if (fallback.empty()) {
+    return false;
+  }
+  bytes = fallback.data();
+  length = fallback.size();
+  return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifdef MAPPED_FILE_USE_MMAP
+  if (bytes) {
+    munmap(const_cast<unsigned char *>(bytes), length);
+  }
+#endif
+  fallback.clear();
+  bytes = nullptr;
+  length = 0;
+}
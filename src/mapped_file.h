@@ -0,0 +1,33 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//read only view of a whole file. mmap'd on POSIX; elsewhere the file is
+//read into memory, which is slower but behaves the same to callers.
+class MappedFile {
+public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string &path) { open(path); }
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  //returns false (and stays closed) if the file can't be opened or is empty
+  bool open(const std::string &path);
+  void close();
+
+  bool isOpen() const { return bytes != nullptr; }
+  const unsigned char *data() const { return bytes; }
+  size_t size() const { return length; }
+
+private:
+  const unsigned char *bytes{nullptr};
+  size_t length{};
+  std::vector<unsigned char> fallback; //only used without mmap
+};
+
+#endif
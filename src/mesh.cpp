@@ -1,30 +1,172 @@
 #include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "gl_state.h"
 #include "glm/glm.hpp"
 #include "mesh.h"
+#include "mesh_arena.h"
 #include "shader.h"
 
 
 Mesh::Mesh(std::vector<Vertex> vertecies,
            std::vector<unsigned int> indices,
-           std::vector<Texture> textures) { 
-  //TODO: make sure this is move constructed
-  this->vertecies = vertecies;
-  this->indices = indices;
-  this->textures = textures;
-  
-  setupMesh();
+           std::vector<Texture> textures,
+           bool keepCpuData,
+           const MeshUploadOptions &upload) 
+: vertecies(std::move(vertecies)), indices(std::move(indices)),
+  textures(std::move(textures)), format(upload.vertexFormat),
+  arena(upload.arena) {
+  buildSamplerNames();
+  setupMesh(this->vertecies.data(), this->vertecies.size(),
+            this->indices.data(), this->indices.size(),
+            upload.splitForShortIndices);
+  if (!keepCpuData) {
+    releaseCpuData();
+  }
 }
 
-void Mesh::Draw(Shader &shader) const {
-  unsigned int diffuseNr, specularNr, normalNr{1};
+Mesh::Mesh(const Vertex *vertexData, size_t vertexCount,
+           const unsigned int *indexData, size_t indexCount,
+           std::vector<Texture> textures,
+           const MeshUploadOptions &upload)
+: textures(std::move(textures)), format(upload.vertexFormat),
+  arena(upload.arena) {
+  buildSamplerNames();
+  setupMesh(vertexData, vertexCount, indexData, indexCount,
+            upload.splitForShortIndices);
+}
+
+Mesh::~Mesh() {
+  releaseGpuData();
+}
+
+Mesh::Mesh(Mesh &&other) noexcept
+: vertecies(std::move(other.vertecies)), indices(std::move(other.indices)),
+  textures(std::move(other.textures)),
+  VBO(other.VBO), VAO(other.VAO), EBO(other.EBO),
+  indexCount(other.indexCount), vertexCount(other.vertexCount),
+  elementType(other.elementType), ranges(std::move(other.ranges)),
+  format(other.format), dequant(other.dequant), bounds(other.bounds),
+  sphere(other.sphere), arena(other.arena),
+  arenaVertexOffset(other.arenaVertexOffset),
+  arenaIndexOffset(other.arenaIndexOffset),
+  samplerNames(std::move(other.samplerNames)),
+  samplerProgram(other.samplerProgram),
+  samplerHandles(std::move(other.samplerHandles)),
+  scaleHandle(other.scaleHandle), offsetHandle(other.offsetHandle) {
+  //moved from meshes own nothing, so their destructor is a no-op
+  other.VBO = other.VAO = other.EBO = 0;
+  other.indexCount = other.vertexCount = 0;
+  other.arena = nullptr;
+}
+
+Mesh &Mesh::operator=(Mesh &&other) noexcept {
+  if (this != &other) {
+    releaseGpuData();
+    vertecies = std::move(other.vertecies);
+    indices = std::move(other.indices);
+    textures = std::move(other.textures);
+    VBO = other.VBO;
+    VAO = other.VAO;
+    EBO = other.EBO;
+    indexCount = other.indexCount;
+    vertexCount = other.vertexCount;
+    elementType = other.elementType;
+    ranges = std::move(other.ranges);
+    format = other.format;
+    dequant = other.dequant;
+    bounds = other.bounds;
+    sphere = other.sphere;
+    arena = other.arena;
+    arenaVertexOffset = other.arenaVertexOffset;
+    arenaIndexOffset = other.arenaIndexOffset;
+    samplerNames = std::move(other.samplerNames);
+    samplerProgram = other.samplerProgram;
+    samplerHandles = std::move(other.samplerHandles);
+    scaleHandle = other.scaleHandle;
+    offsetHandle = other.offsetHandle;
+    other.VBO = other.VAO = other.EBO = 0;
+    other.indexCount = other.vertexCount = 0;
+    other.arena = nullptr;
+  }
+  return *this;
+}
+
+void Mesh::releaseCpuData() {
+  //swap with empties so the capacity is actually returned
+  std::vector<Vertex>().swap(vertecies);
+  std::vector<unsigned int>().swap(indices);
+}
+
+//textures go away with the last Texture::handle that refers to them
+void Mesh::releaseGpuData() {
+  if (arena) {
+    //the VAO and buffers are the arena's, only the ranges are ours
+    arena->releaseVertices(arenaVertexOffset, vertexCount);
+    arena->releaseIndices(arenaIndexOffset, indexCount);
+    arena = nullptr;
+    VAO = 0;
+    return;
+  }
+  if (VAO) {
+    glState().deleteVertexArrays(1, &VAO);
+  }
+  if (VBO) {
+    glDeleteBuffers(1, &VBO);
+  }
+  if (EBO) {
+    glDeleteBuffers(1, &EBO);
+  }
+  VAO = VBO = EBO = 0;
+}
+
+void Mesh::bind(Shader &shader) const {
+  //names never change, only their locations do (per program), so resolve
+  //them again only when a different shader shows up
+  if (samplerProgram != shader.ID || samplerHandles.size() != textures.size()) {
+    samplerHandles.clear();
+    for (const std::string &name : samplerNames) {
+      samplerHandles.push_back(shader.uniform(name));
+    }
+    scaleHandle = shader.uniform("positionScale");
+    offsetHandle = shader.uniform("positionOffset");
+    samplerProgram = shader.ID;
+  }
+
+  if (format == VERTEX_COMPACT) {
+    shader.setVec3(scaleHandle, dequant.scale);
+    shader.setVec3(offsetHandle, dequant.offset);
+  }
+
   for (unsigned int i{}; i < textures.size(); ++i) {
-    glActiveTexture(GL_TEXTURE0 + i);
+    shader.setInt(samplerHandles[i], i);
+    glState().bindTexture2D(i, textures[i].id);
+  }
+}
 
+void Mesh::Draw(Shader &shader) const {
+  bind(shader);
+  glState().bindVertexArray(VAO);
+  for (const DrawRange &range : ranges) {
+    glDrawElementsBaseVertex(GL_TRIANGLES, range.count, elementType,
+                             (void*)range.offset, range.baseVertex);
+  }
+  //the VAO and textures stay bound: whoever draws next binds its own, and
+  //the state cache drops the bind when it's the same
+}
+
+//texture_diffuse1, texture_diffuse2, texture_specular1... in texture order
+void Mesh::buildSamplerNames() {
+  unsigned int diffuseNr{1}, specularNr{1}, normalNr{1};
+  samplerNames.clear();
+  for (const Texture &texture : textures) {
     std::string number;
-    std::string name = textures[i].type;
+    const std::string &name = texture.type;
     if (name == "texture_diffuse") {
       number = std::to_string(diffuseNr++); //note incr. order
     }
@@ -34,25 +176,104 @@ void Mesh::Draw(Shader &shader) const {
     else if (name == "texture_normal") {
       number = std::to_string(normalNr++); //note incr. order
     }
-
-    shader.setInt((name + number).c_str(), i);
-    glBindTexture(GL_TEXTURE_2D, textures[i].id);
+    samplerNames.push_back(name + number);
   }
-  glBindVertexArray(VAO);
-  glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()),
-                 GL_UNSIGNED_INT, 0);
-  glBindVertexArray(0);
+}
+
+//largest vertex count one 16 bit index range can address
+static const size_t MAX_SHORT_VERTICES = 65536;
+
+size_t Mesh::indexBytes() const {
+  size_t size = elementType == GL_UNSIGNED_BYTE ? 1
+    : elementType == GL_UNSIGNED_SHORT ? 2 : 4;
+  return indexCount * size;
+}
 
-  glActiveTexture(GL_TEXTURE0); //optional: reset texture unit (good practice)
+//cuts the triangle list, in order, into runs that touch at most maxVertices
+//vertecies each. every run gets its own copy of those vertecies, and its
+//indices are rewritten relative to the run's first vertex
+static std::vector<Mesh::IndexRun> splitIndexRuns(
+  const Vertex *vertexData, size_t vertexCount,
+  const unsigned int *indexData, size_t indexCount, size_t maxVertices,
+  std::vector<Vertex> &splitVertecies,
+  std::vector<unsigned int> &splitIndices) {
+  const unsigned int unused = ~0u;
+  std::vector<unsigned int> local(vertexCount, unused);
+  std::vector<unsigned int> touched;
+  std::vector<Mesh::IndexRun> runs{{0, 0}};
+  splitIndices.reserve(indexCount);
+  for (size_t t{}; t + 2 < indexCount; t += 3) {
+    size_t added{};
+    for (int k{}; k < 3; ++k) {
+      added += local[indexData[t + k]] == unused;
+    }
+    if (touched.size() + added > maxVertices) {
+      for (unsigned int v : touched) {
+        local[v] = unused;
+      }
+      touched.clear();
+      runs.push_back({splitIndices.size(), splitVertecies.size()});
+    }
+    for (int k{}; k < 3; ++k) {
+      unsigned int v = indexData[t + k];
+      if (local[v] == unused) {
+        local[v] = static_cast<unsigned int>(touched.size());
+        touched.push_back(v);
+        splitVertecies.push_back(vertexData[v]);
+      }
+      splitIndices.push_back(local[v]);
+    }
+  }
+  return runs;
 }
 
+void Mesh::setupMesh(const Vertex *vertexData, size_t vertexCount,
+                     const unsigned int *indexData, size_t indexCount,
+                     bool splitForShortIndices){
+  //bounds for culling: the box first, then the farthest vertex from its
+  //centre
+  bounds = Aabb();
+  for (size_t i{}; i < vertexCount; ++i) {
+    bounds.grow(vertexData[i].Position);
+  }
+  sphere = BoundingSphere();
+  if (vertexCount != 0) {
+    sphere.center = bounds.center();
+    float radius2{};
+    for (size_t i{}; i < vertexCount; ++i) {
+      glm::vec3 d = vertexData[i].Position - sphere.center;
+      radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    sphere.radius = std::sqrt(radius2);
+  }
+
+  //oversized meshes become several 16 bit ranges over one buffer, each
+  //drawn with its own base vertex
+  std::vector<Vertex> splitVertecies;
+  std::vector<unsigned int> splitIndices;
+  std::vector<IndexRun> runs{{0, 0}};
+  size_t rangeVertices = vertexCount;
+  if (splitForShortIndices && vertexCount > MAX_SHORT_VERTICES) {
+    runs = splitIndexRuns(vertexData, vertexCount, indexData, indexCount,
+                          MAX_SHORT_VERTICES, splitVertecies, splitIndices);
+    vertexData = splitVertecies.data();
+    vertexCount = splitVertecies.size();
+    indexData = splitIndices.data();
+    indexCount = splitIndices.size();
+    rangeVertices = MAX_SHORT_VERTICES;
+  }
+  this->indexCount = indexCount;
+  this->vertexCount = vertexCount;
+  if (arena) {
+    uploadToArena(vertexData, indexData, runs);
+    return;
+  }
 
-void Mesh::setupMesh(){
   glGenVertexArrays(1, &VAO);
   glGenBuffers(1, &VBO);
   glGenBuffers(1, &EBO);
 
-  glBindVertexArray(VAO);
+  glState().bindVertexArray(VAO);
   glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
   //naming is a bit missleading here;; Vertex contains position,
@@ -60,33 +281,82 @@ void Mesh::setupMesh(){
   //is the number of these triplets times the size of a triplet
   //(which is correct).
   //TODO: may need to make draw type configurable in future
-  glBufferData(GL_ARRAY_BUFFER, vertecies.size() * sizeof(Vertex),
-               vertecies.data(), GL_STATIC_DRAW); 
+  if (format == VERTEX_COMPACT) {
+    std::vector<PackedVertex> packed;
+    dequant = packVertices(vertexData, vertexCount, packed);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(PackedVertex),
+                 packed.data(), GL_STATIC_DRAW);
+  } else {
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex),
+                 vertexData, GL_STATIC_DRAW); 
+  }
   
+  //smallest index type every range fits in
+  size_t indexSize{4};
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
-               indices.data(), GL_STATIC_DRAW); 
-
-  // vertex data
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-
-  // normals data
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
-                        sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-  // TexCoord data
-  glEnableVertexAttribArray(2);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE,
-                        sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-
-  glEnableVertexAttribArray(3);
-  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE,
-                        sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-
-  glEnableVertexAttribArray(4);
-  glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE,
-                        sizeof(Vertex), (void*)offsetof(Vertex, BiTangent));
-  glBindVertexArray(0);
+  if (rangeVertices <= 256) {
+    elementType = GL_UNSIGNED_BYTE;
+    indexSize = 1;
+    std::vector<uint8_t> narrow(indexData, indexData + indexCount);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount, narrow.data(),
+                 GL_STATIC_DRAW);
+  } else if (rangeVertices <= MAX_SHORT_VERTICES) {
+    elementType = GL_UNSIGNED_SHORT;
+    indexSize = 2;
+    std::vector<uint16_t> narrow(indexData, indexData + indexCount);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(uint16_t),
+                 narrow.data(), GL_STATIC_DRAW);
+  } else {
+    elementType = GL_UNSIGNED_INT;
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int),
+                 indexData, GL_STATIC_DRAW); 
+  }
+  ranges.clear();
+  for (size_t i{}; i < runs.size(); ++i) {
+    size_t end = i + 1 < runs.size() ? runs[i + 1].firstIndex : indexCount;
+    ranges.push_back({runs[i].firstIndex * indexSize,
+                      static_cast<GLsizei>(end - runs[i].firstIndex),
+                      static_cast<GLint>(runs[i].baseVertex)});
+  }
+
+  setupVertexAttributes(format);
+  glState().bindVertexArray(0);
+}
+
+//the arena decides the layout: its vertex format and position transform,
+//and one index type for everyone in it
+void Mesh::uploadToArena(const Vertex *vertexData,
+                         const unsigned int *indexData,
+                         const std::vector<IndexRun> &runs) {
+  format = arena->vertexFormat();
+  dequant = arena->dequant();
+  elementType = arena->indexType();
+  arenaVertexOffset = arena->allocateVertices(vertexCount);
+  arenaIndexOffset = arena->allocateIndices(indexCount);
+  VAO = arena->vao();
+
+  if (format == VERTEX_COMPACT) {
+    std::vector<PackedVertex> packed;
+    packVertices(vertexData, vertexCount, dequant, packed);
+    arena->writeVertices(arenaVertexOffset, packed.data(), vertexCount);
+  } else {
+    arena->writeVertices(arenaVertexOffset, vertexData, vertexCount);
+  }
+  if (elementType == GL_UNSIGNED_SHORT) {
+    std::vector<uint16_t> narrow(indexData, indexData + indexCount);
+    arena->writeIndices(arenaIndexOffset, narrow.data(), indexCount);
+  } else {
+    arena->writeIndices(arenaIndexOffset, indexData, indexCount);
+  }
+
+  size_t indexSize = arena->indexSize();
+  ranges.clear();
+  for (size_t i{}; i < runs.size(); ++i) {
+    size_t end = i + 1 < runs.size() ? runs[i + 1].firstIndex : indexCount;
+    ranges.push_back({(arenaIndexOffset + runs[i].firstIndex) * indexSize,
+                      static_cast<GLsizei>(end - runs[i].firstIndex),
+                      static_cast<GLint>(arenaVertexOffset
+                                         + runs[i].baseVertex)});
+  }
 }
 
@@ -1,10 +1,15 @@
 #ifndef MESH_HEADER
 #define MESH_HEADER
 #include <glad/glad.h>
+#include <cstddef>
+#include <memory>
+#include <string>
 #include <vector>
 
+#include "bounds.h"
 #include "glm/glm.hpp"
 #include "shader.h"
+#include "vertex_format.h"
 
 struct Vertex {
   glm::vec3 Position;
@@ -14,12 +19,40 @@ struct Vertex {
   glm::vec3 BiTangent;
 };
 
+class CachedTexture;
+class MeshArena;
+
+//how a Mesh's GPU copy is laid out
+struct MeshUploadOptions {
+  VertexFormat vertexFormat{VERTEX_FULL};
+  //meshes with more than 65536 vertecies are cut into chunks that can each
+  //use 16 bit indices (drawn with a base vertex). vertecies shared across a
+  //cut are duplicated. without this they fall back to 32 bit indices
+  bool splitForShortIndices{false};
+  //upload into this shared arena instead of buffers of the mesh's own. the
+  //arena's vertex format and index type win over the ones above, and it has
+  //to outlive the mesh
+  MeshArena *arena{nullptr};
+};
+
 struct Texture {
   unsigned int id;
   std::string type;
   std::string fName;
+  //keeps id alive (see TextureCache); empty for textures owned elsewhere
+  std::shared_ptr<CachedTexture> handle;
 };
 
+//owns its VAO/VBO/EBO, so it can be moved but never copied. the CPU side
+//vertecies/indices are only kept around if keepCpuData is set (or never, for
+//the raw pointer constructor); the GPU copy is all Draw needs.
+//
+//with VERTEX_COMPACT the GPU copy is quantized (see vertex_format.h) and Draw
+//sets positionScale/positionOffset on the shader, which has to be built with
+//the COMPACT_VERTICES define. the CPU side copy is always plain Vertex.
+//
+//indices are stored as the smallest type that can address the vertecies
+//(bytes up to 256, shorts up to 65536), whatever the CPU side copy uses.
 class Mesh {
 public:
   std::vector<Vertex>       vertecies;
@@ -28,11 +61,87 @@ public:
 
   Mesh(std::vector<Vertex>       vertecies,
        std::vector<unsigned int> indices,
-       std::vector<Texture>      textures);
+       std::vector<Texture>      textures,
+       bool keepCpuData = true,
+       const MeshUploadOptions &upload = {});
+  //uploads straight from caller owned memory (eg a mapped mesh cache) and
+  //keeps no CPU side copy: vertecies and indices stay empty
+  Mesh(const Vertex       *vertexData, size_t vertexCount,
+       const unsigned int *indexData,  size_t indexCount,
+       std::vector<Texture> textures,
+       const MeshUploadOptions &upload = {});
+  ~Mesh();
+
+  Mesh(const Mesh &) = delete;
+  Mesh &operator=(const Mesh &) = delete;
+  Mesh(Mesh &&other) noexcept;
+  Mesh &operator=(Mesh &&other) noexcept;
+
   void Draw(Shader &shader) const;
+  //everything Draw does short of the draw itself: textures and, for
+  //VERTEX_COMPACT, the position transform. for batching draws of meshes
+  //that share buffers (see MeshArena)
+  void bind(Shader &shader) const;
+
+  //frees vertecies/indices once they're on the GPU
+  void releaseCpuData();
+
+  VertexFormat vertexFormat() const { return format; }
+  //size of the vertex buffer as uploaded
+  size_t vertexBytes() const { return vertexCount * vertexStride(format); }
+  //GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+  GLenum indexType() const { return elementType; }
+  //size of the index buffer as uploaded
+  size_t indexBytes() const;
+  //draw calls per Draw: 1 unless the mesh was split
+  size_t drawRangeCount() const { return ranges.size(); }
+  //in the mesh's own space, from a scan of the vertecies at upload. the
+  //sphere is centred on the box, so it's only tight for roundish meshes
+  const Aabb &boundingBox() const { return bounds; }
+  const BoundingSphere &boundingSphere() const { return sphere; }
+
+  //one glDrawElementsBaseVertex worth of the index buffer
+  struct DrawRange {
+    size_t  offset;     //bytes into the EBO
+    GLsizei count;
+    GLint   baseVertex;
+  };
+  const std::vector<DrawRange> &drawRanges() const { return ranges; }
+  //the mesh's arena, or null when it owns its buffers
+  const MeshArena *sharedArena() const { return arena; }
+
+  //a stretch of the index list and the vertex its indices count from
+  struct IndexRun {
+    size_t firstIndex;
+    size_t baseVertex;
+  };
 
 private:
-  unsigned int VBO, VAO, EBO;
-  void setupMesh();
+
+  unsigned int VBO{0}, VAO{0}, EBO{0};
+  size_t indexCount{0};
+  size_t vertexCount{0};
+  GLenum elementType{GL_UNSIGNED_INT};
+  std::vector<DrawRange> ranges;
+  VertexFormat format{VERTEX_FULL};
+  PositionDequant dequant; //identity unless format is VERTEX_COMPACT
+  Aabb bounds;
+  BoundingSphere sphere;
+  MeshArena *arena{nullptr};
+  size_t arenaVertexOffset{0}, arenaIndexOffset{0};
+  //sampler uniform per texture ("texture_diffuse1"...), built once
+  std::vector<std::string> samplerNames;
+  //samplerNames resolved against the last shader we drew with
+  mutable unsigned int samplerProgram{0};
+  mutable std::vector<UniformHandle> samplerHandles;
+  mutable UniformHandle scaleHandle, offsetHandle;
+
+  void buildSamplerNames();
+  void releaseGpuData();
+  void setupMesh(const Vertex *vertexData, size_t vertexCount,
+                 const unsigned int *indexData, size_t indexCount,
+                 bool splitForShortIndices);
+  void uploadToArena(const Vertex *vertexData, const unsigned int *indexData,
+                     const std::vector<IndexRun> &runs);
 };
 #endif
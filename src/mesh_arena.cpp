@@ -0,0 +1,184 @@
+#include "mesh_arena.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "gl_state.h"
+
+RangeAllocator::RangeAllocator(size_t capacity) {
+  grow(capacity);
+}
+
+size_t RangeAllocator::allocate(size_t count) {
+  if (count == 0) {
+    return 0;
+  }
+  for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+    if (it->second >= count) {
+      size_t offset = it->first;
+      size_t left = it->second - count;
+      freeRanges.erase(it);
+      if (left != 0) {
+        freeRanges.emplace(offset + count, left);
+      }
+      inUse += count;
+      return offset;
+    }
+  }
+  return npos;
+}
+
+void RangeAllocator::release(size_t offset, size_t count) {
+  if (count == 0) {
+    return;
+  }
+  inUse -= count;
+  auto next = freeRanges.lower_bound(offset);
+  //merge with the free range right after...
+  if (next != freeRanges.end() && offset + count == next->first) {
+    count += next->second;
+    next = freeRanges.erase(next);
+  }
+  //...and the one right before
+  if (next != freeRanges.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      prev->second += count;
+      return;
+    }
+  }
+  freeRanges.emplace(offset, count);
+}
+
+void RangeAllocator::grow(size_t newCapacity) {
+  if (newCapacity <= total) {
+    return;
+  }
+  size_t added = newCapacity - total;
+  size_t oldTotal = total;
+  total = newCapacity;
+  inUse += added; //release() takes it back off
+  release(oldTotal, added);
+}
+
+MeshArena::MeshArena(VertexFormat format, GLenum indexType,
+                     size_t vertexCapacity, size_t indexCapacity,
+                     const PositionDequant &dequant)
+: format(format), elementType(indexType), positionDequant(dequant) {
+  glGenVertexArrays(1, &VAO);
+  glGenBuffers(1, &VBO);
+  glGenBuffers(1, &EBO);
+
+  glState().bindVertexArray(VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  glBufferData(GL_ARRAY_BUFFER, vertexCapacity * vertexStride(format),
+               nullptr, GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * indexSize(), nullptr,
+               GL_STATIC_DRAW);
+  setupVertexAttributes(format);
+  glState().bindVertexArray(0);
+
+  vertexRanges.grow(vertexCapacity);
+  indexRanges.grow(indexCapacity);
+}
+
+MeshArena::~MeshArena() {
+  glState().deleteVertexArrays(1, &VAO);
+  glDeleteBuffers(1, &VBO);
+  glDeleteBuffers(1, &EBO);
+}
+
+size_t MeshArena::indexSize() const {
+  return elementType == GL_UNSIGNED_SHORT ? 2 : 4;
+}
+
+size_t MeshArena::vertexBytes() const {
+  return vertexRanges.used() * vertexStride(format);
+}
+
+size_t MeshArena::indexBytes() const {
+  return indexRanges.used() * indexSize();
+}
+
+size_t MeshArena::allocateVertices(size_t count) {
+  size_t offset = vertexRanges.allocate(count);
+  if (offset == RangeAllocator::npos) {
+    growVertices(vertexRanges.capacity() + count);
+    offset = vertexRanges.allocate(count);
+  }
+  return offset;
+}
+
+size_t MeshArena::allocateIndices(size_t count) {
+  size_t offset = indexRanges.allocate(count);
+  if (offset == RangeAllocator::npos) {
+    growIndices(indexRanges.capacity() + count);
+    offset = indexRanges.allocate(count);
+  }
+  return offset;
+}
+
+void MeshArena::releaseVertices(size_t offset, size_t count) {
+  vertexRanges.release(offset, count);
+}
+
+void MeshArena::releaseIndices(size_t offset, size_t count) {
+  indexRanges.release(offset, count);
+}
+
+//through the copy targets so neither the bound VAO's element buffer nor
+//GL_ARRAY_BUFFER change under anyone
+void MeshArena::writeVertices(size_t offset, const void *data, size_t count) {
+  size_t stride = vertexStride(format);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, offset * stride, count * stride,
+                  data);
+}
+
+void MeshArena::writeIndices(size_t offset, const void *data, size_t count) {
+  glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, offset * indexSize(),
+                  count * indexSize(), data);
+}
+
+//new buffer, old contents copied over on the GPU. at least doubles so a
+//model uploading mesh by mesh only reallocates a handful of times
+static unsigned int growBuffer(unsigned int old, size_t oldBytes,
+                               size_t newBytes) {
+  unsigned int grown;
+  glGenBuffers(1, &grown);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+  glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+  if (oldBytes != 0) {
+    glBindBuffer(GL_COPY_READ_BUFFER, old);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                        oldBytes);
+  }
+  glDeleteBuffers(1, &old);
+  return grown;
+}
+
+void MeshArena::growVertices(size_t minCapacity) {
+  size_t capacity = std::max(minCapacity, 2 * vertexRanges.capacity());
+  size_t stride = vertexStride(format);
+  VBO = growBuffer(VBO, vertexRanges.capacity() * stride, capacity * stride);
+  vertexRanges.grow(capacity);
+
+  //the attribute pointers captured the old buffer
+  glState().bindVertexArray(VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  setupVertexAttributes(format);
+  glState().bindVertexArray(0);
+}
+
+void MeshArena::growIndices(size_t minCapacity) {
+  size_t capacity = std::max(minCapacity, 2 * indexRanges.capacity());
+  EBO = growBuffer(EBO, indexRanges.capacity() * indexSize(),
+                   capacity * indexSize());
+  indexRanges.grow(capacity);
+
+  glState().bindVertexArray(VAO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+  glState().bindVertexArray(0);
+}
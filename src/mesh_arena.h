@@ -0,0 +1,81 @@
+#ifndef MESH_ARENA_H
+#define MESH_ARENA_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <map>
+
+#include "vertex_format.h"
+
+//first fit allocator over [0, capacity) in whatever units the caller likes.
+//free ranges are kept sorted and merged with their neighbours on release.
+class RangeAllocator {
+public:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  explicit RangeAllocator(size_t capacity = 0);
+
+  //offset of count free units, or npos if no free range is big enough
+  size_t allocate(size_t count);
+  void release(size_t offset, size_t count);
+  //adds [capacity, newCapacity) to the free ranges
+  void grow(size_t newCapacity);
+
+  size_t capacity() const { return total; }
+  size_t used() const { return inUse; }
+
+private:
+  std::map<size_t, size_t> freeRanges; //offset -> count
+  size_t total{};
+  size_t inUse{};
+};
+
+//one VAO/VBO/EBO shared by many meshes (all of a Model's, with
+//ModelLoadOptions::sharedBuffers), handed out in vertex and index ranges.
+//every mesh in it has the same vertex layout, index type and, for
+//VERTEX_COMPACT, position transform, so a whole batch of them can go out in
+//a single glMultiDrawElementsBaseVertex. the buffers grow (keeping their
+//contents) when an allocation doesn't fit. GL thread only.
+class MeshArena {
+public:
+  //indexType is GL_UNSIGNED_SHORT or GL_UNSIGNED_INT; capacities are in
+  //vertecies/indices and only a first guess
+  MeshArena(VertexFormat format, GLenum indexType, size_t vertexCapacity,
+            size_t indexCapacity, const PositionDequant &dequant = {});
+  ~MeshArena();
+
+  MeshArena(const MeshArena &) = delete;
+  MeshArena &operator=(const MeshArena &) = delete;
+
+  //offsets in vertecies/indices, never npos
+  size_t allocateVertices(size_t count);
+  size_t allocateIndices(size_t count);
+  void releaseVertices(size_t offset, size_t count);
+  void releaseIndices(size_t offset, size_t count);
+
+  //data is already in the arena's layout (PackedVertex for VERTEX_COMPACT,
+  //indices of indexType)
+  void writeVertices(size_t offset, const void *data, size_t count);
+  void writeIndices(size_t offset, const void *data, size_t count);
+
+  unsigned int vao() const { return VAO; }
+  VertexFormat vertexFormat() const { return format; }
+  GLenum indexType() const { return elementType; }
+  size_t indexSize() const;
+  const PositionDequant &dequant() const { return positionDequant; }
+  //bytes handed out, not the (bigger) buffer sizes
+  size_t vertexBytes() const;
+  size_t indexBytes() const;
+
+private:
+  unsigned int VAO{0}, VBO{0}, EBO{0};
+  VertexFormat format;
+  GLenum elementType;
+  PositionDequant positionDequant;
+  RangeAllocator vertexRanges, indexRanges;
+
+  void growVertices(size_t minCapacity);
+  void growIndices(size_t minCapacity);
+};
+
+#endif
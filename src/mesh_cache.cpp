@@ -0,0 +1,232 @@
+#include "mesh_cache.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "hash.h"
+
+static const char CACHE_MAGIC[8] = {'D', 'G', 'L', 'M', 'E', 'S', 'H', '\0'};
+
+static uint64_t alignUp(uint64_t offset) {
+  return (offset + 15) & ~uint64_t(15);
+}
+
+static void padTo(std::ofstream &out, uint64_t &offset, uint64_t target) {
+  static const char zeros[16] = {};
+  out.write(zeros, static_cast<std::streamsize>(target - offset));
+  offset = target;
+}
+
+//folds every "mtllib <file>" of an .obj into hash: the cache stores texture
+//refs that come out of those files. like Assimp, the rest of the line is one
+//file name relative to the .obj. a missing library still changes the hash,
+//so creating it later invalidates the cache
+static uint64_t foldMaterialLibraries(const std::string &path,
+                                      const MappedFile &source,
+                                      uint64_t hash) {
+  size_t slash = path.find_last_of('/');
+  std::string directory = slash == std::string::npos
+    ? std::string() : path.substr(0, slash + 1);
+  const char *text = reinterpret_cast<const char *>(source.data());
+  size_t size = source.size();
+  for (size_t line{}; line < size;) {
+    size_t end = line;
+    while (end < size && text[end] != '\n') {
+      ++end;
+    }
+    static const char MTLLIB[] = "mtllib";
+    size_t keyword = sizeof(MTLLIB) - 1;
+    if (end - line > keyword && std::memcmp(text + line, MTLLIB, keyword) == 0
+        && (text[line + keyword] == ' ' || text[line + keyword] == '\t')) {
+      size_t first = line + keyword, last = end;
+      while (first < last
+             && std::isspace(static_cast<unsigned char>(text[first]))) {
+        ++first;
+      }
+      while (last > first
+             && std::isspace(static_cast<unsigned char>(text[last - 1]))) {
+        --last;
+      }
+      std::string library(text + first, last - first);
+      hash = fnv1a64(library, hash);
+      MappedFile material(directory + library);
+      uint64_t materialHash = material.isOpen()
+        ? fnv1a64(material.data(), material.size()) : 0;
+      hash = fnv1a64(&materialHash, sizeof(materialHash), hash);
+    }
+    line = end + 1;
+  }
+  return hash;
+}
+
+uint64_t MeshCache::hashSourceFile(const std::string &path) {
+  MappedFile source(path);
+  if (!source.isOpen()) {
+    return 0;
+  }
+  uint64_t hash = fnv1a64(source.data(), source.size());
+  return foldMaterialLibraries(path, source, hash);
+}
+
+bool MeshCache::write(const std::string &cachePath, uint64_t sourceHash,
+                      uint32_t postProcessFlags, uint32_t meshFlags,
+                      const std::vector<MeshCacheSource> &meshes) {
+  //lay everything out first so the records can be written up front
+  std::vector<MeshCacheRecord> records(meshes.size());
+  uint64_t offset = alignUp(sizeof(MeshCacheHeader)
+                            + meshes.size() * sizeof(MeshCacheRecord));
+  for (size_t i{}; i < meshes.size(); ++i) {
+    MeshCacheRecord &rec = records[i];
+    std::memset(&rec, 0, sizeof(rec));
+    rec.vertexCount = static_cast<uint32_t>(meshes[i].vertecies->size());
+    rec.indexCount = static_cast<uint32_t>(meshes[i].indices->size());
+    rec.textureCount = static_cast<uint32_t>(meshes[i].textures->size());
+
+    rec.vertexOffset = offset;
+    offset = alignUp(offset + rec.vertexCount * sizeof(Vertex));
+    rec.indexOffset = offset;
+    offset = alignUp(offset + rec.indexCount * sizeof(unsigned int));
+    rec.textureOffset = offset;
+    for (const Texture &tex : *meshes[i].textures) {
+      offset += 2 * sizeof(uint32_t) + tex.type.size() + tex.fName.size();
+    }
+    offset = alignUp(offset);
+  }
+
+  //write to a temp file and rename so a crash never leaves a torn cache
+  std::string tmpPath = cachePath + ".tmp";
+  std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cout << "ERROR::MESH_CACHE::CANNOT_WRITE " << tmpPath << std::endl;
+    return false;
+  }
+
+  MeshCacheHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.version = MESH_CACHE_VERSION;
+  header.vertexSize = sizeof(Vertex);
+  header.sourceHash = sourceHash;
+  header.postProcessFlags = postProcessFlags;
+  header.meshCount = static_cast<uint32_t>(meshes.size());
+  header.meshFlags = meshFlags;
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(records.data()),
+            static_cast<std::streamsize>(records.size()
+                                         * sizeof(MeshCacheRecord)));
+  uint64_t written = sizeof(header) + records.size() * sizeof(MeshCacheRecord);
+
+  for (size_t i{}; i < meshes.size(); ++i) {
+    const MeshCacheRecord &rec = records[i];
+    padTo(out, written, rec.vertexOffset);
+    out.write(reinterpret_cast<const char *>(meshes[i].vertecies->data()),
+              static_cast<std::streamsize>(rec.vertexCount * sizeof(Vertex)));
+    written += rec.vertexCount * sizeof(Vertex);
+
+    padTo(out, written, rec.indexOffset);
+    out.write(reinterpret_cast<const char *>(meshes[i].indices->data()),
+              static_cast<std::streamsize>(rec.indexCount
+                                           * sizeof(unsigned int)));
+    written += rec.indexCount * sizeof(unsigned int);
+
+    padTo(out, written, rec.textureOffset);
+    for (const Texture &tex : *meshes[i].textures) {
+      for (const std::string *str : {&tex.type, &tex.fName}) {
+        uint32_t len = static_cast<uint32_t>(str->size());
+        out.write(reinterpret_cast<const char *>(&len), sizeof(len));
+        out.write(str->data(), len);
+        written += sizeof(len) + len;
+      }
+    }
+  }
+  padTo(out, written, alignUp(written));
+  out.close();
+  if (!out) {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return std::rename(tmpPath.c_str(), cachePath.c_str()) == 0;
+}
+
+bool MeshCache::open(const std::string &cachePath, uint64_t sourceHash,
+                     uint32_t postProcessFlags, uint32_t meshFlags) {
+  records.clear();
+  if (!file.open(cachePath)) {
+    return false;
+  }
+  const unsigned char *base = file.data();
+  size_t size = file.size();
+
+  MeshCacheHeader header;
+  if (size < sizeof(header)) {
+    file.close();
+    return false;
+  }
+  std::memcpy(&header, base, sizeof(header));
+  if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+    || header.version != MESH_CACHE_VERSION
+    || header.vertexSize != sizeof(Vertex)
+    || header.sourceHash != sourceHash
+    || header.postProcessFlags != postProcessFlags
+    || header.meshFlags != meshFlags
+    || sizeof(header) + uint64_t(header.meshCount) * sizeof(MeshCacheRecord)
+         > size) {
+    file.close();
+    return false;
+  }
+
+  records.resize(header.meshCount);
+  std::memcpy(records.data(), base + sizeof(header),
+              records.size() * sizeof(MeshCacheRecord));
+  for (const MeshCacheRecord &rec : records) {
+    //a truncated file is a miss, never a crash
+    if (rec.vertexOffset + uint64_t(rec.vertexCount) * sizeof(Vertex) > size
+      || rec.indexOffset + uint64_t(rec.indexCount) * sizeof(unsigned int)
+           > size
+      || rec.textureOffset > size) {
+      records.clear();
+      file.close();
+      return false;
+    }
+  }
+  return true;
+}
+
+CachedMesh MeshCache::mesh(size_t i) const {
+  const MeshCacheRecord &rec = records[i];
+  const unsigned char *base = file.data();
+
+  CachedMesh view;
+  view.vertecies = reinterpret_cast<const Vertex *>(base + rec.vertexOffset);
+  view.vertexCount = rec.vertexCount;
+  view.indices =
+    reinterpret_cast<const unsigned int *>(base + rec.indexOffset);
+  view.indexCount = rec.indexCount;
+
+  uint64_t cursor = rec.textureOffset;
+  auto readString = [&](std::string &str) {
+    uint32_t len{};
+    if (cursor + sizeof(len) > file.size()) {
+      return false;
+    }
+    std::memcpy(&len, base + cursor, sizeof(len));
+    cursor += sizeof(len);
+    if (cursor + len > file.size()) {
+      return false;
+    }
+    str.assign(reinterpret_cast<const char *>(base + cursor), len);
+    cursor += len;
+    return true;
+  };
+  for (uint32_t t{}; t < rec.textureCount; ++t) {
+    TextureRef ref;
+    if (!readString(ref.type) || !readString(ref.fName)) {
+      break;
+    }
+    view.textures.push_back(ref);
+  }
+  return view;
+}
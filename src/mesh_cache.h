@@ -0,0 +1,94 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "mesh.h"
+
+//binary dump of everything Model pulls out of Assimp, so warm starts can skip
+//the importer entirely. layout (native endianness, all blobs 16 byte aligned):
+//
+//  MeshCacheHeader
+//  MeshCacheRecord[meshCount]
+//  per mesh: Vertex[vertexCount], unsigned int[indexCount],
+//            texture refs as (u32 length, chars) pairs: type then file name
+//
+//bump MESH_CACHE_VERSION whenever this layout or Vertex changes.
+constexpr uint32_t MESH_CACHE_VERSION = 2;
+
+//MeshCacheHeader::meshFlags: what DepthGL itself did to the meshes after
+//Assimp, so differently processed caches never get mixed up
+constexpr uint32_t MESH_FLAG_OPTIMIZED = 1u << 0; //see mesh_optimize.h
+
+struct MeshCacheHeader {
+  char     magic[8];         //"DGLMESH\0"
+  uint32_t version;
+  uint32_t vertexSize;       //sizeof(Vertex) when written
+  uint64_t sourceHash;       //MeshCache::hashSourceFile of the model
+  uint32_t postProcessFlags; //aiProcess_* flags used for the import
+  uint32_t meshCount;
+  uint32_t meshFlags;        //MESH_FLAG_*
+  uint32_t pad;
+};
+
+struct MeshCacheRecord {
+  uint64_t vertexOffset;
+  uint64_t indexOffset;
+  uint64_t textureOffset;
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  uint32_t textureCount;
+  uint32_t pad;
+};
+
+//what a cached texture reference resolves to; Model turns these back into
+//Textures through its normal lookup
+struct TextureRef {
+  std::string type;
+  std::string fName;
+};
+
+//input for MeshCache::write, one per mesh
+struct MeshCacheSource {
+  const std::vector<Vertex>       *vertecies;
+  const std::vector<unsigned int> *indices;
+  const std::vector<Texture>      *textures;
+};
+
+//view into a mapped cache file; pointers stay valid while the cache is open
+struct CachedMesh {
+  const Vertex       *vertecies;
+  size_t              vertexCount;
+  const unsigned int *indices;
+  size_t              indexCount;
+  std::vector<TextureRef> textures;
+};
+
+class MeshCache {
+public:
+  //hash of the file a cache entry is keyed on, with the contents of the
+  //material libraries an .obj references folded in; 0 if it can't be read
+  static uint64_t hashSourceFile(const std::string &path);
+
+  static bool write(const std::string &cachePath, uint64_t sourceHash,
+                    uint32_t postProcessFlags, uint32_t meshFlags,
+                    const std::vector<MeshCacheSource> &meshes);
+
+  //maps cachePath and validates it against the key. on any mismatch or
+  //malformed file this returns false and the caller should re-import.
+  bool open(const std::string &cachePath, uint64_t sourceHash,
+            uint32_t postProcessFlags, uint32_t meshFlags);
+
+  size_t meshCount() const { return records.size(); }
+  CachedMesh mesh(size_t i) const;
+
+private:
+  MappedFile file;
+  std::vector<MeshCacheRecord> records;
+};
+
+#endif
@@ -0,0 +1,322 @@
+#include "mesh_optimize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+#include "hash.h"
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices,
+                                    size_t vertexCount) {
+  VertexCacheStats stats;
+  if (indices.size() < 3) {
+    return stats;
+  }
+  //FIFO: v is cached iff fewer than OPTIMIZE_CACHE_SIZE vertecies went in
+  //after it did
+  const size_t never = std::numeric_limits<size_t>::max();
+  std::vector<size_t> insertedAt(vertexCount, never);
+  size_t clock{}, misses{}, referenced{};
+  for (unsigned int v : indices) {
+    if (insertedAt[v] == never) {
+      ++referenced;
+    }
+    if (insertedAt[v] == never
+      || clock - insertedAt[v] >= OPTIMIZE_CACHE_SIZE) {
+      insertedAt[v] = clock++;
+      ++misses;
+    }
+  }
+  stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+  stats.atvr = static_cast<float>(misses) / referenced;
+  return stats;
+}
+
+// ==============================DEDUPLICATION=================================
+void deduplicateVertices(std::vector<Vertex> &vertecies,
+                         std::vector<unsigned int> &indices) {
+  //keyed on the bytes; a hash collision between different vertecies just
+  //leaves the second one unmerged
+  std::unordered_map<uint64_t, unsigned int> firstByHash;
+  firstByHash.reserve(vertecies.size());
+  std::vector<unsigned int> remap(vertecies.size());
+  std::vector<Vertex> unique;
+  unique.reserve(vertecies.size());
+  for (size_t i{}; i < vertecies.size(); ++i) {
+    uint64_t hash = fnv1a64(&vertecies[i], sizeof(Vertex));
+    auto found = firstByHash.find(hash);
+    if (found != firstByHash.end()
+      && std::memcmp(&unique[found->second], &vertecies[i],
+                     sizeof(Vertex)) == 0) {
+      remap[i] = found->second;
+      continue;
+    }
+    remap[i] = static_cast<unsigned int>(unique.size());
+    if (found == firstByHash.end()) {
+      firstByHash.emplace(hash, remap[i]);
+    }
+    unique.push_back(vertecies[i]);
+  }
+  for (unsigned int &index : indices) {
+    index = remap[index];
+  }
+  vertecies.swap(unique);
+}
+
+// ==============================VERTEX CACHE==================================
+//Forsyth's scoring: recently used vertecies score high (the last triangle's
+//three a bit lower, so strips don't run forever), and so do vertecies with
+//few triangles left, so they get finished off instead of stranded
+constexpr size_t FORSYTH_CACHE_SIZE = 32;
+
+static float vertexScore(int cachePosition, unsigned int remaining) {
+  if (remaining == 0) {
+    return -1.0f;
+  }
+  float score{};
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      score = 0.75f;
+    } else {
+      float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+      score = std::pow(1.0f - (cachePosition - 3) * scale, 1.5f);
+    }
+  }
+  return score + 2.0f / std::sqrt(static_cast<float>(remaining));
+}
+
+void optimizeVertexCache(std::vector<unsigned int> &indices,
+                         size_t vertexCount) {
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount < 2) {
+    return;
+  }
+
+  //triangles using each vertex, CSR style. a vertex's live triangles are
+  //the first remaining[v] entries of its range
+  std::vector<unsigned int> remaining(vertexCount, 0);
+  for (unsigned int v : indices) {
+    ++remaining[v];
+  }
+  std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+  for (size_t v{}; v < vertexCount; ++v) {
+    adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+  }
+  std::vector<unsigned int> adjacency(indices.size());
+  std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+  for (size_t t{}; t < triangleCount; ++t) {
+    for (int k{}; k < 3; ++k) {
+      adjacency[fill[indices[3 * t + k]]++] = static_cast<unsigned int>(t);
+    }
+  }
+
+  std::vector<float> score(vertexCount);
+  for (size_t v{}; v < vertexCount; ++v) {
+    score[v] = vertexScore(-1, remaining[v]);
+  }
+  std::vector<float> triangleScore(triangleCount);
+  for (size_t t{}; t < triangleCount; ++t) {
+    triangleScore[t] = score[indices[3 * t]] + score[indices[3 * t + 1]]
+      + score[indices[3 * t + 2]];
+  }
+  std::vector<bool> emitted(triangleCount, false);
+
+  const size_t none = std::numeric_limits<size_t>::max();
+  size_t best = static_cast<size_t>(
+    std::max_element(triangleScore.begin(), triangleScore.end())
+    - triangleScore.begin());
+  size_t cursor{}; //first possibly unemitted triangle, for dead ends
+
+  std::vector<unsigned int> output;
+  output.reserve(indices.size());
+  std::vector<unsigned int> cache, nextCache;
+  cache.reserve(FORSYTH_CACHE_SIZE + 3);
+  nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+  for (size_t emittedCount{}; emittedCount < triangleCount; ++emittedCount) {
+    if (best == none) {
+      while (emitted[cursor]) {
+        ++cursor;
+      }
+      best = cursor;
+    }
+    const unsigned int *tri = &indices[3 * best];
+    output.insert(output.end(), tri, tri + 3);
+    emitted[best] = true;
+
+    //take the triangle off its vertecies' live lists
+    for (int k{}; k < 3; ++k) {
+      unsigned int v = tri[k];
+      unsigned int *first = &adjacency[adjacencyStart[v]];
+      unsigned int *last = first + remaining[v];
+      unsigned int *self = std::find(first, last,
+                                     static_cast<unsigned int>(best));
+      std::swap(*self, *(last - 1));
+      --remaining[v];
+    }
+
+    //the triangle's vertecies move to the front of the LRU cache
+    nextCache.assign(tri, tri + 3);
+    for (unsigned int v : cache) {
+      if (v != tri[0] && v != tri[1] && v != tri[2]) {
+        nextCache.push_back(v);
+      }
+    }
+
+    //rescore everything that moved (including what just fell out) and
+    //push the change onto their live triangles
+    best = none;
+    float bestScore = -1.0f;
+    for (size_t i{}; i < nextCache.size(); ++i) {
+      unsigned int v = nextCache[i];
+      int position = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+      float updated = vertexScore(position, remaining[v]);
+      float delta = updated - score[v];
+      score[v] = updated;
+      for (unsigned int j{}; j < remaining[v]; ++j) {
+        unsigned int t = adjacency[adjacencyStart[v] + j];
+        triangleScore[t] += delta;
+      }
+    }
+    if (nextCache.size() > FORSYTH_CACHE_SIZE) {
+      nextCache.resize(FORSYTH_CACHE_SIZE);
+    }
+    for (unsigned int v : nextCache) {
+      for (unsigned int j{}; j < remaining[v]; ++j) {
+        unsigned int t = adjacency[adjacencyStart[v] + j];
+        if (triangleScore[t] > bestScore) {
+          bestScore = triangleScore[t];
+          best = t;
+        }
+      }
+    }
+    cache.swap(nextCache);
+  }
+  indices.swap(output);
+}
+
+// ==============================OVERDRAW======================================
+void optimizeOverdraw(std::vector<unsigned int> &indices,
+                      const std::vector<Vertex> &vertecies, float threshold) {
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount < 2) {
+    return;
+  }
+  float acmrIn = analyzeVertexCache(indices, vertecies.size()).acmr;
+
+  //a triangle that misses on all three vertecies starts over with a cold
+  //cache anyway, so cutting the list there costs (almost) nothing
+  const size_t never = std::numeric_limits<size_t>::max();
+  std::vector<size_t> insertedAt(vertecies.size(), never);
+  std::vector<size_t> clusterStart;
+  size_t clock{};
+  for (size_t t{}; t < triangleCount; ++t) {
+    int misses{};
+    for (int k{}; k < 3; ++k) {
+      unsigned int v = indices[3 * t + k];
+      if (insertedAt[v] == never
+        || clock - insertedAt[v] >= OPTIMIZE_CACHE_SIZE) {
+        insertedAt[v] = clock++;
+        ++misses;
+      }
+    }
+    if (t == 0 || misses == 3) {
+      clusterStart.push_back(t);
+    }
+  }
+  if (clusterStart.size() < 2) {
+    return;
+  }
+  clusterStart.push_back(triangleCount);
+
+  //area weighted centroid and summed normal per cluster
+  size_t clusterCount = clusterStart.size() - 1;
+  std::vector<glm::vec3> centroid(clusterCount, glm::vec3(0.0f));
+  std::vector<glm::vec3> normal(clusterCount, glm::vec3(0.0f));
+  glm::vec3 meshCentroid(0.0f);
+  float meshArea{};
+  for (size_t c{}; c < clusterCount; ++c) {
+    float area{};
+    for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; ++t) {
+      const glm::vec3 &a = vertecies[indices[3 * t]].Position;
+      const glm::vec3 &b = vertecies[indices[3 * t + 1]].Position;
+      const glm::vec3 &d = vertecies[indices[3 * t + 2]].Position;
+      glm::vec3 n = glm::cross(b - a, d - a);
+      float triangleArea = glm::length(n);
+      centroid[c] += (a + b + d) * (triangleArea / 3.0f);
+      normal[c] += n;
+      area += triangleArea;
+    }
+    meshCentroid += centroid[c];
+    meshArea += area;
+    if (area > 0.0f) {
+      centroid[c] /= area;
+    }
+  }
+  if (meshArea > 0.0f) {
+    meshCentroid /= meshArea;
+  }
+
+  //clusters that face outwards, away from the centre, occlude the rest
+  std::vector<float> sortKey(clusterCount, 0.0f);
+  for (size_t c{}; c < clusterCount; ++c) {
+    float length = glm::length(normal[c]);
+    if (length > 0.0f) {
+      sortKey[c] = glm::dot(centroid[c] - meshCentroid, normal[c] / length);
+    }
+  }
+  std::vector<size_t> order(clusterCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return sortKey[a] > sortKey[b];
+  });
+
+  std::vector<unsigned int> sorted;
+  sorted.reserve(indices.size());
+  for (size_t c : order) {
+    sorted.insert(sorted.end(), indices.begin() + 3 * clusterStart[c],
+                  indices.begin() + 3 * clusterStart[c + 1]);
+  }
+  if (analyzeVertexCache(sorted, vertecies.size()).acmr
+      <= acmrIn * threshold) {
+    indices.swap(sorted);
+  }
+}
+
+// ==============================VERTEX FETCH==================================
+void optimizeVertexFetch(std::vector<Vertex> &vertecies,
+                         std::vector<unsigned int> &indices) {
+  const unsigned int unused = std::numeric_limits<unsigned int>::max();
+  std::vector<unsigned int> remap(vertecies.size(), unused);
+  std::vector<Vertex> ordered;
+  ordered.reserve(vertecies.size());
+  for (unsigned int &index : indices) {
+    if (remap[index] == unused) {
+      remap[index] = static_cast<unsigned int>(ordered.size());
+      ordered.push_back(vertecies[index]);
+    }
+    index = remap[index];
+  }
+  //vertecies no triangle uses are dropped
+  vertecies.swap(ordered);
+}
+
+MeshOptimizeStats optimizeMesh(std::vector<Vertex> &vertecies,
+                               std::vector<unsigned int> &indices) {
+  MeshOptimizeStats stats;
+  stats.verticesBefore = vertecies.size();
+  stats.before = analyzeVertexCache(indices, vertecies.size());
+
+  deduplicateVertices(vertecies, indices);
+  optimizeVertexCache(indices, vertecies.size());
+  optimizeOverdraw(indices, vertecies);
+  optimizeVertexFetch(vertecies, indices);
+
+  stats.verticesAfter = vertecies.size();
+  stats.after = analyzeVertexCache(indices, vertecies.size());
+  return stats;
+}
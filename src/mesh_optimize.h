@@ -0,0 +1,58 @@
+#ifndef MESH_OPTIMIZE_H
+#define MESH_OPTIMIZE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "mesh.h"
+
+//import time reordering of a triangle list for the GPU. pure CPU work on the
+//caller's arrays, safe on any thread. the passes are meant to run in the
+//order optimizeMesh runs them:
+//
+//  dedup    identical vertecies collapse into one (Assimp emits one per face
+//           corner without aiProcess_JoinIdenticalVertices)
+//  cache    Forsyth's linear speed vertex cache optimization: triangles are
+//           reordered so their vertecies are still in the post-transform
+//           cache when they're needed again
+//  overdraw the cache ordered list is split into clusters wherever the cache
+//           starts over anyway, and clusters facing away from the mesh
+//           centre are drawn first so early-z rejects more of what follows
+//  fetch    vertecies are renumbered in first use order, so vertex fetch
+//           walks the buffer front to back
+
+//cache stats for one index list, simulated on a FIFO cache of
+//OPTIMIZE_CACHE_SIZE entries (what most GPUs behave like)
+constexpr size_t OPTIMIZE_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+  float acmr{}; //cache misses per triangle: 0.5 is ideal, 3 is no reuse
+  float atvr{}; //cache misses per vertex: 1 is ideal
+};
+
+struct MeshOptimizeStats {
+  size_t verticesBefore{}, verticesAfter{};
+  VertexCacheStats before, after;
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices,
+                                    size_t vertexCount);
+
+//each pass rewrites its arguments in place
+void deduplicateVertices(std::vector<Vertex> &vertecies,
+                         std::vector<unsigned int> &indices);
+void optimizeVertexCache(std::vector<unsigned int> &indices,
+                         size_t vertexCount);
+//threshold: how much worse than the input's ACMR the cluster order may get
+//before it's rejected and the input order kept
+void optimizeOverdraw(std::vector<unsigned int> &indices,
+                      const std::vector<Vertex> &vertecies,
+                      float threshold = 1.05f);
+void optimizeVertexFetch(std::vector<Vertex> &vertecies,
+                         std::vector<unsigned int> &indices);
+
+//all four passes, in order
+MeshOptimizeStats optimizeMesh(std::vector<Vertex> &vertecies,
+                               std::vector<unsigned int> &indices);
+
+#endif
@@ -2,67 +2,422 @@
 #include <assimp/material.h>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
-#include <cstring>
+#include <chrono>
+#include <limits>
+#include <utility>
 #include <vector>
 
 #include "model.h"
+#include "frame_stats.h"
+#include "gl_state.h"
 #include "mesh.h"
+#include "mesh_cache.h"
 #include "shader.h"
+#include "texture_cache.h"
+#include "texture_loader.h"
+#include "job_system.h"
 #define STB_IMAGE_IMPLEMENTATION //oml this one line kills me every time
 #include "stb_image.h"
 
-static unsigned int textureFromFile(std::string fName, std::string directory);
+//post processing every import uses; part of the mesh cache key
+static const unsigned int IMPORT_FLAGS = aiProcess_Triangulate |
+                                         aiProcess_GenSmoothNormals |
+                                         aiProcess_FlipUVs |
+                                         aiProcess_CalcTangentSpace;
 
-void Model::Draw(Shader &shader){
-  for (Mesh mesh : meshes){
-    mesh.Draw(shader);
+void Model::Draw(Shader &shader) const {
+  if (!arena) {
+    for (const Mesh &mesh : meshes){
+      mesh.Draw(shader);
+    }
+    return;
+  }
+  drawBatches(shader, nullptr);
+}
+
+void Model::Draw(Shader &shader, const Frustum &frustum) const {
+  size_t visibleCount = cullAabbs(frustum, meshBounds, meshVisible.data());
+  FrameStats &stats = currentFrameStats();
+  stats.objectsVisible += static_cast<uint32_t>(visibleCount);
+  stats.objectsCulled += static_cast<uint32_t>(meshes.size() - visibleCount);
+  if (!arena) {
+    for (size_t i{}; i < meshes.size(); ++i) {
+      if (meshVisible[i]) {
+        meshes[i].Draw(shader);
+      }
+    }
+    return;
   }
+  drawBatches(shader, meshVisible.data());
 }
 
-void Model::loadModel(std::string path){
+//one VAO for everything, one draw call per material. with visible set, only
+//the entries of meshes marked in it
+void Model::drawBatches(Shader &shader, const uint8_t *visible) const {
+  glState().bindVertexArray(arena->vao());
+  for (const DrawBatch &batch : batches) {
+    const GLsizei *counts = batch.counts.data();
+    const void *const *offsets = batch.offsets.data();
+    const GLint *baseVertices = batch.baseVertices.data();
+    size_t drawCount = batch.counts.size();
+    if (visible) {
+      batch.visibleCounts.clear();
+      batch.visibleOffsets.clear();
+      batch.visibleBaseVertices.clear();
+      for (size_t i{}; i < drawCount; ++i) {
+        if (visible[batch.rangeMesh[i]]) {
+          batch.visibleCounts.push_back(batch.counts[i]);
+          batch.visibleOffsets.push_back(batch.offsets[i]);
+          batch.visibleBaseVertices.push_back(batch.baseVertices[i]);
+        }
+      }
+      counts = batch.visibleCounts.data();
+      offsets = batch.visibleOffsets.data();
+      baseVertices = batch.visibleBaseVertices.data();
+      drawCount = batch.visibleCounts.size();
+      if (drawCount == 0) {
+        continue;
+      }
+    }
+    meshes[batch.mesh].bind(shader);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts, arena->indexType(),
+                                  offsets, static_cast<GLsizei>(drawCount),
+                                  baseVertices);
+  }
+}
+
+size_t Model::drawCallCount() const {
+  if (arena) {
+    return batches.size();
+  }
+  size_t calls{};
+  for (const Mesh &mesh : meshes) {
+    calls += mesh.drawRangeCount();
+  }
+  return calls;
+}
+
+size_t Model::vertexBytes() const {
+  size_t bytes{};
+  for (const Mesh &mesh : meshes) {
+    bytes += mesh.vertexBytes();
+  }
+  return bytes;
+}
+
+size_t Model::indexBytes() const {
+  size_t bytes{};
+  for (const Mesh &mesh : meshes) {
+    bytes += mesh.indexBytes();
+  }
+  return bytes;
+}
+
+static MeshUploadOptions uploadOptions(const ModelLoadOptions &options,
+                                       MeshArena *arena) {
+  MeshUploadOptions upload;
+  upload.vertexFormat = options.vertexFormat;
+  upload.splitForShortIndices = options.splitLargeMeshes;
+  upload.arena = arena;
+  return upload;
+}
+
+//sized from the exact totals so the arena never has to grow while the model
+//uploads (splitting can still add a few vertecies). 16 bit indices unless
+//some mesh is too big for them and won't be split
+void Model::createArena(const ModelLoadOptions &options,
+                        const std::vector<const Vertex*> &vertexData,
+                        const std::vector<size_t> &vertexCounts,
+                        const std::vector<size_t> &indexCounts) {
+  size_t totalVertices{}, totalIndices{};
+  GLenum indexType = GL_UNSIGNED_SHORT;
+  glm::vec3 lo(std::numeric_limits<float>::max());
+  glm::vec3 hi(-std::numeric_limits<float>::max());
+  for (size_t i{}; i < vertexCounts.size(); ++i) {
+    totalVertices += vertexCounts[i];
+    totalIndices += indexCounts[i];
+    if (vertexCounts[i] > 65536 && !options.splitLargeMeshes) {
+      indexType = GL_UNSIGNED_INT;
+    }
+    if (options.vertexFormat == VERTEX_COMPACT) {
+      for (size_t v{}; v < vertexCounts[i]; ++v) {
+        lo = glm::min(lo, vertexData[i][v].Position);
+        hi = glm::max(hi, vertexData[i][v].Position);
+      }
+    }
+  }
+  PositionDequant dequant;
+  if (options.vertexFormat == VERTEX_COMPACT && totalVertices != 0) {
+    dequant = positionDequant(lo, hi);
+  }
+  arena = std::make_unique<MeshArena>(options.vertexFormat, indexType,
+                                      totalVertices, totalIndices, dequant);
+}
+
+//meshes whose textures match exactly (same ids, same roles, same order)
+//bind the same material, so they go out in one multi draw. batches follow
+//the first mesh of each material, in load order
+void Model::buildBatches() {
+  batches.clear();
+  for (size_t i{}; i < meshes.size(); ++i) {
+    const std::vector<Texture> &textures = meshes[i].textures;
+    DrawBatch *batch{nullptr};
+    for (DrawBatch &candidate : batches) {
+      const std::vector<Texture> &other = meshes[candidate.mesh].textures;
+      bool same = other.size() == textures.size();
+      for (size_t t{}; same && t < textures.size(); ++t) {
+        same = other[t].id == textures[t].id
+          && other[t].type == textures[t].type;
+      }
+      if (same) {
+        batch = &candidate;
+        break;
+      }
+    }
+    if (!batch) {
+      batches.emplace_back();
+      batch = &batches.back();
+      batch->mesh = i;
+    }
+    for (const Mesh::DrawRange &range : meshes[i].drawRanges()) {
+      batch->counts.push_back(range.count);
+      batch->offsets.push_back(reinterpret_cast<const void*>(range.offset));
+      batch->baseVertices.push_back(range.baseVertex);
+      batch->rangeMesh.push_back(i);
+    }
+  }
+  for (DrawBatch &batch : batches) {
+    batch.visibleCounts.reserve(batch.counts.size());
+    batch.visibleOffsets.reserve(batch.counts.size());
+    batch.visibleBaseVertices.reserve(batch.counts.size());
+  }
+}
+
+void Model::buildBounds() {
+  bounds = Aabb();
+  meshBounds.clear();
+  meshBounds.reserve(meshes.size());
+  for (const Mesh &mesh : meshes) {
+    bounds.grow(mesh.boundingBox());
+    meshBounds.push_back(mesh.boundingBox());
+  }
+  meshVisible.assign(meshes.size(), 1);
+}
+
+using loadClock = std::chrono::steady_clock;
+
+static double msSince(loadClock::time_point start) {
+  return std::chrono::duration<double, std::milli>(loadClock::now() - start)
+    .count();
+}
+
+void Model::loadModel(std::string path, const ModelLoadOptions &options){
+  //eg: proj/models/foo.obj -> proj/models
+  directory = path.substr(0, path.find_last_of('/'));
+  textureLoader = options.textureLoader;
+
+  loadClock::time_point phaseStart = loadClock::now();
+  std::string cachePath = path + ".meshcache";
+  uint64_t sourceHash{};
+  uint32_t meshFlags = options.optimizeMeshes ? MESH_FLAG_OPTIMIZED : 0;
+  if (options.useMeshCache) {
+    sourceHash = MeshCache::hashSourceFile(path);
+    if (sourceHash != 0 && loadFromCache(cachePath, sourceHash, options)) {
+      textureLoader = nullptr;
+      return;
+    }
+  }
+
+  //cold start (or stale cache): go through Assimp
   Assimp::Importer importer;
-  const aiScene *scene = 
-    importer.ReadFile(path,
-                      aiProcess_Triangulate |
-                      aiProcess_GenSmoothNormals |
-                      aiProcess_FlipUVs |
-                      aiProcess_CalcTangentSpace);
+  const aiScene *scene = importer.ReadFile(path, IMPORT_FLAGS);
+  timings.importMs = msSince(phaseStart);
 
   if (!scene
     || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE
     || !scene->mRootNode){
     std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+    textureLoader = nullptr;
     return;
   
   }
-  //eg: proj/models/foo.obj -> proj/models
-  directory = path.substr(0, path.find_last_of('/'));
 
-  processNode(scene->mRootNode, scene);
+  //flatten the node tree first so the conversion below can be handed out
+  //by index (and so mesh order matches the old depth first order)
+  std::vector<aiMesh *> aiMeshes;
+  processNode(scene->mRootNode, scene, aiMeshes);
+
+  //CPU only: aiMesh -> Vertex/index arrays
+  phaseStart = loadClock::now();
+  std::vector<MeshData> meshData(aiMeshes.size());
+  auto convert = [&](size_t i) {
+    meshData[i] = processMesh(aiMeshes[i], options.optimizeMeshes);
+  };
+  if (options.jobs) {
+    //meshes are few and uneven: one job each
+    options.jobs->parallelFor(aiMeshes.size(), convert, 1);
+  } else {
+    for (size_t i{}; i < aiMeshes.size(); ++i) {
+      convert(i);
+    }
+  }
+  timings.convertMs = msSince(phaseStart);
+  if (options.optimizeMeshes) {
+    for (const MeshData &data : meshData) {
+      meshStats.push_back(data.stats);
+    }
+  }
+
+  //everything from here on touches GL so it stays on this thread
+  phaseStart = loadClock::now();
+  std::vector<std::vector<Texture>> meshTextures(aiMeshes.size());
+  for (size_t i{}; i < aiMeshes.size(); ++i) {
+    meshTextures[i] = processMaterial(aiMeshes[i], scene);
+  }
+  timings.texturesMs = msSince(phaseStart);
+
+  if (options.useMeshCache && sourceHash != 0) {
+    std::vector<MeshCacheSource> sources(aiMeshes.size());
+    for (size_t i{}; i < aiMeshes.size(); ++i) {
+      sources[i] = {&meshData[i].vertecies, &meshData[i].indices,
+                    &meshTextures[i]};
+    }
+    if (!MeshCache::write(cachePath, sourceHash, IMPORT_FLAGS, meshFlags,
+                          sources)) {
+      std::cout << "WARNING::MESH_CACHE::WRITE_FAILED " << cachePath
+                << std::endl;
+    }
+  }
+
+  phaseStart = loadClock::now();
+  if (options.sharedBuffers) {
+    std::vector<const Vertex*> vertexData(aiMeshes.size());
+    std::vector<size_t> vertexCounts(aiMeshes.size());
+    std::vector<size_t> indexCounts(aiMeshes.size());
+    for (size_t i{}; i < aiMeshes.size(); ++i) {
+      vertexData[i] = meshData[i].vertecies.data();
+      vertexCounts[i] = meshData[i].vertecies.size();
+      indexCounts[i] = meshData[i].indices.size();
+    }
+    createArena(options, vertexData, vertexCounts, indexCounts);
+  }
+  if (options.pickable) {
+    //Position is Vertex's first member
+    for (const MeshData &data : meshData) {
+      triangles.append(reinterpret_cast<const float*>(data.vertecies.data()),
+                       sizeof(Vertex) / sizeof(float), data.vertecies.size(),
+                       data.indices.data(), data.indices.size());
+    }
+  }
+  meshes.reserve(meshes.size() + aiMeshes.size());
+  for (size_t i{}; i < aiMeshes.size(); ++i) {
+    meshes.emplace_back(std::move(meshData[i].vertecies),
+                        std::move(meshData[i].indices),
+                        std::move(meshTextures[i]), options.keepCpuData,
+                        uploadOptions(options, arena.get()));
+  }
+  if (arena) {
+    buildBatches();
+  }
+  buildBounds();
+  timings.uploadMs = msSince(phaseStart);
+  textureLoader = nullptr;
 } 
 
-void Model::processNode(aiNode *aiNode, const aiScene *scene){
+//warm start: everything comes out of the mapped cache file and goes straight
+//into glBufferData. returns false (having touched nothing) on a miss.
+bool Model::loadFromCache(const std::string &cachePath, uint64_t sourceHash,
+                          const ModelLoadOptions &options){
+  loadClock::time_point phaseStart = loadClock::now();
+  MeshCache cache;
+  uint32_t meshFlags = options.optimizeMeshes ? MESH_FLAG_OPTIMIZED : 0;
+  if (!cache.open(cachePath, sourceHash, IMPORT_FLAGS, meshFlags)) {
+    return false;
+  }
+  std::vector<CachedMesh> cached(cache.meshCount());
+  for (size_t i{}; i < cached.size(); ++i) {
+    cached[i] = cache.mesh(i);
+  }
+  timings.fromCache = true;
+  timings.importMs = msSince(phaseStart);
+  timings.convertMs = 0.0;
+
+  phaseStart = loadClock::now();
+  std::vector<std::vector<Texture>> meshTextures(cached.size());
+  for (size_t i{}; i < cached.size(); ++i) {
+    for (const TextureRef &ref : cached[i].textures) {
+      meshTextures[i].push_back(loadTexture(ref.fName, ref.type));
+    }
+  }
+  timings.texturesMs = msSince(phaseStart);
+
+  phaseStart = loadClock::now();
+  if (options.sharedBuffers) {
+    std::vector<const Vertex*> vertexData(cached.size());
+    std::vector<size_t> vertexCounts(cached.size());
+    std::vector<size_t> indexCounts(cached.size());
+    for (size_t i{}; i < cached.size(); ++i) {
+      vertexData[i] = cached[i].vertecies;
+      vertexCounts[i] = cached[i].vertexCount;
+      indexCounts[i] = cached[i].indexCount;
+    }
+    createArena(options, vertexData, vertexCounts, indexCounts);
+  }
+  if (options.pickable) {
+    for (const CachedMesh &c : cached) {
+      triangles.append(reinterpret_cast<const float*>(c.vertecies),
+                       sizeof(Vertex) / sizeof(float), c.vertexCount,
+                       c.indices, c.indexCount);
+    }
+  }
+  meshes.reserve(meshes.size() + cached.size());
+  for (size_t i{}; i < cached.size(); ++i) {
+    if (options.keepCpuData) {
+      const CachedMesh &c = cached[i];
+      meshes.emplace_back(
+        std::vector<Vertex>(c.vertecies, c.vertecies + c.vertexCount),
+        std::vector<unsigned int>(c.indices, c.indices + c.indexCount),
+        std::move(meshTextures[i]), true,
+        uploadOptions(options, arena.get()));
+    } else {
+      meshes.emplace_back(cached[i].vertecies, cached[i].vertexCount,
+                          cached[i].indices, cached[i].indexCount,
+                          std::move(meshTextures[i]),
+                          uploadOptions(options, arena.get()));
+    }
+  }
+  if (arena) {
+    buildBatches();
+  }
+  buildBounds();
+  timings.uploadMs = msSince(phaseStart);
+  return true;
+}
+
+void Model::processNode(aiNode *aiNode, const aiScene *scene,
+                        std::vector<aiMesh *> &aiMeshes){
   for (size_t i{}; i < aiNode->mNumMeshes; ++i){
     //somewhat confusingly, each aiNode contains a list of
     //INDECIES called mMeshes that keys into their corresponding
     //meshes in the SCENE'S mMeshes member.
-    aiMesh *aiMesh = scene->mMeshes[aiNode->mMeshes[i]];
-    meshes.push_back(processMesh(aiMesh, scene));
+    aiMeshes.push_back(scene->mMeshes[aiNode->mMeshes[i]]);
   }
 
   for (size_t i{}; i < aiNode->mNumChildren; ++i){
-    processNode(aiNode->mChildren[i], scene);
+    processNode(aiNode->mChildren[i], scene, aiMeshes);
   }
 }
 
-Mesh Model::processMesh(aiMesh *aiMesh, const aiScene *scene){
-  std::vector<Vertex> vertecies;
-  std::vector<unsigned int> indices;
-  std::vector<Texture> textures;
+//pure CPU work, no GL calls and no shared state: may run on any thread
+Model::MeshData Model::processMesh(const aiMesh *aiMesh, bool optimize){
+  MeshData data;
+  std::vector<Vertex> &vertecies = data.vertecies;
+  std::vector<unsigned int> &indices = data.indices;
 
   //load up our vertecies
+  vertecies.resize(aiMesh->mNumVertices);
   for (size_t i{}; i < aiMesh->mNumVertices; ++i) {
-    Vertex vertex;
+    Vertex &vertex = vertecies[i];
     //positions
     vertex.Position.x = aiMesh->mVertices[i].x;
     vertex.Position.y = aiMesh->mVertices[i].y;
@@ -72,6 +427,8 @@ Mesh Model::processMesh(aiMesh *aiMesh, const aiScene *scene){
       vertex.Normal.x = aiMesh->mNormals[i].x;
       vertex.Normal.y = aiMesh->mNormals[i].y;
       vertex.Normal.z = aiMesh->mNormals[i].z;
+    } else {
+      vertex.Normal = glm::vec3(0.0f);
     }
     if (aiMesh->mTextureCoords[0]) { 
       //texture coords
@@ -87,19 +444,31 @@ Mesh Model::processMesh(aiMesh *aiMesh, const aiScene *scene){
       vertex.BiTangent.z = aiMesh->mBitangents[i].z;
     } else {
       vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+      vertex.Tangent = glm::vec3(0.0f);
+      vertex.BiTangent = glm::vec3(0.0f);
     }
-    vertecies.push_back(vertex);
   }
 
-  //load up our indices
+  //load up our indices (Triangulate means this is almost always 3 per face)
+  indices.reserve(static_cast<size_t>(aiMesh->mNumFaces) * 3);
   for (size_t i{}; i < aiMesh->mNumFaces; ++i) {
     //leaving this as a pointer cuz idk how big a face is
-    aiFace *face = &(aiMesh->mFaces[i]); 
-    for (size_t j{}; j < face->mNumIndices; ++j) {
-      indices.push_back(face->mIndices[j]);
-    }
+    const aiFace *face = &(aiMesh->mFaces[i]); 
+    indices.insert(indices.end(), face->mIndices,
+                   face->mIndices + face->mNumIndices);
   }
 
+  if (optimize) {
+    data.stats = optimizeMesh(vertecies, indices);
+  }
+  return data;
+}
+
+//texture lookups/uploads touch GL and texturesLoaded, so GL thread only
+std::vector<Texture> Model::processMaterial(const aiMesh *aiMesh,
+                                            const aiScene *scene){
+  std::vector<Texture> textures;
+
   //load up our textures
   if (aiMesh->mMaterialIndex >= 0) { //if textures exist at all
     aiMaterial *aiMat = scene->mMaterials[aiMesh->mMaterialIndex];
@@ -122,7 +491,7 @@ Mesh Model::processMesh(aiMesh *aiMesh, const aiScene *scene){
     textures.insert(textures.end(), normalMap.begin(), normalMap.end());
 
   }
-  return Mesh(vertecies, indices, textures);
+  return textures;
 }
 
 std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat,
@@ -132,67 +501,32 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat,
   for (size_t i{}; i < mat->GetTextureCount(type); ++i) {
     aiString texFPath;
     mat->GetTexture(type, i, &texFPath); 
-    bool loaded{false};
-    //check if texture has been loaded before (optimization)
-    for (size_t j{}; j < texturesLoaded.size(); ++j){
-      if (std::strcmp(texturesLoaded[j].fName.c_str(), texFPath.C_Str()) == 0){
-        textures.push_back(texturesLoaded[j]);
-        loaded = true;
-        break;
-      }
-    }
-
-    if (!loaded) {
-      Texture tex;
-      tex.id = textureFromFile(texFPath.C_Str(), directory);
-      tex.type = typeName;
-      tex.fName = texFPath.C_Str();
-      textures.push_back(tex);
-      texturesLoaded.push_back(tex);
-    }
+    textures.push_back(loadTexture(texFPath.C_Str(), typeName));
   }
   return textures;
 }
 
-//loads a texture and returns its id
-static unsigned int textureFromFile(std::string fName, std::string directory) {
-  unsigned int textureID;
-  glGenTextures(1, &textureID);
-
-  int width, height, nrChannels;
-  std::string path = (directory + '/' + fName);
-  std::cout << path << std::endl;
-  unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrChannels,
-                                 0);
-  if (data) {
-    GLenum format;
-    switch (nrChannels) {
-      case 1:
-        format = GL_RED;
-        break;
-      case 3:
-        format = GL_RGB;
-        break;
-      case 4:
-        format = GL_RGBA;
-        break;
-    }
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height,
-                 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, 
-                    GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
-  } else {
-    std::cout << "Texture failed to load at path: " << path << std::endl;
-    stbi_image_free(data);
+//shared texture for fName through the process wide TextureCache, so models
+//referencing the same file share one upload
+Texture Model::loadTexture(const std::string &fName,
+                           const std::string &typeName) {
+  //neutral stand-ins while an async load is in flight: mid grey albedo, a
+  //flat normal, no specular
+  static const unsigned char grey[4] = {128, 128, 128, 255};
+  static const unsigned char flatNormal[4] = {128, 128, 255, 255};
+  static const unsigned char black[4] = {0, 0, 0, 255};
+  const unsigned char *placeholder = grey;
+  if (typeName == "texture_normal") {
+    placeholder = flatNormal;
+  } else if (typeName == "texture_specular") {
+    placeholder = black;
   }
-  return textureID;
 
+  Texture tex;
+  tex.handle = TextureCache::instance().acquire(directory + '/' + fName, {},
+                                                textureLoader, placeholder);
+  tex.id = tex.handle->id();
+  tex.type = typeName;
+  tex.fName = fName;
+  return tex;
 }
@@ -3,32 +3,145 @@
 
 
 #include <assimp/scene.h>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
+#include "frustum.h"
 #include "mesh.h"
+#include "mesh_arena.h"
+#include "mesh_optimize.h"
+#include "picking.h"
 #include "shader.h"
 
+class AsyncTextureLoader;
+class JobSystem;
+
+struct ModelLoadOptions {
+  //when set, the aiMesh -> Vertex conversion is spread across its workers
+  //(the calling thread helps); all GL work still happens on the calling
+  //(context) thread
+  JobSystem *jobs{nullptr};
+  //read/write <model path>.meshcache so warm starts skip Assimp entirely
+  bool useMeshCache{true};
+  //keep each Mesh's vertecies/indices after upload. nothing in the draw path
+  //needs them, so turn this off to halve the model's memory footprint
+  bool keepCpuData{true};
+  //when set, material textures come back as 1x1 placeholders right away and
+  //are decoded on the loader's jobs. pump the loader every frame (or call
+  //finish()) to swap the real images in. must outlive the load, not the model
+  AsyncTextureLoader *textureLoader{nullptr};
+  //VERTEX_COMPACT quantizes vertecies at upload (20 instead of 56 bytes
+  //each); draw the model with a COMPACT_VERTICES shader then
+  VertexFormat vertexFormat{VERTEX_FULL};
+  //run every mesh through optimizeMesh (dedup, vertex cache, overdraw and
+  //fetch order) during conversion. the mesh cache stores the result
+  bool optimizeMeshes{true};
+  //split meshes with more than 65536 vertecies so they can use 16 bit
+  //indices too (see MeshUploadOptions). smaller ones always do
+  bool splitLargeMeshes{false};
+  //put every mesh in one MeshArena and draw meshes that share a material
+  //with a single glMultiDrawElementsBaseVertex. VERTEX_COMPACT then uses one
+  //position transform for the whole model instead of one per mesh
+  bool sharedBuffers{false};
+  //also pack every mesh's triangles for ray picking (see pickTriangles)
+  bool pickable{false};
+};
+
+//wall clock time (ms) spent in each phase of loadModel
+struct ModelLoadTimings {
+  bool fromCache{};    //true when the mesh cache was hit
+  double importMs{};   //ReadFile + post processing, or hashing + mapping the
+                       //cache on a warm start
+  double convertMs{};  //aiMesh -> Vertex/index arrays (CPU only)
+  double texturesMs{}; //decode + upload of material textures (only queueing
+                       //them up with a textureLoader)
+  double uploadMs{};   //Mesh::setupMesh (VAO/VBO/EBO creation)
+};
+
 class Model {
 public:
-  Model(std::string path){
-    loadModel(path);
+  Model(std::string path, const ModelLoadOptions &options = {}){
+    loadModel(path, options);
   }
 
-  void Draw(Shader &shader);
+  void Draw(Shader &shader) const;
+  //draws only the meshes whose bounds touch frustum, which has to be in the
+  //model's space: build it from projection * view * model. adds to the
+  //frame's visible/culled counts
+  void Draw(Shader &shader, const Frustum &frustum) const;
+  //union of the mesh bounds, in model space
+  const Aabb &boundingBox() const { return bounds; }
+  const ModelLoadTimings &loadTimings() const { return timings; }
+  //GPU vertex/index buffer sizes summed over every mesh
+  size_t vertexBytes() const;
+  size_t indexBytes() const;
+  //per mesh result of optimizeMeshes; empty when it was off or the meshes
+  //came (already optimized) out of the mesh cache
+  const std::vector<MeshOptimizeStats> &optimizeStats() const {
+    return meshStats;
+  }
+  //draw calls Draw makes: one per material with sharedBuffers, otherwise
+  //one per mesh draw range
+  size_t drawCallCount() const;
+  //every mesh's triangles in model space, mesh by mesh (meshOf() tells
+  //which); empty unless loaded with pickable
+  const PackedTriangles &pickTriangles() const { return triangles; }
 
 private: 
+  //CPU side result of converting one aiMesh; safe to build off the GL thread
+  struct MeshData {
+    std::vector<Vertex>       vertecies;
+    std::vector<unsigned int> indices;
+    MeshOptimizeStats stats;
+  };
+
+  //meshes with the same textures, drawn together out of the arena. the
+  //arrays are glMultiDrawElementsBaseVertex's, built once at load
+  struct DrawBatch {
+    size_t mesh; //whose bind() sets up the material
+    std::vector<GLsizei>     counts;
+    std::vector<const void*> offsets;
+    std::vector<GLint>       baseVertices;
+    std::vector<size_t>      rangeMesh; //which mesh each entry draws
+    //the entries that survived culling this frame; reserved at load so
+    //filling them never allocates
+    mutable std::vector<GLsizei>     visibleCounts;
+    mutable std::vector<const void*> visibleOffsets;
+    mutable std::vector<GLint>       visibleBaseVertices;
+  };
+
+  //declared before meshes so it outlives them
+  std::unique_ptr<MeshArena> arena; //only with sharedBuffers
   std::vector<Mesh> meshes; //processed meshes (not assimp's)
+  std::vector<DrawBatch> batches;
+  Aabb bounds;
+  AabbBatch meshBounds;                      //one per mesh, for cullAabbs
+  mutable std::vector<uint8_t> meshVisible;  //cullAabbs' output
+  PackedTriangles triangles;                 //only with pickable
   std::string directory;
-  std::vector<Texture> texturesLoaded; //going with a vector here over a 
-  //hashmap because the total number of textures ever loaded at a time is small
-  //enough to where a linear search over a vector is more efficient than a 
-  //hashtable lookup
-
-  void loadModel(std::string path);
-  void processNode(aiNode *aiNode, const aiScene *scene);
-  Mesh processMesh(aiMesh *aiMesh, const aiScene *scene);
+  ModelLoadTimings timings;
+  std::vector<MeshOptimizeStats> meshStats;
+  AsyncTextureLoader *textureLoader{nullptr}; //only set while loading
+
+  void loadModel(std::string path, const ModelLoadOptions &options);
+  bool loadFromCache(const std::string &cachePath, uint64_t sourceHash,
+                     const ModelLoadOptions &options);
+  void createArena(const ModelLoadOptions &options,
+                   const std::vector<const Vertex*> &vertexData,
+                   const std::vector<size_t> &vertexCounts,
+                   const std::vector<size_t> &indexCounts);
+  void buildBatches();
+  void buildBounds();
+  void drawBatches(Shader &shader, const uint8_t *visible) const;
+  void processNode(aiNode *aiNode, const aiScene *scene,
+                   std::vector<aiMesh *> &aiMeshes);
+  static MeshData processMesh(const aiMesh *aiMesh, bool optimize);
+  std::vector<Texture> processMaterial(const aiMesh *aiMesh,
+                                       const aiScene *scene);
   std::vector<Texture> loadMaterialTextures(aiMaterial *mat,
                                             aiTextureType type,
                                             std::string typeName);
+  Texture loadTexture(const std::string &fName, const std::string &typeName);
 };
 #endif
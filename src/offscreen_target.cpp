@@ -0,0 +1,39 @@
+#include "offscreen_target.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+#include "gl_state.h"
+
+OffscreenTarget::OffscreenTarget(int width, int height)
+: targetWidth(width), targetHeight(height) {
+  glGenFramebuffers(1, &FBO);
+  glState().bindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+  glGenRenderbuffers(1, &colorRBO);
+  glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, colorRBO);
+
+  glGenRenderbuffers(1, &depthStencilRBO);
+  glBindRenderbuffer(GL_RENDERBUFFER, depthStencilRBO);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                            GL_RENDERBUFFER, depthStencilRBO);
+
+  isComplete =
+    glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  if (!isComplete) {
+    std::cout << "ERROR::OFFSCREEN::FRAMEBUFFER_INCOMPLETE" << std::endl;
+  }
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  glState().bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+OffscreenTarget::~OffscreenTarget() {
+  glState().deleteFramebuffers(1, &FBO);
+  glDeleteRenderbuffers(1, &colorRBO);
+  glDeleteRenderbuffers(1, &depthStencilRBO);
+}
@@ -0,0 +1,25 @@
+#ifndef OFFSCREEN_TARGET_H
+#define OFFSCREEN_TARGET_H
+
+//framebuffer object with an RGBA8 color and a depth24/stencil8 attachment:
+//everything the scene needs (the outline relies on stencil) without a window
+class OffscreenTarget {
+public:
+  OffscreenTarget(int width, int height);
+  ~OffscreenTarget();
+
+  OffscreenTarget(const OffscreenTarget &) = delete;
+  OffscreenTarget &operator=(const OffscreenTarget &) = delete;
+
+  bool complete() const { return isComplete; }
+  unsigned int fbo() const { return FBO; }
+  int width() const { return targetWidth; }
+  int height() const { return targetHeight; }
+
+private:
+  unsigned int FBO{0}, colorRBO{0}, depthStencilRBO{0};
+  int targetWidth, targetHeight;
+  bool isComplete{false};
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include "outline_renderer.h"
+
+#include <glad/glad.h>
+
+#include "gl_state.h"
+#include "glm/glm.hpp"
+#include "shader.h"
+
+//where aModel starts in shaders/vertexInstanced.glsl; a mat4 eats 4 slots
+static const unsigned int INSTANCE_ATTRIB = 3;
+
+OutlineRenderer::OutlineRenderer(const OutlineGeometry &geometry)
+: geometry(geometry) {
+  glGenVertexArrays(1, &VAO);
+  glGenBuffers(1, &instanceVBO);
+
+  glState().bindVertexArray(VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, geometry.vbo);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, geometry.stride, (void*)0);
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, geometry.stride,
+                        (void*)geometry.texCoordOffset);
+  if (geometry.ebo) {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry.ebo);
+  }
+
+  //one mat4 per instance, fed as 4 vec4 columns
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+  for (unsigned int column{}; column < 4; ++column) {
+    glEnableVertexAttribArray(INSTANCE_ATTRIB + column);
+    glVertexAttribPointer(INSTANCE_ATTRIB + column, 4, GL_FLOAT, GL_FALSE,
+                          sizeof(glm::mat4),
+                          (void*)(column * sizeof(glm::vec4)));
+    glVertexAttribDivisor(INSTANCE_ATTRIB + column, 1);
+  }
+  glState().bindVertexArray(0);
+}
+
+OutlineRenderer::~OutlineRenderer() {
+  glDeleteBuffers(1, &instanceVBO);
+  glState().deleteVertexArrays(1, &VAO);
+}
+
+void OutlineRenderer::drawObjects(Shader &shader) {
+  glState().stencilFunc(GL_ALWAYS, 1, 0xFF); //fragment always passes stencil test
+  glState().stencilMask(0xFF); //enable writing to stencil buffer
+
+  shader.use();
+  shader.setFloat(scaleUniform(shader), 1.0f);
+  drawInstances();
+}
+
+void OutlineRenderer::drawOutline(Shader &shader, float scale) {
+  glState().stencilFunc(GL_NOTEQUAL, 1, 0xFF);
+  glState().stencilMask(0x00); //disable writing to stencil buffer
+  glState().disable(GL_DEPTH_TEST); //borders can be seen through objects
+
+  shader.use();
+  shader.setFloat(scaleUniform(shader), scale);
+  drawInstances();
+
+  glState().stencilMask(0xFF); //enable to clear buffer to zero
+  glState().stencilFunc(GL_ALWAYS, 0, 0xFF); //clear buffer to zero
+  glState().enable(GL_DEPTH_TEST);
+}
+
+void OutlineRenderer::drawMask(Shader &shader) {
+  shader.use();
+  shader.setFloat(scaleUniform(shader), 1.0f);
+  drawInstances();
+}
+
+//outlineScale for shader, resolved once per program
+UniformHandle OutlineRenderer::scaleUniform(const Shader &shader) {
+  for (const ScaleHandle &entry : scaleHandles) {
+    if (entry.program == shader.ID) {
+      return entry.handle;
+    }
+  }
+  scaleHandles.push_back({shader.ID, shader.uniform("outlineScale")});
+  return scaleHandles.back().handle;
+}
+
+void OutlineRenderer::beginInstances(size_t count) {
+  instanceCount = count;
+  //grow geometrically so a selection that keeps changing size doesn't end
+  //up with a new size every frame
+  if (instanceCount > instanceCapacity) {
+    instanceCapacity = instanceCapacity ? instanceCapacity : 16;
+    while (instanceCapacity < instanceCount) {
+      instanceCapacity *= 2;
+    }
+  }
+  //(re)specifying the store also orphans the old one, so we never wait on
+  //draws from last frame that still read it
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+  glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), NULL,
+               GL_DYNAMIC_DRAW);
+}
+
+void OutlineRenderer::writeInstances(size_t first,
+                                     const glm::mat4 *transforms,
+                                     size_t count) {
+  if (count == 0) {
+    return;
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+  glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(glm::mat4),
+                  count * sizeof(glm::mat4), transforms);
+}
+
+void OutlineRenderer::drawInstances() {
+  if (instanceCount == 0) {
+    return;
+  }
+  glState().bindVertexArray(VAO);
+  if (geometry.ebo) {
+    glDrawElementsInstanced(GL_TRIANGLES, geometry.count, GL_UNSIGNED_INT, 0,
+                            static_cast<GLsizei>(instanceCount));
+  } else {
+    glDrawArraysInstanced(GL_TRIANGLES, 0, geometry.count,
+                          static_cast<GLsizei>(instanceCount));
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef OUTLINE_RENDERER_H
+#define OUTLINE_RENDERER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "shader.h"
+
+//vertex data the outline renderer draws for every selected object. it only
+//reads position (attribute 0) and texcoords (attribute 2) out of the buffer;
+//the buffers stay owned by whoever created them.
+struct OutlineGeometry {
+  unsigned int vbo;
+  unsigned int ebo;          //0 for non-indexed geometry
+  GLsizei      count;        //vertex count, or index count if ebo != 0
+  GLsizei      stride;
+  size_t       texCoordOffset;
+};
+
+//draws every selected object with one instanced call per pass instead of
+//two draws + two uniform uploads per object. the per object model matrices
+//live in an instance buffer, so shaders passed in here must use
+//shaders/vertexInstanced.glsl (aModel at locations 3-6).
+class OutlineRenderer {
+public:
+  explicit OutlineRenderer(const OutlineGeometry &geometry);
+  ~OutlineRenderer();
+
+  OutlineRenderer(const OutlineRenderer &) = delete;
+  OutlineRenderer &operator=(const OutlineRenderer &) = delete;
+
+  //the draws use count instances (already culled), written in pieces by
+  //writeInstances() at their offsets. the old contents are orphaned;
+  //unwritten instances are undefined
+  void beginInstances(size_t count);
+  void writeInstances(size_t first, const glm::mat4 *transforms,
+                      size_t count);
+  //instances the draws use, as given to beginInstances()
+  size_t drawCount() const { return instanceCount; }
+
+  //1st pass: draws the selected objects with shader and writes 1 into the
+  //stencil buffer wherever they end up. textures etc. are the caller's job.
+  void drawObjects(Shader &shader);
+
+  //2nd pass: draws the objects again, scaled by scale, wherever the stencil
+  //is not 1 (ie just the border) and through everything else. leaves
+  //stencil/depth state as the render loop expects it at the end of a frame.
+  void drawOutline(Shader &shader, float scale);
+
+  //draws the instances unscaled with shader and leaves all stencil/depth
+  //state alone; for objects that don't take part in the outline
+  void drawMask(Shader &shader);
+
+private:
+  OutlineGeometry geometry;
+  unsigned int VAO{0}, instanceVBO{0};
+  size_t instanceCount{0};
+  size_t instanceCapacity{0};
+
+  //there are only ever two programs (object + border), so a vector
+  struct ScaleHandle {
+    unsigned int  program;
+    UniformHandle handle;
+  };
+  std::vector<ScaleHandle> scaleHandles;
+
+  UniformHandle scaleUniform(const Shader &shader);
+  void drawInstances();
+};
+
+#endif
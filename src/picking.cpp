@@ -0,0 +1,313 @@
+#include "picking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+//below this the ray runs along the triangle's plane
+static const float DET_EPSILON = 1e-12f;
+
+Ray rayFromScreen(float x, float y, int width, int height,
+                  const glm::mat4 &view, const glm::mat4 &projection) {
+  //window y goes down, NDC y goes up
+  float ndcX = 2.0f * x / static_cast<float>(width) - 1.0f;
+  float ndcY = 1.0f - 2.0f * y / static_cast<float>(height);
+  glm::mat4 worldFromClip = glm::inverse(projection * view);
+  glm::vec4 nearPoint = worldFromClip * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+  glm::vec4 farPoint = worldFromClip * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+  glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+  glm::vec3 end = glm::vec3(farPoint) / farPoint.w;
+  return {origin, glm::normalize(end - origin)};
+}
+
+// ==============================TRIANGLES=====================================
+void PackedTriangles::append(const float *positions, size_t stride,
+                             size_t vertexCount, const unsigned int *indices,
+                             size_t indexCount) {
+  size_t count = (indices ? indexCount : vertexCount) / 3;
+  meshFirst.push_back(static_cast<uint32_t>(triangles));
+  size_t blockCount = (triangles + count + PICK_LANES - 1) / PICK_LANES;
+  blocks.resize(blockCount * 9 * PICK_LANES, 0.0f);
+
+  auto vertex = [&](size_t i) {
+    const float *p = positions + (indices ? indices[i] : i) * stride;
+    return glm::vec3(p[0], p[1], p[2]);
+  };
+  for (size_t i{}; i < count; ++i) {
+    glm::vec3 v0 = vertex(3 * i);
+    glm::vec3 v1 = vertex(3 * i + 1);
+    glm::vec3 v2 = vertex(3 * i + 2);
+    glm::vec3 e1 = v1 - v0, e2 = v2 - v0;
+    bounds.grow(v0);
+    bounds.grow(v1);
+    bounds.grow(v2);
+
+    float *block = blocks.data() + (triangles / PICK_LANES) * 9 * PICK_LANES;
+    size_t lane = triangles % PICK_LANES;
+    const float values[9] = {v0.x, v0.y, v0.z, e1.x, e1.y, e1.z,
+                             e2.x, e2.y, e2.z};
+    for (size_t c{}; c < 9; ++c) {
+      block[c * PICK_LANES + lane] = values[c];
+    }
+    ++triangles;
+  }
+}
+
+void PackedTriangles::clear() {
+  blocks.clear();
+  triangles = 0;
+  meshFirst.clear();
+  bounds = Aabb();
+}
+
+uint32_t PackedTriangles::meshOf(uint32_t triangle) const {
+  auto next = std::upper_bound(meshFirst.begin(), meshFirst.end(), triangle);
+  return static_cast<uint32_t>(next - meshFirst.begin()) - 1;
+}
+
+//Moller-Trumbore, both windings
+bool PackedTriangles::intersectScalar(const glm::vec3 &origin,
+                                      const glm::vec3 &direction, float &t,
+                                      uint32_t &triangle) const {
+  bool hit = false;
+  for (size_t i{}; i < triangles; ++i) {
+    const float *block = blocks.data() + (i / PICK_LANES) * 9 * PICK_LANES
+      + i % PICK_LANES;
+    glm::vec3 v0(block[0], block[PICK_LANES], block[2 * PICK_LANES]);
+    glm::vec3 e1(block[3 * PICK_LANES], block[4 * PICK_LANES],
+                 block[5 * PICK_LANES]);
+    glm::vec3 e2(block[6 * PICK_LANES], block[7 * PICK_LANES],
+                 block[8 * PICK_LANES]);
+    glm::vec3 p = glm::cross(direction, e2);
+    float det = glm::dot(e1, p);
+    if (std::abs(det) <= DET_EPSILON) {
+      continue;
+    }
+    float invDet = 1.0f / det;
+    glm::vec3 s = origin - v0;
+    float u = glm::dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f) {
+      continue;
+    }
+    glm::vec3 q = glm::cross(s, e1);
+    float v = glm::dot(direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f) {
+      continue;
+    }
+    float distance = glm::dot(e2, q) * invDet;
+    if (distance > 0.0f && distance < t) {
+      t = distance;
+      triangle = static_cast<uint32_t>(i);
+      hit = true;
+    }
+  }
+  return hit;
+}
+
+bool PackedTriangles::intersect(const glm::vec3 &origin,
+                                const glm::vec3 &direction, float &t,
+                                uint32_t &triangle) const {
+#if defined(__AVX__)
+  const __m256 ox = _mm256_set1_ps(origin.x), oy = _mm256_set1_ps(origin.y);
+  const __m256 oz = _mm256_set1_ps(origin.z);
+  const __m256 dx = _mm256_set1_ps(direction.x);
+  const __m256 dy = _mm256_set1_ps(direction.y);
+  const __m256 dz = _mm256_set1_ps(direction.z);
+  const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+  const __m256 epsilon = _mm256_set1_ps(DET_EPSILON);
+  const __m256 signBit = _mm256_set1_ps(-0.0f);
+  __m256 best = _mm256_set1_ps(t);
+  bool hit = false;
+  size_t blockCount = (triangles + PICK_LANES - 1) / PICK_LANES;
+  for (size_t b{}; b < blockCount; ++b) {
+    const float *block = blocks.data() + b * 9 * PICK_LANES;
+    __m256 v0x = _mm256_loadu_ps(block), v0y = _mm256_loadu_ps(block + 8);
+    __m256 v0z = _mm256_loadu_ps(block + 16);
+    __m256 e1x = _mm256_loadu_ps(block + 24);
+    __m256 e1y = _mm256_loadu_ps(block + 32);
+    __m256 e1z = _mm256_loadu_ps(block + 40);
+    __m256 e2x = _mm256_loadu_ps(block + 48);
+    __m256 e2y = _mm256_loadu_ps(block + 56);
+    __m256 e2z = _mm256_loadu_ps(block + 64);
+
+    //p = direction x e2, det = e1 . p
+    __m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+    __m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+    __m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+    __m256 det = _mm256_add_ps(
+      _mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)),
+      _mm256_mul_ps(e1z, pz));
+    __m256 invDet = _mm256_div_ps(one, det);
+
+    __m256 sx = _mm256_sub_ps(ox, v0x), sy = _mm256_sub_ps(oy, v0y);
+    __m256 sz = _mm256_sub_ps(oz, v0z);
+    __m256 u = _mm256_mul_ps(_mm256_add_ps(
+      _mm256_add_ps(_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)),
+      _mm256_mul_ps(sz, pz)), invDet);
+
+    //q = s x e1
+    __m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+    __m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+    __m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+    __m256 v = _mm256_mul_ps(_mm256_add_ps(
+      _mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)),
+      _mm256_mul_ps(dz, qz)), invDet);
+    __m256 distance = _mm256_mul_ps(_mm256_add_ps(
+      _mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)),
+      _mm256_mul_ps(e2z, qz)), invDet);
+
+    __m256 mask = _mm256_cmp_ps(_mm256_andnot_ps(signBit, det), epsilon,
+                                _CMP_GT_OQ);
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(u, v), one,
+                                             _CMP_LE_OQ));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(distance, zero, _CMP_GT_OQ));
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(distance, best, _CMP_LT_OQ));
+    int lanes = _mm256_movemask_ps(mask);
+    if (lanes) {
+      //rare: a few hits per ray, so the nearest lane is found in scalar
+      alignas(32) float distances[8];
+      _mm256_store_ps(distances, distance);
+      for (int k{}; k < 8; ++k) {
+        if ((lanes >> k) & 1 && distances[k] < t) {
+          t = distances[k];
+          triangle = static_cast<uint32_t>(b * PICK_LANES + k);
+        }
+      }
+      best = _mm256_set1_ps(t);
+      hit = true;
+    }
+  }
+  return hit;
+#elif defined(__SSE2__) || defined(_M_X64)
+  const __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y);
+  const __m128 oz = _mm_set1_ps(origin.z);
+  const __m128 dx = _mm_set1_ps(direction.x), dy = _mm_set1_ps(direction.y);
+  const __m128 dz = _mm_set1_ps(direction.z);
+  const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+  const __m128 epsilon = _mm_set1_ps(DET_EPSILON);
+  const __m128 signBit = _mm_set1_ps(-0.0f);
+  __m128 best = _mm_set1_ps(t);
+  bool hit = false;
+  size_t blockCount = (triangles + PICK_LANES - 1) / PICK_LANES;
+  for (size_t b{}; b < blockCount; ++b) {
+    const float *block = blocks.data() + b * 9 * PICK_LANES;
+    __m128 v0x = _mm_loadu_ps(block), v0y = _mm_loadu_ps(block + 4);
+    __m128 v0z = _mm_loadu_ps(block + 8), e1x = _mm_loadu_ps(block + 12);
+    __m128 e1y = _mm_loadu_ps(block + 16), e1z = _mm_loadu_ps(block + 20);
+    __m128 e2x = _mm_loadu_ps(block + 24), e2y = _mm_loadu_ps(block + 28);
+    __m128 e2z = _mm_loadu_ps(block + 32);
+
+    //p = direction x e2, det = e1 . p
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px),
+                                       _mm_mul_ps(e1y, py)),
+                            _mm_mul_ps(e1z, pz));
+    __m128 invDet = _mm_div_ps(one, det);
+
+    __m128 sx = _mm_sub_ps(ox, v0x), sy = _mm_sub_ps(oy, v0y);
+    __m128 sz = _mm_sub_ps(oz, v0z);
+    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px),
+                                                _mm_mul_ps(sy, py)),
+                                     _mm_mul_ps(sz, pz)), invDet);
+
+    //q = s x e1
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx),
+                                                _mm_mul_ps(dy, qy)),
+                                     _mm_mul_ps(dz, qz)), invDet);
+    __m128 distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx),
+                                                       _mm_mul_ps(e2y, qy)),
+                                            _mm_mul_ps(e2z, qz)), invDet);
+
+    __m128 mask = _mm_cmpgt_ps(_mm_andnot_ps(signBit, det), epsilon);
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+    mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+    mask = _mm_and_ps(mask, _mm_cmpgt_ps(distance, zero));
+    mask = _mm_and_ps(mask, _mm_cmplt_ps(distance, best));
+    int lanes = _mm_movemask_ps(mask);
+    if (lanes) {
+      //rare: a few hits per ray, so the nearest lane is found in scalar
+      alignas(16) float distances[4];
+      _mm_store_ps(distances, distance);
+      for (int k{}; k < 4; ++k) {
+        if ((lanes >> k) & 1 && distances[k] < t) {
+          t = distances[k];
+          triangle = static_cast<uint32_t>(b * PICK_LANES + k);
+        }
+      }
+      best = _mm_set1_ps(t);
+      hit = true;
+    }
+  }
+  return hit;
+#else
+  return intersectScalar(origin, direction, t, triangle);
+#endif
+}
+
+// ==============================PICKER========================================
+uint32_t Picker::addObject(const PackedTriangles *shape,
+                           const glm::mat4 &transform) {
+  objects.push_back({shape, glm::inverse(transform)});
+  worldBounds.push_back(transformAabb(shape->boundingBox(), transform));
+  rebuild = true;
+  return static_cast<uint32_t>(objects.size() - 1);
+}
+
+void Picker::setTransform(uint32_t object, const glm::mat4 &transform) {
+  objects[object].inverse = glm::inverse(transform);
+  worldBounds[object] = transformAabb(objects[object].shape->boundingBox(),
+                                      transform);
+  moved.push_back(object);
+}
+
+void Picker::clear() {
+  objects.clear();
+  worldBounds.clear();
+  moved.clear();
+  rebuild = true;
+}
+
+bool Picker::pick(const Ray &ray, PickHit &hit) {
+  if (rebuild) {
+    bvh.build(worldBounds);
+    rebuild = false;
+    moved.clear();
+  } else if (!moved.empty()) {
+    bvh.refit(worldBounds, moved);
+    moved.clear();
+  }
+  if (objects.empty()) {
+    return false;
+  }
+
+  uint32_t triangle{};
+  Bvh::RayObjectTest exact = [&](uint32_t object, float &t) {
+    //an affine inverse keeps the ray's parametrization, so t comes back in
+    //world units without renormalizing
+    const Object &o = objects[object];
+    glm::vec3 origin(o.inverse * glm::vec4(ray.origin, 1.0f));
+    glm::vec3 direction(o.inverse * glm::vec4(ray.direction, 0.0f));
+    return o.shape->intersect(origin, direction, t, triangle);
+  };
+  BvhRayHit bvhHit;
+  if (!bvh.raycast(ray.origin, ray.direction, bvhHit,
+                   std::numeric_limits<float>::max(), exact)) {
+    return false;
+  }
+  //triangle belongs to the last object that found a closer hit, which is
+  //the one the Bvh reports
+  hit = {bvhHit.object, triangle, bvhHit.t};
+  return true;
+}
@@ -0,0 +1,100 @@
+#ifndef PICKING_H
+#define PICKING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bounds.h"
+#include "bvh.h"
+#include "glm/glm.hpp"
+
+struct Ray {
+  glm::vec3 origin;
+  glm::vec3 direction; //normalized
+};
+
+//world space ray through window position (x, y), in pixels from the top
+//left like GLFW's cursor position, of a width x height viewport rendered
+//with view and projection. starts on the near plane
+Ray rayFromScreen(float x, float y, int width, int height,
+                  const glm::mat4 &view, const glm::mat4 &projection);
+
+//an object's triangles for ray tests, packed in blocks of PICK_LANES as
+//structure of arrays: the first vertex and both edges, precomputed, so the
+//kernel does one load per component and nothing else. several meshes can be
+//appended; triangles keep their order and meshOf() maps one back to the
+//mesh it came from. about 36 bytes per triangle
+class PackedTriangles {
+public:
+#if defined(__AVX__)
+  static constexpr size_t PICK_LANES = 8;
+#else
+  static constexpr size_t PICK_LANES = 4;
+#endif
+
+  //positions: the first vertex' x, y, z, every stride floats. indices may
+  //be null for a plain triangle list of vertexCount vertecies
+  void append(const float *positions, size_t stride, size_t vertexCount,
+              const unsigned int *indices, size_t indexCount);
+  void clear();
+
+  //closest hit in front of origin (both windings count) that is nearer than
+  //t; on a hit, t and triangle are set. direction needn't be normalized, t
+  //is in its units. 8 triangles at a time with AVX, 4 with SSE
+  bool intersect(const glm::vec3 &origin, const glm::vec3 &direction,
+                 float &t, uint32_t &triangle) const;
+  //same, one triangle at a time
+  bool intersectScalar(const glm::vec3 &origin, const glm::vec3 &direction,
+                       float &t, uint32_t &triangle) const;
+
+  size_t triangleCount() const { return triangles; }
+  size_t meshCount() const { return meshFirst.size(); }
+  uint32_t meshOf(uint32_t triangle) const;
+  const Aabb &boundingBox() const { return bounds; }
+
+private:
+  //per block: v0 x/y/z, edge1 x/y/z, edge2 x/y/z, PICK_LANES floats each.
+  //unused lanes of the last block stay zero, which never hits
+  std::vector<float>    blocks;
+  size_t                triangles{};
+  std::vector<uint32_t> meshFirst; //first triangle of every appended mesh
+  Aabb                  bounds;
+};
+
+struct PickHit {
+  uint32_t object;
+  uint32_t triangle; //in the object's PackedTriangles
+  float t;           //world space distance along the ray
+};
+
+//ray picking over placed objects: a Bvh over their world space boxes finds
+//the candidates front to back, then each candidate's triangles are tested
+//in its own space (the ray goes through the inverse model matrix, so no
+//vertex is ever transformed). objects can share one PackedTriangles
+class Picker {
+public:
+  //shape must outlive the picker. returns the object's index
+  uint32_t addObject(const PackedTriangles *shape,
+                     const glm::mat4 &transform);
+  void setTransform(uint32_t object, const glm::mat4 &transform);
+  void clear();
+  size_t objectCount() const { return objects.size(); }
+
+  //closest object hit by ray. builds or refits the tree first if objects
+  //were added or moved since the last pick
+  bool pick(const Ray &ray, PickHit &hit);
+
+private:
+  struct Object {
+    const PackedTriangles *shape;
+    glm::mat4 inverse; //world -> object space
+  };
+  std::vector<Object>   objects;
+  std::vector<Aabb>     worldBounds;
+  std::vector<uint32_t> moved;
+  Bvh bvh;
+  bool rebuild{false};
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "png_writer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+static uint32_t crc32(const unsigned char *data, size_t size,
+                      uint32_t crc = 0) {
+  static uint32_t table[256];
+  static bool tableReady = false;
+  if (!tableReady) {
+    for (uint32_t n{}; n < 256; ++n) {
+      uint32_t c = n;
+      for (int k{}; k < 8; ++k) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      table[n] = c;
+    }
+    tableReady = true;
+  }
+  crc = ~crc;
+  for (size_t i{}; i < size; ++i) {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+static void putU32(std::vector<unsigned char> &out, uint32_t value) {
+  out.push_back(static_cast<unsigned char>(value >> 24));
+  out.push_back(static_cast<unsigned char>(value >> 16));
+  out.push_back(static_cast<unsigned char>(value >> 8));
+  out.push_back(static_cast<unsigned char>(value));
+}
+
+static void writeChunk(std::ofstream &file, const char type[4],
+                       const std::vector<unsigned char> &data) {
+  std::vector<unsigned char> chunk;
+  chunk.reserve(data.size() + 12);
+  putU32(chunk, static_cast<uint32_t>(data.size()));
+  chunk.insert(chunk.end(), type, type + 4);
+  chunk.insert(chunk.end(), data.begin(), data.end());
+  putU32(chunk, crc32(chunk.data() + 4, data.size() + 4));
+  file.write(reinterpret_cast<const char *>(chunk.data()),
+             static_cast<std::streamsize>(chunk.size()));
+}
+
+bool writePng(const std::string &path, const unsigned char *pixels,
+              int width, int height, int channels, bool flipY) {
+  if (width <= 0 || height <= 0 || (channels != 3 && channels != 4)) {
+    return false;
+  }
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+  static const unsigned char signature[8] = {0x89, 'P', 'N', 'G',
+                                             '\r', '\n', 0x1A, '\n'};
+  file.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+
+  std::vector<unsigned char> header;
+  putU32(header, static_cast<uint32_t>(width));
+  putU32(header, static_cast<uint32_t>(height));
+  header.push_back(8);                        //bit depth
+  header.push_back(channels == 4 ? 6 : 2);    //RGBA : RGB
+  header.push_back(0);                        //deflate
+  header.push_back(0);                        //adaptive filtering
+  header.push_back(0);                        //no interlace
+  writeChunk(file, "IHDR", header);
+
+  //raw scanlines, each prefixed with filter type 0 (none)
+  size_t rowBytes = static_cast<size_t>(width) * channels;
+  std::vector<unsigned char> raw;
+  raw.reserve((rowBytes + 1) * height);
+  for (int y{}; y < height; ++y) {
+    int srcRow = flipY ? height - 1 - y : y;
+    raw.push_back(0);
+    const unsigned char *row = pixels + srcRow * rowBytes;
+    raw.insert(raw.end(), row, row + rowBytes);
+  }
+
+  //zlib stream made of stored (uncompressed) deflate blocks of <= 65535 bytes
+  std::vector<unsigned char> zlib;
+  zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+  zlib.push_back(0x78);
+  zlib.push_back(0x01);
+  size_t offset{};
+  do {
+    size_t blockSize = std::min<size_t>(raw.size() - offset, 65535);
+    bool last = offset + blockSize == raw.size();
+    zlib.push_back(last ? 1 : 0);
+    zlib.push_back(static_cast<unsigned char>(blockSize));
+    zlib.push_back(static_cast<unsigned char>(blockSize >> 8));
+    zlib.push_back(static_cast<unsigned char>(~blockSize));
+    zlib.push_back(static_cast<unsigned char>(~blockSize >> 8));
+    zlib.insert(zlib.end(), raw.begin() + offset,
+                raw.begin() + offset + blockSize);
+    offset += blockSize;
+  } while (offset < raw.size());
+
+  uint32_t a{1}, b{0}; //adler32
+  for (unsigned char byte : raw) {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+  putU32(zlib, (b << 16) | a);
+  writeChunk(file, "IDAT", zlib);
+  writeChunk(file, "IEND", {});
+  return static_cast<bool>(file);
+}
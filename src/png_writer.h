@@ -0,0 +1,13 @@
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <string>
+
+//writes 8 bit RGBA (channels == 4) or RGB (channels == 3) pixels as a PNG.
+//rows are expected top to bottom unless flipY is set, which suits pixels
+//straight out of glReadPixels. the image data is stored, not compressed:
+//these are debug/CI captures, and skipping deflate keeps us dependency free.
+bool writePng(const std::string &path, const unsigned char *pixels,
+              int width, int height, int channels, bool flipY = false);
+
+#endif
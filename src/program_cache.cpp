@@ -0,0 +1,141 @@
+#include "program_cache.h"
+
+#include <glad/glad.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "gl_ext.h"
+#include "hash.h"
+#include "mapped_file.h"
+
+namespace fs = std::filesystem;
+
+static const char CACHE_MAGIC[8] = {'D', 'G', 'L', 'P', 'R', 'O', 'G', '\0'};
+
+//set on the GL thread during startup, read by every Shader constructor
+static std::string cacheDir;
+
+bool ProgramCache::setDirectory(const std::string &dir) {
+  cacheDir.clear();
+  if (dir.empty() || !glext.programBinary) {
+    return false;
+  }
+  std::error_code ec;
+  fs::create_directories(dir, ec);
+  if (ec) {
+    std::cout << "ERROR::PROGRAM_CACHE::CANNOT_CREATE " << dir << std::endl;
+    return false;
+  }
+  cacheDir = dir;
+  return true;
+}
+
+bool ProgramCache::enabled() {
+  return !cacheDir.empty();
+}
+
+uint64_t ProgramCache::key(const std::string &vertexSource,
+                           const std::string &fragmentSource,
+                           const std::string &defines) {
+  //lengths go in too so moving text between the parts changes the key
+  uint64_t hash = FNV1A_SEED;
+  for (const std::string *part : {&vertexSource, &fragmentSource, &defines}) {
+    uint64_t length = part->size();
+    hash = fnv1a64(&length, sizeof(length), hash);
+    hash = fnv1a64(*part, hash);
+  }
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION,
+                      GL_SHADING_LANGUAGE_VERSION}) {
+    const char *str = reinterpret_cast<const char *>(glGetString(name));
+    hash = fnv1a64(std::string(str ? str : ""), hash);
+  }
+  return hash;
+}
+
+std::string ProgramCache::pathFor(uint64_t key) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016" PRIx64 ".progbin", key);
+  return (fs::path(cacheDir) / name).string();
+}
+
+bool ProgramCache::load(uint64_t key, unsigned int program) {
+  if (!enabled()) {
+    return false;
+  }
+  std::string path = pathFor(key);
+  bool linked = false;
+  {
+    MappedFile file(path);
+    if (!file.isOpen()) {
+      return false;
+    }
+    ProgramCacheHeader header;
+    if (file.size() >= sizeof(header)) {
+      std::memcpy(&header, file.data(), sizeof(header));
+      if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+        && header.version == PROGRAM_CACHE_VERSION
+        && header.key == key
+        && header.binaryLength == file.size() - sizeof(header)) {
+        glext.programBinaryLoad(program, header.binaryFormat,
+                                file.data() + sizeof(header),
+                                static_cast<GLsizei>(header.binaryLength));
+        int success{};
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        linked = success != 0;
+      }
+    }
+  }
+  if (!linked) {
+    std::remove(path.c_str());
+  }
+  return linked;
+}
+
+bool ProgramCache::store(uint64_t key, unsigned int program) {
+  if (!enabled()) {
+    return false;
+  }
+  int length{};
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return false;
+  }
+  std::vector<char> binary(static_cast<size_t>(length));
+  GLsizei written{};
+  GLenum format{};
+  glext.getProgramBinary(program, length, &written, &format, binary.data());
+  if (written <= 0) {
+    return false;
+  }
+
+  ProgramCacheHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.version = PROGRAM_CACHE_VERSION;
+  header.binaryFormat = format;
+  header.key = key;
+  header.binaryLength = static_cast<uint64_t>(written);
+
+  //temp file + rename, same as the mesh cache: never a torn entry
+  std::string path = pathFor(key);
+  std::string tmpPath = path + ".tmp";
+  std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cout << "ERROR::PROGRAM_CACHE::CANNOT_WRITE " << tmpPath << std::endl;
+    return false;
+  }
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(binary.data(), written);
+  out.close();
+  if (!out) {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,47 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+//on-disk cache of linked program binaries (glGetProgramBinary), one file per
+//program: <dir>/<key as 16 hex digits>.progbin. layout:
+//
+//  ProgramCacheHeader
+//  binary blob (binaryLength bytes, driver specific)
+//
+//the key covers the shader sources, defines and the driver's vendor,
+//renderer and version strings, so a driver update just misses. the driver
+//may still reject a binary it wrote itself; callers must then recompile.
+constexpr uint32_t PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader {
+  char     magic[8];     //"DGLPROG\0"
+  uint32_t version;
+  uint32_t binaryFormat; //GLenum from glGetProgramBinary
+  uint64_t key;
+  uint64_t binaryLength;
+};
+
+class ProgramCache {
+public:
+  //empty dir disables the cache. false if the driver can't do binaries
+  static bool setDirectory(const std::string &dir);
+  static bool enabled();
+
+  static uint64_t key(const std::string &vertexSource,
+                      const std::string &fragmentSource,
+                      const std::string &defines);
+
+  //glProgramBinary into a fresh program; true only if it links. a rejected
+  //or malformed entry is deleted so the next store replaces it
+  static bool load(uint64_t key, unsigned int program);
+
+  //program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+  static bool store(uint64_t key, unsigned int program);
+
+private:
+  static std::string pathFor(uint64_t key);
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "render_queue.h"
+
+#include <cstring>
+#include <utility>
+
+//below this the histograms cost more than sorting
+static const size_t INSERTION_SORT_MAX = 64;
+
+uint64_t makeSortKey(RenderPass pass, unsigned int stencil,
+                     unsigned int program, unsigned int material,
+                     float depth) {
+  if (!(depth > 0.0f)) { //behind the camera or NaN: nearest
+    depth = 0.0f;
+  }
+  uint32_t bits;
+  std::memcpy(&bits, &depth, sizeof bits);
+  uint64_t depthBits = (bits >> 3) & 0xFFFFFFF; //sign is always 0
+  if (pass == PASS_TRANSLUCENT) {
+    depthBits = ~depthBits & 0xFFFFFFF;
+  }
+  return (static_cast<uint64_t>(pass & 0xF) << 60)
+       | (static_cast<uint64_t>(stencil & 0xF) << 56)
+       | (static_cast<uint64_t>(program & 0xFFF) << 44)
+       | (static_cast<uint64_t>(material & 0xFFFF) << 28)
+       | depthBits;
+}
+
+void RenderQueue::reserve(size_t count) {
+  queue.reserve(count);
+  scratch.reserve(count);
+}
+
+void RenderQueue::sort() {
+  size_t count = queue.size();
+  if (count <= INSERTION_SORT_MAX) {
+    for (size_t i{1}; i < count; ++i) {
+      DrawPacket packet = queue[i];
+      size_t j{i};
+      for (; j > 0 && queue[j - 1].key > packet.key; --j) {
+        queue[j] = queue[j - 1];
+      }
+      queue[j] = packet;
+    }
+    return;
+  }
+
+  //all 8 histograms in one pass over the keys
+  uint32_t histograms[8][256]{};
+  for (const DrawPacket &packet : queue) {
+    uint64_t key = packet.key;
+    for (int digit{}; digit < 8; ++digit) {
+      ++histograms[digit][(key >> (digit * 8)) & 0xFF];
+    }
+  }
+
+  scratch.resize(count);
+  DrawPacket *from = queue.data(), *to = scratch.data();
+  for (int digit{}; digit < 8; ++digit) {
+    uint32_t *histogram = histograms[digit];
+    int shift = digit * 8;
+    //everything in one bucket: this pass wouldn't move anything
+    if (histogram[(from[0].key >> shift) & 0xFF] == count) {
+      continue;
+    }
+    uint32_t offset{};
+    for (int bucket{}; bucket < 256; ++bucket) {
+      uint32_t size = histogram[bucket];
+      histogram[bucket] = offset;
+      offset += size;
+    }
+    for (size_t i{}; i < count; ++i) {
+      to[histogram[(from[i].key >> shift) & 0xFF]++] = from[i];
+    }
+    std::swap(from, to);
+  }
+  if (from != queue.data()) {
+    queue.swap(scratch);
+  }
+}
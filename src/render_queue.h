@@ -0,0 +1,67 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//what a draw belongs to, in the order the passes run
+enum RenderPass {
+  PASS_OPAQUE,      //front to back, for early z
+  PASS_OUTLINE,     //reads the stencil the opaque pass wrote
+  PASS_TRANSLUCENT  //back to front
+};
+
+//64 bit sort key, most significant first:
+//  pass 4 | stencil 4 | program 12 | material 16 | depth 28
+//so a sorted queue runs pass by pass, then groups draws by stencil state,
+//program and material, and only orders by depth among draws that share all
+//of those. program and material are truncated to their bits: a collision
+//only costs a state change, so GL names can go in directly. depth is the
+//distance from the camera (>= 0); its float bits compare like the float, so
+//the top 28 of them are used as is, inverted for PASS_TRANSLUCENT
+uint64_t makeSortKey(RenderPass pass, unsigned int stencil,
+                     unsigned int program, unsigned int material, float depth);
+
+inline RenderPass sortKeyPass(uint64_t key) {
+  return static_cast<RenderPass>(key >> 60);
+}
+inline unsigned int sortKeyStencil(uint64_t key) {
+  return static_cast<unsigned int>(key >> 56) & 0xF;
+}
+inline unsigned int sortKeyProgram(uint64_t key) {
+  return static_cast<unsigned int>(key >> 44) & 0xFFF;
+}
+inline unsigned int sortKeyMaterial(uint64_t key) {
+  return static_cast<unsigned int>(key >> 28) & 0xFFFF;
+}
+
+struct DrawPacket {
+  uint64_t key;
+  uint32_t payload; //index into whatever the submitter keeps per draw
+};
+
+//draws of one frame: passes submit packets in any order, sort() puts them in
+//key order once and the renderer walks packets() executing them. the
+//buffers are kept between frames, so a steady frame doesn't allocate
+class RenderQueue {
+public:
+  void clear() { queue.clear(); }
+  void reserve(size_t count);
+  void submit(uint64_t key, uint32_t payload) {
+    queue.push_back({key, payload});
+  }
+
+  //stable LSD radix sort on the key, 8 bits per pass. digits every key has
+  //in common (unused passes, a single program) are skipped, so it's
+  //usually far fewer than 8 passes. tiny queues use an insertion sort
+  void sort();
+
+  const std::vector<DrawPacket> &packets() const { return queue; }
+  size_t size() const { return queue.size(); }
+
+private:
+  std::vector<DrawPacket> queue, scratch;
+};
+
+#endif
@@ -0,0 +1,346 @@
+#include "scene.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include "frame_stats.h"
+#include "frustum.h"
+#include "gl_state.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "jump_flood_outline.h"
+#include "outline_renderer.h"
+#include "render_queue.h"
+#include "shader.h"
+#include "texture_cache.h"
+
+namespace fs = std::filesystem;
+
+//the stencil field of the scene's sort keys
+enum SceneStencil {
+  STENCIL_KEEP, //no stencil writes
+  STENCIL_WRITE //writes 1 where it draws (the selected cubes)
+};
+
+//which of a command buffer's instance lists a cube goes into
+enum SceneGroup { GROUP_UNSELECTED, GROUP_SELECTED };
+
+//what a packet's payload stands for
+enum SceneDraw { DRAW_FLOOR, DRAW_UNSELECTED, DRAW_SELECTED, DRAW_OUTLINE };
+
+static const Aabb floorBounds{glm::vec3(-5.0f, -0.5f, -5.0f),
+                              glm::vec3(5.0f, -0.5f, 5.0f)};
+
+static float distanceTo(const Aabb &box, const glm::vec3 &point) {
+  return glm::length(glm::max(glm::max(box.min - point, point - box.max),
+                              glm::vec3(0.0f)));
+}
+
+static const float cubeVertices[] = {
+        // positions          // texture Coords
+        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+         0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
+         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+
+        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+
+        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+         0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+         0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+         0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+         0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
+         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+
+        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
+    };
+static const float planeVertices[] = {
+        // positions          // texture Coords (note we set these higher than 1 (together with GL_REPEAT as texture wrapping mode). this will cause the floor texture to repeat)
+         5.0f, -0.5f,  5.0f,  2.0f, 0.0f,
+        -5.0f, -0.5f,  5.0f,  0.0f, 0.0f,
+        -5.0f, -0.5f, -5.0f,  0.0f, 2.0f,
+
+         5.0f, -0.5f,  5.0f,  2.0f, 0.0f,
+        -5.0f, -0.5f, -5.0f,  0.0f, 2.0f,
+         5.0f, -0.5f, -5.0f,  2.0f, 2.0f								
+    };
+
+
+Scene::Scene(const fs::path &projectRoot, JobSystem &jobs)
+: shader((projectRoot / "src" / "shaders" / "vertex.glsl").c_str(),
+         (projectRoot / "src" / "shaders" / "fragment.glsl").c_str()),
+  //the cubes go through the instanced vertex shader
+  instancedShader((projectRoot / "src" / "shaders" / "vertexInstanced.glsl").c_str(),
+                  (projectRoot / "src" / "shaders" / "fragment.glsl").c_str()),
+  singleColorShader((projectRoot / "src" / "shaders" / "vertexInstanced.glsl").c_str(),
+                    (projectRoot / "src" / "shaders" / "shaderSingleColor.glsl").c_str()),
+  jumpFloodOutline((projectRoot / "src" / "shaders").string()),
+  recorder(jobs) {
+  glState().enable(GL_DEPTH_TEST);
+  glState().depthFunc(GL_LESS);
+
+  glState().enable(GL_STENCIL_TEST);
+  glState().stencilFunc(GL_NOTEQUAL, 1, 0xFF);
+  glState().stencilOp(GL_KEEP, GL_REPLACE, GL_REPLACE);
+
+  // cube VAO
+  glGenVertexArrays(1, &cubeVAO);
+  glGenBuffers(1, &cubeVBO);
+  glState().bindVertexArray(cubeVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), &cubeVertices, GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+  glState().bindVertexArray(0);
+  // plane VAO
+  glGenVertexArrays(1, &planeVAO);
+  glGenBuffers(1, &planeVBO);
+  glState().bindVertexArray(planeVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), &planeVertices, GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+  glState().bindVertexArray(0);
+
+  TextureCache &textures = TextureCache::instance();
+  cubeTexture  = textures.acquire((projectRoot / "textures" / "marble.jpg").string());
+  floorTexture = textures.acquire((projectRoot / "textures" / "metal.png").string());
+
+  shader.use();
+  shader.setInt("texture1", 0);
+  instancedShader.use();
+  instancedShader.setInt("texture1", 0);
+
+  //resolve uniform locations once; render() only uses handles
+  shaderModel = shader.uniform("model");
+
+  //the bounds cover the scaled up border too, so a cube whose outline still
+  //shows isn't culled
+  glm::vec3 cubeExtent(0.5f * outlineScale);
+  cubeBounds = Aabb{-cubeExtent, cubeExtent};
+  OutlineGeometry cubeGeometry{cubeVBO, 0, 36, 5 * sizeof(float),
+                               3 * sizeof(float)};
+  outline = std::make_unique<OutlineRenderer>(cubeGeometry);
+  unselected = std::make_unique<OutlineRenderer>(cubeGeometry);
+  cubeTriangles.append(cubeVertices, 5, 36, nullptr, 0);
+  setSelection({
+    glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 0.01f, -1.0f)),
+    glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.01f, 0.0f)),
+  });
+}
+
+Scene::~Scene() {
+  recorder.wait();
+  outline.reset();
+  unselected.reset();
+  cubeTexture.reset();
+  floorTexture.reset();
+  glDeleteBuffers(1, &cubeVBO);
+  glDeleteBuffers(1, &planeVBO);
+  glState().deleteVertexArrays(1, &cubeVAO);
+  glState().deleteVertexArrays(1, &planeVAO);
+}
+
+void Scene::setSelection(const std::vector<glm::mat4> &transforms) {
+  recorder.wait();
+  objects = transforms;
+  selected.assign(objects.size(), 1);
+  picker.clear();
+  for (const glm::mat4 &transform : objects) {
+    picker.addObject(&cubeTriangles, transform);
+  }
+}
+
+int Scene::pick(const Ray &ray) {
+  if (spin != 0.0f) { //the cubes moved since the picker last saw them
+    for (size_t i{}; i < objects.size(); ++i) {
+      picker.setTransform(static_cast<uint32_t>(i), modelMatrix(i, time));
+    }
+  }
+  PickHit hit;
+  if (!picker.pick(ray, hit)) {
+    return -1;
+  }
+  return static_cast<int>(hit.object);
+}
+
+void Scene::setSelected(size_t object, bool outlined) {
+  if (selected[object] != outlined) {
+    recorder.wait();
+    selected[object] = outlined;
+  }
+}
+
+void Scene::resize(int width, int height) {
+  jumpFloodOutline.resize(width, height);
+}
+
+glm::mat4 Scene::modelMatrix(size_t object, float seconds) const {
+  if (spin == 0.0f) {
+    return objects[object];
+  }
+  return glm::rotate(objects[object], spin * seconds,
+                     glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+void Scene::record(const glm::mat4 &view, const glm::mat4 &projection) {
+  recorder.record(view, projection, time, objects.size(),
+                  [this](const RecordedFrame &frame, size_t first,
+                         size_t last, CommandBuffer &buffer) {
+                    recordObjects(frame, first, last, buffer);
+                  });
+}
+
+//runs on a worker: only reads the scene, writes nothing but buffer
+void Scene::recordObjects(const RecordedFrame &frame, size_t first,
+                          size_t last, CommandBuffer &buffer) const {
+  Frustum frustum(frame.projection * frame.view);
+  glm::vec3 eye = glm::vec3(glm::inverse(frame.view)[3]);
+  for (size_t i{first}; i < last; ++i) {
+    glm::mat4 model = modelMatrix(i, frame.time);
+    Aabb box = transformAabb(cubeBounds, model);
+    if (!frustum.intersects(box)) {
+      ++buffer.culled;
+      continue;
+    }
+    ++buffer.visible;
+    size_t group = selected[i] ? GROUP_SELECTED : GROUP_UNSELECTED;
+    buffer.instances[group].push_back(model);
+    buffer.nearest[group] = std::min(buffer.nearest[group],
+                                     distanceTo(box, eye));
+  }
+}
+
+void Scene::submit(unsigned int targetFbo) {
+  const RecordedFrame *frame = recorder.next();
+  if (!frame) {
+    return;
+  }
+  glState().bindFramebuffer(GL_FRAMEBUFFER, targetFbo);
+
+  // rendering commands
+  glClearColor(0.05f, 0.05, 0.05f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+  //one upload for all three programs
+  frameUniforms.update(frame->view, frame->projection, frame->time);
+
+  //the workers' command buffers go into the instance buffers one after the
+  //other, in object order
+  OutlineRenderer *groups[RECORD_GROUPS];
+  groups[GROUP_UNSELECTED] = unselected.get();
+  groups[GROUP_SELECTED] = outline.get();
+  for (size_t group{}; group < RECORD_GROUPS; ++group) {
+    groups[group]->beginInstances(frame->instanceCount(group));
+    size_t offset{};
+    for (const CommandBuffer &buffer : frame->buffers) {
+      const std::vector<glm::mat4> &instances = buffer.instances[group];
+      groups[group]->writeInstances(offset, instances.data(),
+                                    instances.size());
+      offset += instances.size();
+    }
+  }
+  FrameStats &stats = currentFrameStats();
+  for (const CommandBuffer &buffer : frame->buffers) {
+    stats.objectsVisible += buffer.visible;
+    stats.objectsCulled += buffer.culled;
+  }
+
+  //every draw goes through the queue: sorted, the passes come out grouped
+  //by stencil state and program, each group front to back
+  glm::vec3 eye = glm::vec3(glm::inverse(frame->view)[3]);
+  queue.clear();
+  queue.submit(makeSortKey(PASS_OPAQUE, STENCIL_KEEP, shader.ID,
+                           floorTexture->id(), distanceTo(floorBounds, eye)),
+               DRAW_FLOOR);
+  queue.submit(makeSortKey(PASS_OPAQUE, STENCIL_KEEP, instancedShader.ID,
+                           cubeTexture->id(),
+                           frame->nearest(GROUP_UNSELECTED)),
+               DRAW_UNSELECTED);
+  queue.submit(makeSortKey(PASS_OPAQUE, STENCIL_WRITE, instancedShader.ID,
+                           cubeTexture->id(), frame->nearest(GROUP_SELECTED)),
+               DRAW_SELECTED);
+  queue.submit(makeSortKey(PASS_OUTLINE, STENCIL_KEEP,
+                           singleColorShader.ID, 0, 0.0f),
+               DRAW_OUTLINE);
+  queue.sort();
+
+  for (const DrawPacket &packet : queue.packets()) {
+    //the outline passes set up their own stencil state
+    if (sortKeyPass(packet.key) == PASS_OPAQUE
+        && sortKeyStencil(packet.key) == STENCIL_KEEP) {
+      glState().stencilMask(0x00); //leave the stencil buffer be
+    }
+    switch (packet.payload) {
+    case DRAW_FLOOR: {
+      ProfileScope scope(profiler, "floor");
+      shader.use();
+      glState().bindVertexArray(planeVAO);
+      glState().bindTexture2D(0, floorTexture->id());
+      shader.setMat4(shaderModel, glm::mat4(1.0f));
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+      break;
+    }
+    case DRAW_UNSELECTED: {
+      ProfileScope scope(profiler, "unselected cubes");
+      glState().bindTexture2D(0, cubeTexture->id());
+      unselected->drawMask(instancedShader);
+      break;
+    }
+    //1st render pass: draw cubes and update stencil buffer with their
+    //fragments (all selected cubes in one instanced draw)
+    case DRAW_SELECTED: {
+      ProfileScope scope(profiler, "stencil cubes");
+      glState().bindTexture2D(0, cubeTexture->id());
+      outline->drawObjects(instancedShader);
+      break;
+    }
+    //2nd render pass: scale cubes and draw them where they don't overlap
+    //with cubes from the 1st render pass (the borders)
+    case DRAW_OUTLINE: {
+      ProfileScope scope(profiler, "outline");
+      if (outlineMode == OUTLINE_STENCIL_SCALE) {
+        outline->drawOutline(singleColorShader, outlineScale);
+      } else {
+        //or: pixel exact border from a jump flood over the cubes' mask
+        jumpFloodOutline.draw(*outline, targetFbo);
+        glState().stencilMask(0xFF); //same end state as drawOutline
+        glState().stencilFunc(GL_ALWAYS, 0, 0xFF);
+      }
+      break;
+    }
+    }
+  }
+}
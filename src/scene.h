@@ -0,0 +1,121 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "frame_recorder.h"
+#include "frame_uniforms.h"
+#include "gpu_profiler.h"
+#include "jump_flood_outline.h"
+#include "outline_renderer.h"
+#include "picking.h"
+#include "render_queue.h"
+#include "shader.h"
+#include "texture_cache.h"
+
+//how the selection outline is drawn
+enum OutlineMode {
+  OUTLINE_STENCIL_SCALE, //redraw scaled up objects where the stencil isn't set
+  OUTLINE_JUMP_FLOOD     //screen space distance field around a mask
+};
+
+//the demo scene: a textured floor and cubes, some of them selected
+//(outlined); the two demo cubes by default. owns every GL
+//object it draws, so it has to be created after (and destroyed before) the
+//context. window/headless/benchmark loops all render through this.
+//
+//a frame is recorded on worker threads (model matrices, culling, instance
+//lists) and then submitted on the GL thread. render() does both back to
+//back; a loop that calls record() for frame N + 1 and then submit() shows
+//frame N while the workers are busy with the next one, one frame late.
+class Scene {
+public:
+  //projectRoot: directory holding src/shaders and textures. jobs records
+  //the frames; it's shared with the rest of the app and has to outlive the
+  //scene
+  Scene(const std::filesystem::path &projectRoot, JobSystem &jobs);
+  ~Scene();
+
+  Scene(const Scene &) = delete;
+  Scene &operator=(const Scene &) = delete;
+
+  //size of the framebuffer we render into (screen space outline targets)
+  void resize(int width, int height);
+
+  //replaces the cubes with one per model matrix, all of them selected
+  void setSelection(const std::vector<glm::mat4> &transforms);
+
+  //index of the closest cube hit by ray (world space), or -1. tested
+  //against the cubes' triangles, not just their boxes
+  int pick(const Ray &ray);
+  //outline a cube or stop outlining it
+  void setSelected(size_t object, bool outlined);
+  bool isSelected(size_t object) const { return selected[object] != 0; }
+  size_t objectCount() const { return objects.size(); }
+
+  //times the floor, stencil cubes and outline passes when set (may be null)
+  void setProfiler(GpuProfiler *passProfiler) { profiler = passProfiler; }
+
+  void setOutlineMode(OutlineMode mode) { outlineMode = mode; }
+  OutlineMode getOutlineMode() const { return outlineMode; }
+
+  //seconds since start, for FrameData::time and the spin
+  void setTime(float seconds) { time = seconds; }
+  //every cube turns around its own y axis at this rate (0: they stand still)
+  void setSpin(float radiansPerSecond) { spin = radiansPerSecond; }
+
+  //starts recording a frame for view/projection at the current time on the
+  //workers and returns right away
+  void record(const glm::mat4 &view, const glm::mat4 &projection);
+  //blocks until the workers are done with the last record()
+  void finishRecording() { recorder.wait(); }
+  //waits for the oldest recorded frame and draws it into targetFbo (0 = the
+  //window). does nothing if nothing was recorded
+  void submit(unsigned int targetFbo = 0);
+  //draws one frame into targetFbo (0 = the window). view and projection go
+  //to every program through the FrameData block
+  void render(const glm::mat4 &view, const glm::mat4 &projection,
+              unsigned int targetFbo = 0) {
+    record(view, projection);
+    submit(targetFbo);
+  }
+
+private:
+  Shader shader;            //floor
+  Shader instancedShader;   //cubes
+  Shader singleColorShader; //stencil outline border
+  UniformHandle shaderModel;
+  FrameUniforms frameUniforms;
+  float time{};
+  float spin{};
+
+  unsigned int cubeVAO{0}, cubeVBO{0}, planeVAO{0}, planeVBO{0};
+  SharedTexture cubeTexture, floorTexture;
+
+  std::vector<glm::mat4> objects; //every cube
+  std::vector<uint8_t> selected;   //per cube, 1: outlined
+  Aabb cubeBounds; //object space, with room for the border
+  //the selected and the other cubes; both need cubeVBO first
+  std::unique_ptr<OutlineRenderer> outline, unselected;
+  PackedTriangles cubeTriangles;
+  Picker picker;
+  JumpFloodOutline jumpFloodOutline;
+  OutlineMode outlineMode{OUTLINE_STENCIL_SCALE};
+  float outlineScale{1.1f};
+  GpuProfiler *profiler{nullptr};
+  RenderQueue queue; //this frame's draws
+  //last: its workers read objects, so they have to stop first
+  FrameRecorder recorder;
+
+  //worker side of record()
+  void recordObjects(const RecordedFrame &frame, size_t first, size_t last,
+                     CommandBuffer &buffer) const;
+  glm::mat4 modelMatrix(size_t object, float seconds) const;
+};
+
+#endif
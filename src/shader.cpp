@@ -4,14 +4,52 @@
 
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath){
+#include "frame_uniforms.h"
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "program_cache.h"
+
+static ShaderBuildStats stats;
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+    .count();
+}
+
+//"#define NAME value" lines go after #version (which has to come first), and
+//a #line resets numbering so compile errors still point at the file's lines
+static std::string injectDefines(const std::string &code,
+                                 const std::string &defineBlock) {
+  if (defineBlock.empty()) {
+    return code;
+  }
+  size_t versionLine = code.find("#version");
+  size_t insertAt = 0;
+  int nextLine = 1;
+  if (versionLine != std::string::npos) {
+    insertAt = code.find('\n', versionLine);
+    insertAt = insertAt == std::string::npos ? code.size() : insertAt + 1;
+    nextLine += static_cast<int>(
+      std::count(code.begin(), code.begin() + insertAt, '\n'));
+  }
+  return code.substr(0, insertAt) + defineBlock
+    + "#line " + std::to_string(nextLine) + "\n" + code.substr(insertAt);
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath,
+               const std::vector<std::string> &defines){
 
 // ===========================SHADER FILE->STRING SRC==========================
+  Clock::time_point readStart = Clock::now();
   std::string vertexCode;
   std::string fragmentCode;
   std::ifstream vShaderFile;
@@ -37,6 +75,59 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath){
     std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
   }
 
+  std::string defineBlock;
+  for (const std::string &define : defines) {
+    defineBlock += "#define " + define + "\n";
+  }
+  vertexCode = injectDefines(vertexCode, defineBlock);
+  fragmentCode = injectDefines(fragmentCode, defineBlock);
+  stats.readMs += msSince(readStart);
+  ++stats.programs;
+
+// =======================CACHED BINARY->SHADER PROGRAM========================
+  //the key hashes the final (define injected) sources, so defines are in it
+  uint64_t cacheKey{};
+  if (ProgramCache::enabled()) {
+    cacheKey = ProgramCache::key(vertexCode, fragmentCode, defineBlock);
+    Clock::time_point loadStart = Clock::now();
+    ID = glCreateProgram();
+    bool hit = ProgramCache::load(cacheKey, ID);
+    stats.binaryLoadMs += msSince(loadStart);
+    if (hit) {
+      ++stats.cacheHits;
+      reflectUniforms();
+      bindUniformBlocks();
+      return;
+    }
+    //rejected binaries can leave the program in a failed link state; start
+    //over with a clean one
+    ++stats.cacheMisses;
+    glState().deleteProgram(ID);
+  }
+
+  bool linked = compileAndLink(vertexCode, fragmentCode,
+                               ProgramCache::enabled());
+  if (linked && ProgramCache::enabled()) {
+    Clock::time_point storeStart = Clock::now();
+    ProgramCache::store(cacheKey, ID);
+    stats.binaryStoreMs += msSince(storeStart);
+  }
+
+  reflectUniforms();
+  bindUniformBlocks();
+}
+
+const ShaderBuildStats &Shader::buildStats() {
+  return stats;
+}
+
+void Shader::resetBuildStats() {
+  stats = ShaderBuildStats();
+}
+
+bool Shader::compileAndLink(const std::string &vertexCode,
+                            const std::string &fragmentCode,
+                            bool retrievable) {
   const char* vShaderCode = vertexCode.c_str();
   const char* fShaderCode = fragmentCode.c_str();
 
@@ -45,6 +136,10 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath){
   int success;
   char infoLog[512];
 
+  //the status queries are part of the timed region: drivers are free to
+  //compile lazily and only block once the result is asked for
+  Clock::time_point compileStart = Clock::now();
+
   //compile vertex shader
   vertex = glCreateShader(GL_VERTEX_SHADER);
   glShaderSource(vertex, 1, &vShaderCode, NULL);
@@ -68,9 +163,14 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath){
     std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" 
               << infoLog << std::endl;
   }; 
+  stats.compileMs += msSince(compileStart);
 
   // ====================COMPILED SHADER->SHADER PROGRAM=======================
+  Clock::time_point linkStart = Clock::now();
   ID = glCreateProgram(); 
+  if (retrievable) {
+    glext.programParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
   glAttachShader(ID, vertex);
   glAttachShader(ID, fragment);
   glLinkProgram(ID);
@@ -83,45 +183,118 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath){
   }
   glDeleteShader(vertex);
   glDeleteShader(fragment);
+  stats.linkMs += msSince(linkStart);
+  return success != 0;
+}
+
+//builds the name -> location table once, right after linking
+void Shader::reflectUniforms() {
+  uniforms.clear();
+  int count{}, maxLength{};
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+  std::vector<char> nameBuffer(std::max(maxLength, 1));
 
+  for (int i{}; i < count; ++i) {
+    int length{}, size{};
+    GLenum type;
+    glGetActiveUniform(ID, static_cast<GLuint>(i),
+                       static_cast<GLsizei>(nameBuffer.size()), &length,
+                       &size, &type, nameBuffer.data());
+    std::string name(nameBuffer.data(), length);
+    int location = glGetUniformLocation(ID, name.c_str());
+    if (location < 0) {
+      continue; //uniform block members etc. have no location
+    }
+    uniforms.emplace_back(name, location);
+
+    //arrays are reported as "foo[0]"; make them reachable as "foo" too and
+    //give the remaining elements their own entries
+    size_t bracket = name.rfind("[0]");
+    if (bracket != std::string::npos && bracket + 3 == name.size()) {
+      std::string base = name.substr(0, bracket);
+      uniforms.emplace_back(base, location);
+      for (int element{1}; element < size; ++element) {
+        std::string elementName = base + '[' + std::to_string(element) + ']';
+        int elementLocation = glGetUniformLocation(ID, elementName.c_str());
+        if (elementLocation >= 0) {
+          uniforms.emplace_back(elementName, elementLocation);
+        }
+      }
+    }
+  }
+  std::sort(uniforms.begin(), uniforms.end());
+}
+
+//block bindings are program state that neither relinking nor a program
+//binary is guaranteed to keep, so they're set after either
+void Shader::bindUniformBlocks() {
+  GLuint frameBlock = glGetUniformBlockIndex(ID, FRAME_DATA_BLOCK);
+  if (frameBlock != GL_INVALID_INDEX) {
+    glUniformBlockBinding(ID, frameBlock, FRAME_DATA_BINDING);
+  }
+}
+
+UniformHandle Shader::uniform(const std::string &name) const {
+  auto it = std::lower_bound(
+    uniforms.begin(), uniforms.end(), name,
+    [](const std::pair<std::string, int> &entry, const std::string &key) {
+      return entry.first < key;
+    });
+  if (it == uniforms.end() || it->first != name) {
+    return UniformHandle();
+  }
+  return UniformHandle(it->second);
 }
 
 Shader::~Shader() {
-  glDeleteProgram(ID);
+  glState().deleteProgram(ID);
 }
 
 void Shader::use() {
-  glUseProgram(ID);
+  glState().useProgram(ID);
+}
+
+void Shader::setBool(UniformHandle handle, bool value) const {
+  glUniform1i(handle.location, (int)value);
+}
+
+void Shader::setInt(UniformHandle handle, int value) const {
+  glUniform1i(handle.location, value);
+}
+
+void Shader::setFloat(UniformHandle handle, float value) const {
+  glUniform1f(handle.location, value);
+}
+
+void Shader::setMat4(UniformHandle handle, const glm::mat4 &value) const {
+  glUniformMatrix4fv(handle.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::setVec3(UniformHandle handle, const glm::vec3 &value) const {
+  glUniform3fv(handle.location, 1, glm::value_ptr(value));
 }
 
 void Shader::setBool(const std::string &name, bool value) const {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+  setBool(uniform(name), value);
 }
 
 void Shader::setInt(const std::string &name, int value) const {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+  setInt(uniform(name), value);
 }
 
 void Shader::setFloat(const std::string &name, float value) const{
-  glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+  setFloat(uniform(name), value);
 }
 
 void Shader::setMat4(const std::string &name, glm::mat4 value) const{
-  glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()),
-                     1,
-                     GL_FALSE,
-                     glm::value_ptr(value));
+  setMat4(uniform(name), value);
 }
 
 void Shader::setVec3(const std::string &name, glm::vec3 value) const{
-  glUniform3fv(glGetUniformLocation(ID, name.c_str()),
-               1, 
-               glm::value_ptr(value));
+  setVec3(uniform(name), value);
 }
 
 void Shader::setVec3(const std::string &name, float v1, float v2, float v3) const{
-  glUniform3fv(glGetUniformLocation(ID, name.c_str()),
-               1,
-               glm::value_ptr(glm::vec3(v1, v2, v3)));
+  setVec3(uniform(name), glm::vec3(v1, v2, v3));
 }
-
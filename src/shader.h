@@ -9,20 +9,67 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <utility>
+#include <vector>
 
+//resolved uniform location. grab these once (Shader::uniform) outside the
+//render loop and pass them to the handle setters: no strings, no hashing and
+//no driver round trip per call. a handle for a missing/inactive uniform is
+//still valid to use, the set just becomes a no-op (location -1).
+class UniformHandle {
+public:
+  UniformHandle() = default;
+  bool valid() const { return location >= 0; }
+
+private:
+  friend class Shader;
+  explicit UniformHandle(int location) : location(location) {}
+  int location{-1};
+};
+
+//process wide totals for every Shader built so far, so startup cost (and what
+//the program binary cache saves) can be measured. GL thread only.
+struct ShaderBuildStats {
+  unsigned int programs{};
+  unsigned int cacheHits{};   //linked straight from a cached binary
+  unsigned int cacheMisses{}; //no entry, or the driver rejected it
+  double readMs{};            //source files -> strings
+  double compileMs{};         //glCompileShader, both stages
+  double linkMs{};            //glLinkProgram
+  double binaryLoadMs{};      //glProgramBinary on hits
+  double binaryStoreMs{};     //glGetProgramBinary + write on misses
+};
 
 class Shader {
 public:
   unsigned int ID;
 
-  // constructor reads and builds the shader
-  Shader(const char* vertexPath, const char* fragmentPath);
+  // constructor reads and builds the shader. each define ("NAME" or
+  // "NAME value") is injected right after the #version line of both stages.
+  // linked programs are stored in / loaded from the ProgramCache directory
+  // when one is set. a FrameData block is bound to FRAME_DATA_BINDING
+  Shader(const char* vertexPath, const char* fragmentPath,
+         const std::vector<std::string> &defines = {});
   ~Shader();
 
+  static const ShaderBuildStats &buildStats();
+  static void resetBuildStats();
+
   // use/activate the shader
   void use();
 
-  //utility uniform functions
+  //looks name up in the table built at link time (never queries GL).
+  //array uniforms can be found as "name" or "name[0]"
+  UniformHandle uniform(const std::string &name) const;
+
+  //handle based setters, meant for per draw use
+  void setBool(UniformHandle handle, bool value) const;
+  void setInt(UniformHandle handle, int value) const;
+  void setFloat(UniformHandle handle, float value) const;
+  void setMat4(UniformHandle handle, const glm::mat4 &value) const;
+  void setVec3(UniformHandle handle, const glm::vec3 &value) const;
+
+  //utility uniform functions (name lookups, fine for one off setup)
   void setBool(const std::string &name, bool value) const;
   void setInt(const std::string &name, int value) const;
   void setFloat(const std::string &name, float value) const;
@@ -30,6 +77,14 @@ public:
   void setVec3(const std::string &name, glm::vec3 value) const;
   void setVec3(const std::string &name, float v1, float v2, float v3) const;
 
+private:
+  //every active uniform -> location, sorted by name
+  std::vector<std::pair<std::string, int>> uniforms;
+
+  bool compileAndLink(const std::string &vertexCode,
+                      const std::string &fragmentCode, bool retrievable);
+  void reflectUniforms();
+  void bindUniformBlocks();
 };
 
 #endif
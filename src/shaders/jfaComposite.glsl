@@ -0,0 +1,24 @@
+#version 330 core
+// draws the outline wherever the distance to the mask is within outlineWidth;
+// the stencil test keeps it off the object itself
+out vec4 FragColor;
+
+uniform usampler2D seeds;
+uniform float outlineWidth;
+uniform vec3 outlineColor;
+
+const uint NO_SEED = 0xFFFFu;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    uvec2 s = texelFetch(seeds, pixel, 0).xy;
+    if (s.x == NO_SEED)
+        discard;
+    float dist = length(vec2(s) - vec2(pixel));
+    // one pixel of falloff so the edge isn't jagged
+    float alpha = 1.0 - smoothstep(outlineWidth - 0.5, outlineWidth + 0.5, dist);
+    if (alpha <= 0.0)
+        discard;
+    FragColor = vec4(outlineColor, alpha);
+}
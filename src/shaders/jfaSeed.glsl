@@ -0,0 +1,9 @@
+#version 330 core
+// jump flood init: drawn with a stencil test, so it only runs on covered
+// mask pixels; each is its own nearest seed
+out uvec2 Seed;
+
+void main()
+{
+    Seed = uvec2(gl_FragCoord.xy);
+}
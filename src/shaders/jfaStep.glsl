@@ -0,0 +1,34 @@
+#version 330 core
+// one jump flood round: keep the nearest seed among the 3x3 neighbours
+// stepSize pixels away
+out uvec2 Seed;
+
+uniform usampler2D seeds;
+uniform int stepSize;
+
+const uint NO_SEED = 0xFFFFu;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 size = textureSize(seeds, 0);
+    uvec2 best = uvec2(NO_SEED);
+    float bestDist = 1e20;
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x) {
+            ivec2 p = pixel + ivec2(x, y) * stepSize;
+            if (any(lessThan(p, ivec2(0))) || any(greaterThanEqual(p, size)))
+                continue;
+            uvec2 s = texelFetch(seeds, p, 0).xy;
+            if (s.x == NO_SEED)
+                continue;
+            vec2 d = vec2(s) - vec2(pixel);
+            float dist = dot(d, d);
+            if (dist < bestDist) {
+                bestDist = dist;
+                best = s;
+            }
+        }
+    }
+    Seed = best;
+}
@@ -1,15 +1,31 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoords;
+layout (location = 2) in vec2 aTexCoords; // Mesh puts the normal at 1
 
 out vec2 TexCoords;
 
+layout (std140) uniform FrameData { // FrameUniforms, updated once per frame
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition; // w unused
+    float time;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#ifdef COMPACT_VERTICES
+// Mesh's VERTEX_COMPACT positions are unorm16 inside the mesh's bounds
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+#endif
 
 void main()
 {
     TexCoords = aTexCoords;    
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+#ifdef COMPACT_VERTICES
+    vec3 position = aPos * positionScale + positionOffset;
+#else
+    vec3 position = aPos;
+#endif
+    gl_Position = viewProjection * model * vec4(position, 1.0);
 }
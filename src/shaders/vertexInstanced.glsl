@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoords; // same locations as Mesh
+layout (location = 3) in mat4 aModel; // per instance, takes locations 3-6
+
+out vec2 TexCoords;
+
+layout (std140) uniform FrameData { // FrameUniforms, updated once per frame
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition; // w unused
+    float time;
+};
+
+uniform float outlineScale; // object space scale, 1.0 for the object pass
+
+void main()
+{
+    TexCoords = aTexCoords;
+    gl_Position = viewProjection * aModel * vec4(aPos * outlineScale, 1.0);
+}
@@ -0,0 +1,174 @@
+#include "texture_cache.h"
+
+#include <glad/glad.h>
+
+#include <filesystem>
+#include <iostream>
+
+#include "dds.h"
+#include "gl_state.h"
+#include "hash.h"
+#include "stb_image.h"
+
+namespace fs = std::filesystem;
+
+CachedTexture::~CachedTexture() {
+  glState().deleteTextures(1, &textureId);
+  TextureCache::instance().residentBytes -= gpuBytes;
+}
+
+void CachedTexture::setResident(int width, int height, int channels,
+                                bool mipmaps) {
+  size_t bytes = static_cast<size_t>(width) * static_cast<size_t>(height)
+    * static_cast<size_t>(channels);
+  if (mipmaps) {
+    bytes += bytes / 3; //the whole chain converges on 4/3 of level 0
+  }
+  TextureCache &cache = TextureCache::instance();
+  cache.residentBytes = cache.residentBytes - gpuBytes + bytes;
+  gpuBytes = bytes;
+}
+
+size_t TextureCache::KeyHash::operator()(const Key &key) const {
+  uint64_t hash = fnv1a64(key.path);
+  const TextureParams &p = key.params;
+  uint32_t fields[5] = {p.wrap, p.minFilter, p.magFilter,
+                        static_cast<uint32_t>(p.mipmaps),
+                        static_cast<uint32_t>(p.channels)};
+  return static_cast<size_t>(fnv1a64(fields, sizeof(fields), hash));
+}
+
+TextureCache &TextureCache::instance() {
+  static TextureCache cache;
+  return cache;
+}
+
+SharedTexture TextureCache::acquire(const std::string &path,
+                                    const TextureParams &params,
+                                    AsyncTextureLoader *loader,
+                                    const unsigned char placeholder[4]) {
+  //"models/a/../a/x.png" and "/abs/models/a/x.png" are the same texture
+  std::error_code ec;
+  fs::path canonical = fs::weakly_canonical(fs::absolute(path), ec);
+  Key key{ec ? path : canonical.string(), params};
+
+  auto it = entries.find(key);
+  if (it != entries.end()) {
+    if (SharedTexture existing = it->second.lock()) {
+      ++hits;
+      return existing;
+    }
+  }
+  ++misses;
+  pruneExpired();
+
+  unsigned int id{};
+  SharedTexture texture;
+  if ((texture = loadCompressed(key))) {
+    //nothing to decode, so no point in going through the loader either
+  } else if (loader) {
+    static const unsigned char grey[4] = {128, 128, 128, 255};
+    //the loader only knows the name; the hook finds out whether anyone still
+    //wants the texture by the time its pixels are ready
+    auto pendingTexture = std::make_shared<std::weak_ptr<CachedTexture>>();
+    bool mipmaps = params.mipmaps;
+    id = loader->request(key.path, placeholder ? placeholder : grey, params,
+      [pendingTexture, mipmaps](int width, int height, int channels) {
+        SharedTexture alive = pendingTexture->lock();
+        if (!alive) {
+          return false;
+        }
+        alive->setResident(width, height, channels, mipmaps);
+        return true;
+      });
+    texture = SharedTexture(new CachedTexture(id));
+    *pendingTexture = texture;
+  } else {
+    glGenTextures(1, &id);
+    texture = SharedTexture(new CachedTexture(id));
+    int width, height, channels;
+    unsigned char *data = stbi_load(key.path.c_str(), &width, &height,
+                                    &channels, params.channels);
+    if (params.channels != 0) {
+      channels = params.channels;
+    }
+    if (data) {
+      uploadTexture2D(id, data, width, height, channels, params);
+      texture->setResident(width, height, channels, params.mipmaps);
+    } else {
+      std::cout << "Texture failed to load at path: " << path << std::endl;
+    }
+    stbi_image_free(data);
+  }
+
+  entries[key] = texture;
+  return texture;
+}
+
+//foo.dds itself, or foo.dds sitting next to foo.png/foo.jpg (tools/texconv
+//output) as long as it was converted from foo.png as it is now. null if
+//there is none, it's stale or unreadable or the driver can't sample its
+//format, and the caller falls back to decoding the source image
+SharedTexture TextureCache::loadCompressed(const Key &key) {
+  fs::path ddsPath(key.path);
+  bool sibling = ddsPath.extension() != ".dds";
+  if (sibling) {
+    ddsPath.replace_extension(".dds");
+    std::error_code ec;
+    if (!fs::exists(ddsPath, ec)) {
+      return nullptr;
+    }
+  }
+  CompressedImage image;
+  DdsSourceStamp source;
+  if (!readDds(ddsPath.string(), image, &source)) {
+    std::cout << "WARNING::TEXTURE_CACHE::BAD_DDS " << ddsPath.string()
+              << std::endl;
+    return nullptr;
+  }
+  if (sibling && !ddsSourceMatches(source, key.path)) {
+    //the image was edited since (or this isn't texconv's): rerun texconv
+    std::cout << "WARNING::TEXTURE_CACHE::STALE_DDS " << ddsPath.string()
+              << std::endl;
+    return nullptr;
+  }
+  unsigned int id;
+  glGenTextures(1, &id);
+  SharedTexture texture(new CachedTexture(id));
+  if (!uploadCompressedTexture2D(id, image, key.params)) {
+    return nullptr;
+  }
+  size_t bytes = key.params.mipmaps ? compressedImageBytes(image)
+                                    : image.levels[0].data.size();
+  residentBytes += bytes;
+  texture->gpuBytes = bytes;
+  return texture;
+}
+
+//expired entries only cost a string each, so they're swept lazily on misses
+void TextureCache::pruneExpired() {
+  for (auto it = entries.begin(); it != entries.end();) {
+    if (it->second.expired()) {
+      it = entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+TextureCache::Stats TextureCache::stats() const {
+  Stats s;
+  s.hits = hits;
+  s.misses = misses;
+  for (const auto &entry : entries) {
+    if (!entry.second.expired()) {
+      ++s.liveTextures;
+    }
+  }
+  s.residentBytes = residentBytes;
+  return s;
+}
+
+void TextureCache::resetCounters() {
+  hits = misses = 0;
+}
@@ -0,0 +1,93 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "texture_loader.h"
+
+class AsyncTextureLoader;
+
+//one GL texture owned through shared handles: the last SharedTexture to go
+//away deletes it (so that has to happen on the GL thread, like everything
+//else here).
+class CachedTexture {
+public:
+  ~CachedTexture();
+
+  CachedTexture(const CachedTexture &) = delete;
+  CachedTexture &operator=(const CachedTexture &) = delete;
+
+  unsigned int id() const { return textureId; }
+  //0 until the image is resident (async loads hold a placeholder until then)
+  size_t bytes() const { return gpuBytes; }
+
+private:
+  friend class TextureCache;
+  explicit CachedTexture(unsigned int id) : textureId(id) {}
+  void setResident(int width, int height, int channels, bool mipmaps);
+
+  unsigned int textureId{0};
+  size_t gpuBytes{0};
+};
+
+using SharedTexture = std::shared_ptr<CachedTexture>;
+
+//process wide texture cache: every image file is decoded and uploaded once
+//no matter how many models (or scenes) use it. entries are keyed on the
+//canonical absolute path plus the TextureParams, and only hold weak
+//references, so the cache never keeps a texture alive by itself.
+//
+//GL thread only, no locking.
+class TextureCache {
+public:
+  struct Stats {
+    size_t hits{};
+    size_t misses{};
+    size_t liveTextures{};  //textures somebody still holds
+    size_t residentBytes{}; //estimate: width * height * channels (+1/3 for
+                            //mips); drivers may pad RGB to RGBA
+  };
+
+  static TextureCache &instance();
+
+  //the shared texture for path, loading it on a miss. a block compressed
+  //foo.dds next to foo.png is used instead of the png when the driver can
+  //sample it. otherwise, with a loader, the miss returns a placeholder right
+  //away (see AsyncTextureLoader). a file that fails to load still gets an
+  //(empty) texture, like it always has
+  SharedTexture acquire(const std::string &path,
+                        const TextureParams &params = {},
+                        AsyncTextureLoader *loader = nullptr,
+                        const unsigned char placeholder[4] = nullptr);
+
+  Stats stats() const;
+  void resetCounters();
+
+private:
+  friend class CachedTexture;
+
+  struct Key {
+    std::string path;
+    TextureParams params;
+    bool operator==(const Key &other) const {
+      return path == other.path && params == other.params;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+
+  std::unordered_map<Key, std::weak_ptr<CachedTexture>, KeyHash> entries;
+  size_t hits{}, misses{};
+  size_t residentBytes{};
+
+  TextureCache() = default;
+  SharedTexture loadCompressed(const Key &key);
+  void pruneExpired();
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "texture_loader.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <utility>
+
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "stb_image.h"
+
+void uploadTexture2D(unsigned int id, const unsigned char *pixels,
+                     int width, int height, int channels,
+                     const TextureParams &params) {
+  GLenum format = GL_RGBA;
+  switch (channels) {
+    case 1:
+      format = GL_RED;
+      break;
+    case 2:
+      format = GL_RG;
+      break;
+    case 3:
+      format = GL_RGB;
+      break;
+  }
+  glState().bindTexture(GL_TEXTURE_2D, id);
+  glTexImage2D(GL_TEXTURE_2D, 0, format, width, height,
+               0, format, GL_UNSIGNED_BYTE, pixels);
+  GLenum minFilter = params.minFilter;
+  if (params.mipmaps) {
+    glGenerateMipmap(GL_TEXTURE_2D);
+  } else if (minFilter != GL_NEAREST && minFilter != GL_LINEAR) {
+    minFilter = GL_LINEAR; //a mipmapped filter on one level is incomplete
+  }
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrap);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrap);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params.magFilter);
+}
+
+size_t compressedImageBytes(const CompressedImage &image) {
+  size_t bytes{};
+  for (const CompressedLevel &level : image.levels) {
+    bytes += level.data.size();
+  }
+  return bytes;
+}
+
+bool uploadCompressedTexture2D(unsigned int id, const CompressedImage &image,
+                               const TextureParams &params) {
+  GLenum internalFormat{};
+  switch (image.format) {
+    case BLOCK_BC1:
+      internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+      break;
+    case BLOCK_BC3:
+      internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+      break;
+    case BLOCK_BC5:
+      internalFormat = GL_COMPRESSED_RG_RGTC2;
+      break;
+  }
+  if (image.levels.empty()
+    || (image.format != BLOCK_BC5 && !glext.textureS3tc)) {
+    return false;
+  }
+
+  size_t levelCount = params.mipmaps ? image.levels.size() : 1;
+  glState().bindTexture(GL_TEXTURE_2D, id);
+  for (size_t i{}; i < levelCount; ++i) {
+    const CompressedLevel &level = image.levels[i];
+    glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i),
+                           internalFormat, level.width, level.height, 0,
+                           static_cast<GLsizei>(level.data.size()),
+                           level.data.data());
+  }
+  //a chain that stops short of 1x1 is still complete with MAX_LEVEL set
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                  static_cast<GLint>(levelCount - 1));
+
+  GLenum minFilter = params.minFilter;
+  if (levelCount == 1 && minFilter != GL_NEAREST && minFilter != GL_LINEAR) {
+    minFilter = GL_LINEAR;
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrap);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrap);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params.magFilter);
+  return true;
+}
+
+AsyncTextureLoader::AsyncTextureLoader(JobSystem &jobs) : jobs(jobs) {}
+
+AsyncTextureLoader::~AsyncTextureLoader() {
+  jobs.wait(decodes);
+  for (DecodedImage &image : ready) {
+    stbi_image_free(image.pixels);
+  }
+}
+
+unsigned int AsyncTextureLoader::request(const std::string &path,
+                                         const unsigned char placeholder[4],
+                                         const TextureParams &params,
+                                         UploadHook beforeUpload) {
+  unsigned int id;
+  glGenTextures(1, &id);
+  TextureParams placeholderParams = params;
+  placeholderParams.mipmaps = false;
+  uploadTexture2D(id, placeholder, 1, 1, 4, placeholderParams);
+
+  ++outstanding;
+  jobs.run([this, id, path, params, beforeUpload]() {
+    DecodedImage image{id, path, nullptr, 0, 0, 0, params, beforeUpload};
+    image.pixels = stbi_load(path.c_str(), &image.width, &image.height,
+                             &image.channels, params.channels);
+    if (params.channels != 0) {
+      image.channels = params.channels; //stbi reports the file's count
+    }
+    {
+      std::lock_guard<std::mutex> lock(readyMutex);
+      ready.push_back(std::move(image));
+    }
+  }, &decodes);
+  return id;
+}
+
+size_t AsyncTextureLoader::pump(size_t maxUploads) {
+  std::vector<DecodedImage> batch;
+  {
+    std::lock_guard<std::mutex> lock(readyMutex);
+    size_t take = ready.size();
+    if (maxUploads != 0 && maxUploads < take) {
+      take = maxUploads;
+    }
+    batch.assign(std::make_move_iterator(ready.begin()),
+                 std::make_move_iterator(ready.begin() + take));
+    ready.erase(ready.begin(), ready.begin() + take);
+  }
+  for (DecodedImage &image : batch) {
+    upload(image);
+  }
+  return batch.size();
+}
+
+void AsyncTextureLoader::finish() {
+  jobs.wait(decodes);
+  pump();
+}
+
+void AsyncTextureLoader::upload(DecodedImage &image) {
+  if (image.pixels) {
+    if (!image.beforeUpload
+      || image.beforeUpload(image.width, image.height, image.channels)) {
+      uploadTexture2D(image.id, image.pixels, image.width, image.height,
+                      image.channels, image.params);
+    }
+  } else {
+    //keeps the placeholder, same as the synchronous path keeping an empty
+    //texture
+    std::cout << "Texture failed to load at path: " << image.path
+              << std::endl;
+  }
+  stbi_image_free(image.pixels);
+  --outstanding;
+}
@@ -0,0 +1,103 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "block_compress.h"
+#include "job_system.h"
+
+//how an image file becomes a GL texture. the defaults are what every texture
+//in the project has always used
+struct TextureParams {
+  GLenum wrap{GL_REPEAT};
+  GLenum minFilter{GL_LINEAR_MIPMAP_LINEAR};
+  GLenum magFilter{GL_LINEAR};
+  bool mipmaps{true};
+  int channels{0}; //force 1-4 channels on decode, 0 = as stored in the file
+
+  bool operator==(const TextureParams &other) const {
+    return wrap == other.wrap && minFilter == other.minFilter
+      && magFilter == other.magFilter && mipmaps == other.mipmaps
+      && channels == other.channels;
+  }
+};
+
+//uploads decoded 8 bit pixels (1-4 channels) into texture name id, building
+//the mip chain if params asks for one. GL thread only.
+void uploadTexture2D(unsigned int id, const unsigned char *pixels,
+                     int width, int height, int channels,
+                     const TextureParams &params = {});
+
+//total size of every level's blocks, ie what the GPU stores
+size_t compressedImageBytes(const CompressedImage &image);
+
+//uploads the levels of a block compressed image as they are (no decoding, no
+//glGenerateMipmap), only level 0 if params.mipmaps is off. false if the
+//driver can't sample that format. GL thread only.
+bool uploadCompressedTexture2D(unsigned int id, const CompressedImage &image,
+                               const TextureParams &params = {});
+
+//two stage texture loading: stbi decoding runs as jobs, uploads
+//happen on the GL thread whenever pump() is called.
+//
+//request() returns a texture name straight away, holding a 1x1 placeholder
+//texel. the real image is uploaded into that same name later, so meshes can
+//be built and drawn before any decoding finished and pick the real texture
+//up without being told.
+class AsyncTextureLoader {
+public:
+  explicit AsyncTextureLoader(JobSystem &jobs);
+  //waits for in-flight decodes; anything never pumped stays a placeholder
+  ~AsyncTextureLoader();
+
+  AsyncTextureLoader(const AsyncTextureLoader &) = delete;
+  AsyncTextureLoader &operator=(const AsyncTextureLoader &) = delete;
+
+  //called on the GL thread right before the real image is uploaded; return
+  //false to skip the upload (eg the texture was deleted in the meantime)
+  using UploadHook = std::function<bool(int width, int height, int channels)>;
+
+  //GL thread. placeholder is one RGBA texel
+  unsigned int request(const std::string &path,
+                       const unsigned char placeholder[4],
+                       const TextureParams &params = {},
+                       UploadHook beforeUpload = nullptr);
+
+  //GL thread: uploads decoded images, at most maxUploads of them (0 = every
+  //one that is ready). returns how many were uploaded
+  size_t pump(size_t maxUploads = 0);
+
+  //GL thread: blocks until every request so far is resident, decoding
+  //alongside the workers meanwhile
+  void finish();
+
+  //requests not uploaded yet
+  size_t pending() const { return outstanding.load(); }
+
+private:
+  struct DecodedImage {
+    unsigned int id;
+    std::string path;
+    unsigned char *pixels; //stbi owned, null if decoding failed
+    int width, height, channels;
+    TextureParams params;
+    UploadHook beforeUpload;
+  };
+
+  JobSystem &jobs;
+  JobCounter decodes;
+  std::vector<DecodedImage> ready;
+  std::mutex readyMutex;
+  std::atomic<size_t> outstanding{0};
+
+  void upload(DecodedImage &image);
+};
+
+#endif
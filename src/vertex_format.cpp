@@ -0,0 +1,128 @@
+#include "vertex_format.h"
+
+#include <glad/glad.h>
+
+#include <cmath>
+
+#include "glm/gtc/packing.hpp"
+#include "mesh.h"
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex has padding");
+
+size_t vertexStride(VertexFormat format) {
+  return format == VERTEX_COMPACT ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+//unit vector -> point on the octahedron unfolded into [-1, 1]^2. a zero
+//vector (meshes without normals/UVs) stays zero
+static glm::vec2 octEncode(const glm::vec3 &v) {
+  float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+  if (l1 == 0.0f) {
+    return glm::vec2(0.0f);
+  }
+  glm::vec2 e = glm::vec2(v.x, v.y) / l1;
+  if (v.z < 0.0f) {
+    glm::vec2 folded(1.0f - std::abs(e.y), 1.0f - std::abs(e.x));
+    e.x = e.x >= 0.0f ? folded.x : -folded.x;
+    e.y = e.y >= 0.0f ? folded.y : -folded.y;
+  }
+  return e;
+}
+
+PositionDequant positionDequant(const glm::vec3 &lo, const glm::vec3 &hi) {
+  PositionDequant dequant;
+  dequant.offset = lo;
+  dequant.scale = hi - lo;
+  //flat along an axis: any scale works, 1 avoids dividing by zero
+  for (int k{}; k < 3; ++k) {
+    if (dequant.scale[k] <= 0.0f) {
+      dequant.scale[k] = 1.0f;
+    }
+  }
+  return dequant;
+}
+
+PositionDequant packVertices(const Vertex *vertexData, size_t vertexCount,
+                             std::vector<PackedVertex> &out) {
+  if (vertexCount == 0) {
+    out.clear();
+    return PositionDequant();
+  }
+  glm::vec3 lo = vertexData[0].Position, hi = lo;
+  for (size_t i{1}; i < vertexCount; ++i) {
+    lo = glm::min(lo, vertexData[i].Position);
+    hi = glm::max(hi, vertexData[i].Position);
+  }
+  PositionDequant dequant = positionDequant(lo, hi);
+  packVertices(vertexData, vertexCount, dequant, out);
+  return dequant;
+}
+
+void packVertices(const Vertex *vertexData, size_t vertexCount,
+                  const PositionDequant &dequant,
+                  std::vector<PackedVertex> &out) {
+  out.resize(vertexCount);
+  glm::vec3 invScale = 1.0f / dequant.scale;
+  for (size_t i{}; i < vertexCount; ++i) {
+    const Vertex &v = vertexData[i];
+    PackedVertex &p = out[i];
+    //packUnorm1x16 clamps to [0, 1]
+    glm::vec3 unit = (v.Position - dequant.offset) * invScale;
+    for (int k{}; k < 3; ++k) {
+      p.position[k] = glm::packUnorm1x16(unit[k]);
+    }
+    p.position[3] = 0;
+
+    p.normal = glm::packSnorm3x10_1x2(glm::vec4(octEncode(v.Normal), 0, 0));
+    p.texCoords[0] = glm::packHalf1x16(v.TexCoords.x);
+    p.texCoords[1] = glm::packHalf1x16(v.TexCoords.y);
+
+    //handedness of the TBN basis, which is all the bitangent adds
+    float sign = glm::dot(glm::cross(v.Normal, v.Tangent), v.BiTangent) < 0.0f
+      ? -1.0f : 1.0f;
+    p.tangent = glm::packSnorm3x10_1x2(
+      glm::vec4(octEncode(v.Tangent), 0, sign));
+  }
+}
+
+void setupVertexAttributes(VertexFormat format) {
+  if (format == VERTEX_COMPACT) {
+    GLsizei stride = sizeof(PackedVertex);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+                          (void*)offsetof(PackedVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride,
+                          (void*)offsetof(PackedVertex, normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+                          (void*)offsetof(PackedVertex, texCoords));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride,
+                          (void*)offsetof(PackedVertex, tangent));
+    //no bitangent stream; it's rebuilt from tangent.w
+    glDisableVertexAttribArray(4);
+    return;
+  }
+
+  // vertex data
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+
+  // normals data
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
+                        sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+  // TexCoord data
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE,
+                        sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+
+  glEnableVertexAttribArray(3);
+  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE,
+                        sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+
+  glEnableVertexAttribArray(4);
+  glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE,
+                        sizeof(Vertex), (void*)offsetof(Vertex, BiTangent));
+}
@@ -0,0 +1,63 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+struct Vertex;
+
+//how a Mesh lays out its vertex buffer. attribute locations are the same in
+//both (0 position, 1 normal, 2 texcoords, 3 tangent, 4 bitangent, which the
+//compact layout leaves out), so shaders declaring those locations, like
+//shaders/vertex.glsl, only need to care about the position transform below.
+enum VertexFormat {
+  VERTEX_FULL,   //Vertex as is: 56 bytes of float32
+  VERTEX_COMPACT //PackedVertex: 20 bytes, no bitangent attribute
+};
+
+//VERTEX_COMPACT layout:
+//  position  unorm16 x3 (+ pad) inside the mesh's bounding box. the shader
+//            gets it back as aPos * positionScale + positionOffset
+//  normal    GL_INT_2_10_10_10_REV snorm: octahedral x, y (z, w unused)
+//  texcoords half float x2, so tiling UVs outside [0, 1] still work
+//  tangent   GL_INT_2_10_10_10_REV snorm: octahedral x, y, w = bitangent
+//            sign. bitangent = cross(normal, tangent) * w
+//
+//octahedral decode (GLSL): n = vec3(e, 1 - abs(e.x) - abs(e.y));
+//  if (n.z < 0) n.xy = (1 - abs(n.yx)) * sign(n.xy); n = normalize(n);
+struct PackedVertex {
+  uint16_t position[4];
+  uint32_t normal;
+  uint16_t texCoords[2];
+  uint32_t tangent;
+};
+
+//per mesh transform back from unorm16 positions to object space
+struct PositionDequant {
+  glm::vec3 scale{1.0f};
+  glm::vec3 offset{0.0f};
+};
+
+size_t vertexStride(VertexFormat format);
+
+//quantizes vertexCount vertecies into out (resized to fit) and returns the
+//transform that undoes the position quantization
+PositionDequant packVertices(const Vertex *vertexData, size_t vertexCount,
+                             std::vector<PackedVertex> &out);
+//same, against a transform picked by the caller (eg one covering several
+//meshes that have to share it). positions outside it are clamped
+void packVertices(const Vertex *vertexData, size_t vertexCount,
+                  const PositionDequant &dequant,
+                  std::vector<PackedVertex> &out);
+
+//transform for positions inside [lo, hi]
+PositionDequant positionDequant(const glm::vec3 &lo, const glm::vec3 &hi);
+
+//enables and points attributes 0-4 at the bound GL_ARRAY_BUFFER, laid out
+//as format. the VAO to set up has to be bound
+void setupVertexAttributes(VertexFormat format);
+
+#endif
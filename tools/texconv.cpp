@@ -0,0 +1,96 @@
+//offline texture converter: decodes images with stb_image and writes them
+//as block compressed DDS files (full mip chain) next to the source, where
+//TextureCache picks them up instead of the original. each file records the
+//size, mtime and hash of its source, so the cache ignores it once the
+//source is edited.
+//
+//  texconv [--format=auto|bc1|bc3|bc5] [--no-mips] [--no-flip] image...
+//
+//auto is BC3 for images with any transparency and BC1 otherwise; use bc5
+//for tangent space normal maps. images are flipped vertically like the app
+//does at load time (stbi_set_flip_vertically_on_load) unless --no-flip.
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "block_compress.h"
+#include "dds.h"
+#include "stb_image.h"
+
+namespace fs = std::filesystem;
+
+int main(int argc, char *argv[]) {
+  std::string formatName = "auto";
+  bool mipmaps = true, flip = true;
+  std::vector<std::string> inputs;
+  for (int i{1}; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 9, "--format=") == 0) {
+      formatName = arg.substr(9);
+    } else if (arg == "--no-mips") {
+      mipmaps = false;
+    } else if (arg == "--no-flip") {
+      flip = false;
+    } else {
+      inputs.push_back(arg);
+    }
+  }
+  if (inputs.empty()
+    || (formatName != "auto" && formatName != "bc1" && formatName != "bc3"
+        && formatName != "bc5")) {
+    std::printf("usage: texconv [--format=auto|bc1|bc3|bc5] [--no-mips] "
+                "[--no-flip] image...\n");
+    return 1;
+  }
+  stbi_set_flip_vertically_on_load(flip);
+
+  int failures{};
+  for (const std::string &input : inputs) {
+    std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    int width, height, channels;
+    unsigned char *rgba = stbi_load(input.c_str(), &width, &height,
+                                    &channels, 4);
+    if (!rgba) {
+      std::printf("%s: can't decode (%s)\n", input.c_str(),
+                  stbi_failure_reason());
+      ++failures;
+      continue;
+    }
+
+    BlockFormat format = BLOCK_BC1;
+    if (formatName == "auto") {
+      format = pickBlockFormat(rgba, width, height);
+    } else if (formatName == "bc3") {
+      format = BLOCK_BC3;
+    } else if (formatName == "bc5") {
+      format = BLOCK_BC5;
+    }
+    CompressedImage image = compressImage(rgba, width, height, format,
+                                          mipmaps);
+    stbi_image_free(rgba);
+
+    std::string output = fs::path(input).replace_extension(".dds").string();
+    DdsSourceStamp source;
+    stampDdsSource(input, source);
+    if (!writeDds(output, image, &source)) {
+      std::printf("%s: can't write %s\n", input.c_str(), output.c_str());
+      ++failures;
+      continue;
+    }
+    size_t bytes{};
+    for (const CompressedLevel &level : image.levels) {
+      bytes += level.data.size();
+    }
+    double ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+    std::printf("%s -> %s: %dx%d %s, %zu levels, %zu KiB (%.0f ms)\n",
+                input.c_str(), output.c_str(), width, height,
+                blockFormatName(format), image.levels.size(), bytes / 1024,
+                ms);
+  }
+  return failures == 0 ? 0 : 1;
+}